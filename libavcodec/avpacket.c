@@ -26,6 +26,7 @@
 #include "libavutil/internal.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/mem.h"
+#include "libavutil/objcache_internal.h"
 #include "avcodec.h"
 #include "bytestream.h"
 #include "internal.h"
@@ -50,7 +51,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
 AVPacket *av_packet_alloc(void)
 {
-    AVPacket *pkt = av_mallocz(sizeof(AVPacket));
+    AVPacket *pkt = avpriv_objcache_alloc(FF_OBJCACHE_PACKET, sizeof(AVPacket));
     if (!pkt)
         return pkt;
 
@@ -65,7 +66,8 @@ void av_packet_free(AVPacket **pkt)
         return;
 
     av_packet_unref(*pkt);
-    av_freep(pkt);
+    avpriv_objcache_free(FF_OBJCACHE_PACKET, *pkt);
+    *pkt = NULL;
 }
 
 static int packet_alloc(AVBufferRef **buf, int size)
@@ -0,0 +1,177 @@
+/*
+ * Block-parallel deflate
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zlib.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+
+#include "avcodec.h"
+#include "deflate_mt.h"
+
+/* smaller blocks would cost more in lost matches than they win in speed */
+#define MIN_BLOCK_SIZE (128 * 1024)
+#define DICT_SIZE      (32 * 1024)
+
+typedef struct DeflateBlock {
+    const uint8_t *src;
+    int src_size;
+    int dict_size;
+    int level;
+    int last;
+    uint8_t *dst;
+    int dst_size;
+    uLong adler;
+    int ret;
+} DeflateBlock;
+
+static int nb_blocks(AVCodecContext *avctx, int src_size)
+{
+    int n = src_size / MIN_BLOCK_SIZE;
+
+    if (avctx->active_thread_type & FF_THREAD_SLICE)
+        n = FFMIN(n, avctx->thread_count);
+    else
+        n = FFMIN(n, 1);
+    return FFMAX(n, 1);
+}
+
+int64_t ff_deflate_mt_bound(AVCodecContext *avctx, int src_size)
+{
+    /* zlib header and trailer, plus a sync flush marker per block */
+    return compressBound(src_size) + 6 + 16 * nb_blocks(avctx, src_size);
+}
+
+static int deflate_block(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    DeflateBlock *b = (DeflateBlock *)arg + jobnr;
+    z_stream zstream = { 0 };
+    int ret;
+
+    if (deflateInit2(&zstream, b->level, Z_DEFLATED, -15, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        return b->ret = AVERROR_EXTERNAL;
+
+    if (b->dict_size &&
+        deflateSetDictionary(&zstream, b->src - b->dict_size, b->dict_size) != Z_OK) {
+        ret = AVERROR_EXTERNAL;
+        goto end;
+    }
+
+    b->dst_size = deflateBound(&zstream, b->src_size) + 16;
+    b->dst      = av_malloc(b->dst_size);
+    if (!b->dst) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    zstream.next_in   = (unsigned char *)b->src;
+    zstream.avail_in  = b->src_size;
+    zstream.next_out  = b->dst;
+    zstream.avail_out = b->dst_size;
+    ret = deflate(&zstream, b->last ? Z_FINISH : Z_SYNC_FLUSH);
+    if (ret != (b->last ? Z_STREAM_END : Z_OK) ||
+        zstream.avail_in || !zstream.avail_out) {
+        ret = AVERROR_EXTERNAL;
+        goto end;
+    }
+
+    b->dst_size -= zstream.avail_out;
+    b->adler     = adler32(adler32(0, NULL, 0), b->src, b->src_size);
+    ret          = 0;
+
+end:
+    deflateEnd(&zstream);
+    return b->ret = ret;
+}
+
+int ff_deflate_mt(AVCodecContext *avctx, uint8_t *dst, int dst_size,
+                  const uint8_t *src, int src_size, int level)
+{
+    int n = nb_blocks(avctx, src_size);
+    int i, pos, ret, level_flags;
+    uLong adler = adler32(0, NULL, 0);
+    unsigned header;
+    DeflateBlock *blocks;
+    uint8_t *p = dst, *end = dst + dst_size;
+
+    if (level == Z_DEFAULT_COMPRESSION)
+        level = 6;
+
+    blocks = av_mallocz_array(n, sizeof(*blocks));
+    if (!blocks)
+        return AVERROR(ENOMEM);
+
+    for (i = 0, pos = 0; i < n; i++) {
+        int next = (int64_t)src_size * (i + 1) / n;
+        DeflateBlock *b = &blocks[i];
+
+        b->src       = src + pos;
+        b->src_size  = next - pos;
+        b->dict_size = FFMIN(pos, DICT_SIZE);
+        b->level     = level;
+        b->last      = i == n - 1;
+        pos          = next;
+    }
+
+    avctx->execute2(avctx, deflate_block, blocks, NULL, n);
+
+    /* zlib header as deflate() would write it for the same level */
+    level_flags = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+    header      = (0x78 << 8) | (level_flags << 6);
+    header     += 31 - header % 31;
+    if (end - p < 2) {
+        ret = AVERROR(ENOSPC);
+        goto fail;
+    }
+    AV_WB16(p, header);
+    p += 2;
+
+    for (i = 0; i < n; i++) {
+        DeflateBlock *b = &blocks[i];
+
+        if (b->ret < 0) {
+            ret = b->ret;
+            goto fail;
+        }
+        if (end - p < b->dst_size) {
+            ret = AVERROR(ENOSPC);
+            goto fail;
+        }
+        memcpy(p, b->dst, b->dst_size);
+        p    += b->dst_size;
+        adler = adler32_combine(adler, b->adler, b->src_size);
+    }
+
+    if (end - p < 4) {
+        ret = AVERROR(ENOSPC);
+        goto fail;
+    }
+    AV_WB32(p, adler);
+    p  += 4;
+    ret = p - dst;
+
+fail:
+    for (i = 0; i < n; i++)
+        av_freep(&blocks[i].dst);
+    av_freep(&blocks);
+    return ret;
+}
@@ -0,0 +1,52 @@
+/*
+ * Block-parallel deflate
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_DEFLATE_MT_H
+#define AVCODEC_DEFLATE_MT_H
+
+#include <stdint.h>
+
+#include "avcodec.h"
+
+/**
+ * Maximum size of the zlib stream ff_deflate_mt() can produce.
+ * @param avctx codec context ff_deflate_mt() will be called with
+ * @param src_size number of input bytes
+ */
+int64_t ff_deflate_mt_bound(AVCodecContext *avctx, int src_size);
+
+/**
+ * Compress a buffer into a single zlib stream, deflating independent
+ * blocks of the input in parallel through avctx->execute2().
+ * Each block is primed with the last 32 KiB of the previous one and all but
+ * the last are terminated by a sync flush, so the blocks concatenate into
+ * one valid stream with a ratio close to a serial deflate.
+ * @param avctx codec context, its slice threads are used if active
+ * @param dst output buffer
+ * @param dst_size size of the output buffer
+ * @param src input buffer
+ * @param src_size size of the input buffer
+ * @param level zlib compression level or Z_DEFAULT_COMPRESSION
+ * @return size of the zlib stream, a negative AVERROR code on failure
+ */
+int ff_deflate_mt(AVCodecContext *avctx, uint8_t *dst, int dst_size,
+                  const uint8_t *src, int src_size, int level);
+
+#endif /* AVCODEC_DEFLATE_MT_H */
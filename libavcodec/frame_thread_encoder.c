@@ -41,6 +41,21 @@ typedef struct{
     unsigned index;
 } Task;
 
+/**
+ * Pictures coded in a row by one thread for encoders with
+ * FF_CODEC_CAP_FRAME_THREADS_GOP, and the packets they gave.
+ */
+typedef struct{
+    AVFrame **frames;
+    int nb_frames;
+    int64_t picture_number;
+    int64_t prev_pts, next_pts;
+
+    AVPacket **pkts;
+    int nb_pkts;
+    int next_pkt;
+} GOP;
+
 typedef struct{
     AVCodecContext *parent_avctx;
     pthread_mutex_t buffer_mutex;
@@ -56,10 +71,71 @@ typedef struct{
     unsigned task_index;
     unsigned finished_task_index;
 
+    int gop_size;       ///< pictures per GOP when threads code whole GOPs, else 0
+    GOP *gop;           ///< GOP being filled
+    int64_t frame_count;
+    int64_t last_pts;
+
     pthread_t worker[MAX_THREADS];
     atomic_int exit;
 } ThreadContext;
 
+static void free_gop(GOP **pgop)
+{
+    GOP *gop = *pgop;
+    int i;
+
+    if (!gop)
+        return;
+    for (i = 0; i < gop->nb_frames; i++)
+        av_frame_free(&gop->frames[i]);
+    for (i = gop->next_pkt; i < gop->nb_pkts; i++)
+        av_packet_free(&gop->pkts[i]);
+    av_freep(&gop->frames);
+    av_freep(&gop->pkts);
+    av_freep(pgop);
+}
+
+static int encode_gop(AVCodecContext *avctx, GOP *gop)
+{
+    ThreadContext *c = avctx->internal->frame_thread_encoder;
+    int i, got_packet, ret = 0;
+
+    avctx->internal->gop_start          = 1;
+    avctx->internal->gop_picture_number = gop->picture_number;
+    avctx->internal->gop_prev_pts       = gop->prev_pts;
+    avctx->internal->gop_next_pts       = gop->next_pts;
+
+    /* code the pictures, then flush the encoder so that the next GOP this
+     * thread gets does not depend on this one */
+    for (i = 0; ret >= 0; i++) {
+        AVFrame *frame = i < gop->nb_frames ? gop->frames[i] : NULL;
+        AVPacket *pkt = av_packet_alloc();
+
+        if (!pkt)
+            return AVERROR(ENOMEM);
+
+        ret = avcodec_encode_video2(avctx, pkt, frame, &got_packet);
+        if (frame) {
+            pthread_mutex_lock(&c->buffer_mutex);
+            av_frame_unref(frame);
+            pthread_mutex_unlock(&c->buffer_mutex);
+            av_frame_free(&gop->frames[i]);
+        }
+        if (ret >= 0 && got_packet) {
+            ret = av_packet_make_refcounted(pkt);
+            if (ret >= 0)
+                ret = av_dynarray_add_nofree(&gop->pkts, &gop->nb_pkts, pkt);
+            if (ret >= 0)
+                pkt = NULL;
+        }
+        av_packet_free(&pkt);
+        if (!frame && !got_packet)
+            break;
+    }
+    return ret;
+}
+
 static void * attribute_align_arg worker(void *v){
     AVCodecContext *avctx = v;
     ThreadContext *c = avctx->internal->frame_thread_encoder;
@@ -84,6 +160,16 @@ static void * attribute_align_arg worker(void *v){
         }
         av_fifo_generic_read(c->task_fifo, &task, sizeof(task), NULL);
         pthread_mutex_unlock(&c->task_fifo_mutex);
+
+        if (c->gop_size) {
+            ret = encode_gop(avctx, task.indata);
+            pthread_mutex_lock(&c->finished_task_mutex);
+            c->finished_tasks[task.index].outdata = task.indata;
+            c->finished_tasks[task.index].return_code = ret;
+            pthread_cond_signal(&c->finished_task_cond);
+            pthread_mutex_unlock(&c->finished_task_mutex);
+            continue;
+        }
         frame = task.indata;
 
         ret = avcodec_encode_video2(avctx, pkt, frame, &got_packet);
@@ -114,13 +200,101 @@ end:
     return NULL;
 }
 
+static int is_intra_only_config(AVCodecContext *avctx)
+{
+    if (!(avctx->codec->caps_internal & FF_CODEC_CAP_FRAME_THREADS_INTRA))
+        return 0;
+
+    /* every picture must be coded independently and output immediately,
+     * two-pass statistics cannot be shared between the threads */
+    if (avctx->gop_size > 1 || avctx->max_b_frames > 0 ||
+        avctx->flags & (AV_CODEC_FLAG_PASS1 | AV_CODEC_FLAG_PASS2))
+        return 0;
+
+    return 1;
+}
+
+/* the value of an option of the encoder private context, 0 if it has none */
+static int64_t get_priv_opt(AVCodecContext *avctx, const char *name)
+{
+    int64_t val = 0;
+    av_opt_get_int(avctx->priv_data, name, 0, &val);
+    return val;
+}
+
+/* whether a flag of a flags option of the encoder private context is set */
+static int get_priv_flag(AVCodecContext *avctx, const char *name, const char *flag)
+{
+    const AVOption *o = av_opt_find(avctx->priv_data, flag, name, 0, 0);
+    return o && get_priv_opt(avctx, name) & o->default_val.i64;
+}
+
+/**
+ * Return the number of pictures in the GOPs of an encoder with
+ * FF_CODEC_CAP_FRAME_THREADS_GOP if it can code them in separate threads,
+ * else 0.
+ */
+static int get_thread_gop_size(AVCodecContext *avctx)
+{
+    int64_t b_strategy, skip_threshold, skip_factor, noise_reduction;
+
+    if (!(avctx->codec->caps_internal & FF_CODEC_CAP_FRAME_THREADS_GOP))
+        return 0;
+
+    /* these encoders keep slice threads unless frame threads are asked for */
+    if (avctx->thread_type & FF_THREAD_SLICE)
+        return 0;
+
+    b_strategy      = get_priv_opt(avctx, "b_strategy");
+    skip_threshold  = get_priv_opt(avctx, "skip_threshold");
+    skip_factor     = get_priv_opt(avctx, "skip_factor");
+    noise_reduction = get_priv_opt(avctx, "noise_reduction");
+#if FF_API_PRIVATE_OPT
+FF_DISABLE_DEPRECATION_WARNINGS
+    if (avctx->b_frame_strategy)
+        b_strategy      = avctx->b_frame_strategy;
+    if (avctx->frame_skip_threshold)
+        skip_threshold  = avctx->frame_skip_threshold;
+    if (avctx->frame_skip_factor)
+        skip_factor     = avctx->frame_skip_factor;
+    if (avctx->noise_reduction)
+        noise_reduction = avctx->noise_reduction;
+FF_ENABLE_DEPRECATION_WARNINGS
+#endif
+
+    /* the rate control, two-pass, frame skipping and noise reduction states
+     * cannot be shared between the threads */
+    if (!(avctx->flags & AV_CODEC_FLAG_QSCALE) || avctx->rc_buffer_size ||
+        avctx->flags & (AV_CODEC_FLAG_PASS1 | AV_CODEC_FLAG_PASS2) ||
+        skip_threshold || skip_factor || noise_reduction)
+        return 0;
+
+    if (avctx->gop_size <= 1 && !avctx->max_b_frames)
+        return 1;
+
+    /* the GOPs must not refer to each other, closed GOPs also rule out scene
+     * change detection; B-frames must not cross the end of a GOP, which
+     * strict_gop ensures as long as the B-frame pattern is fixed */
+    if (!(avctx->flags & AV_CODEC_FLAG_CLOSED_GOP))
+        return 0;
+    if (avctx->max_b_frames &&
+        (b_strategy || !get_priv_flag(avctx, "mpv_flags", "strict_gop")))
+        return 0;
+
+    return avctx->gop_size;
+}
+
 int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
-    int i=0;
+    int i=0, gop_size;
     ThreadContext *c;
 
 
-    if(   !(avctx->thread_type & FF_THREAD_FRAME)
-       || !(avctx->codec->capabilities & AV_CODEC_CAP_INTRA_ONLY))
+    if (!(avctx->thread_type & FF_THREAD_FRAME))
+        return 0;
+
+    gop_size = get_thread_gop_size(avctx);
+    if(   !(avctx->codec->capabilities & AV_CODEC_CAP_INTRA_ONLY)
+       && !is_intra_only_config(avctx) && !gop_size)
         return 0;
 
     if(   !avctx->thread_count
@@ -179,6 +353,8 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
         return AVERROR(ENOMEM);
 
     c->parent_avctx = avctx;
+    c->gop_size     = gop_size;
+    c->last_pts     = AV_NOPTS_VALUE;
 
     c->task_fifo = av_fifo_alloc_array(BUFFER_SIZE, sizeof(Task));
     if(!c->task_fifo)
@@ -255,18 +431,28 @@ void ff_frame_thread_encoder_free(AVCodecContext *avctx){
         Task task;
         AVFrame *frame;
         av_fifo_generic_read(c->task_fifo, &task, sizeof(task), NULL);
+        if (c->gop_size) {
+            GOP *gop = task.indata;
+            free_gop(&gop);
+            continue;
+        }
         frame = task.indata;
         av_frame_free(&frame);
         task.indata = NULL;
     }
 
     for (i=0; i<BUFFER_SIZE; i++) {
-        if (c->finished_tasks[i].outdata != NULL) {
+        if (c->finished_tasks[i].outdata != NULL && c->gop_size) {
+            GOP *gop = c->finished_tasks[i].outdata;
+            free_gop(&gop);
+            c->finished_tasks[i].outdata = NULL;
+        } else if (c->finished_tasks[i].outdata != NULL) {
             AVPacket *pkt = c->finished_tasks[i].outdata;
             av_packet_free(&pkt);
             c->finished_tasks[i].outdata = NULL;
         }
     }
+    free_gop(&c->gop);
 
     pthread_mutex_destroy(&c->task_fifo_mutex);
     pthread_mutex_destroy(&c->finished_task_mutex);
@@ -277,6 +463,78 @@ void ff_frame_thread_encoder_free(AVCodecContext *avctx){
     av_freep(&avctx->internal->frame_thread_encoder);
 }
 
+static void submit_task(ThreadContext *c, void *indata)
+{
+    Task task = { .index = c->task_index, .indata = indata };
+
+    pthread_mutex_lock(&c->task_fifo_mutex);
+    av_fifo_generic_write(c->task_fifo, &task, sizeof(task), NULL);
+    pthread_cond_signal(&c->task_fifo_cond);
+    pthread_mutex_unlock(&c->task_fifo_mutex);
+
+    c->task_index = (c->task_index+1) % BUFFER_SIZE;
+}
+
+/**
+ * Add a picture to the GOP being filled. A GOP ends after gop_size pictures
+ * or before a forced keyframe, and is sent to a thread once the picture
+ * after it, whose pts the thread may need, is known.
+ */
+static int add_to_gop(ThreadContext *c, AVFrame *frame)
+{
+    if (c->gop && (c->gop->nb_frames == c->gop_size ||
+                   frame->pict_type == AV_PICTURE_TYPE_I)) {
+        c->gop->next_pts = frame->pts;
+        submit_task(c, c->gop);
+        c->gop = NULL;
+    }
+
+    if (!c->gop) {
+        GOP *gop = av_mallocz(sizeof(*gop));
+        if (!gop)
+            return AVERROR(ENOMEM);
+        gop->frames = av_malloc_array(c->gop_size, sizeof(*gop->frames));
+        if (!gop->frames) {
+            av_free(gop);
+            return AVERROR(ENOMEM);
+        }
+        gop->picture_number = c->frame_count;
+        gop->prev_pts       = c->last_pts;
+        gop->next_pts       = AV_NOPTS_VALUE;
+        c->gop = gop;
+
+        /* the thread does not know where the GOP of its previous pictures
+         * ended, make sure it starts a new one */
+        frame->pict_type = AV_PICTURE_TYPE_I;
+    }
+
+    c->gop->frames[c->gop->nb_frames++] = frame;
+    c->frame_count++;
+    c->last_pts = frame->pts;
+    return 0;
+}
+
+/* take the next packet of the oldest GOP, which is finished */
+static int64_t get_gop_packet(ThreadContext *c, AVPacket *pkt, int *got_packet_ptr)
+{
+    Task *task = &c->finished_tasks[c->finished_task_index];
+    GOP *gop = task->outdata;
+    int64_t ret = 0;
+
+    if (gop->next_pkt < gop->nb_pkts) {
+        *pkt = *gop->pkts[gop->next_pkt];
+        av_freep(&gop->pkts[gop->next_pkt++]);
+        *got_packet_ptr = 1;
+    }
+    if (gop->next_pkt == gop->nb_pkts) {
+        ret = task->return_code;
+        free_gop(&gop);
+        task->outdata = NULL;
+        c->finished_task_index = (c->finished_task_index+1) % BUFFER_SIZE;
+    }
+    return ret;
+}
+
 int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt, const AVFrame *frame, int *got_packet_ptr){
     ThreadContext *c = avctx->internal->frame_thread_encoder;
     Task task;
@@ -294,26 +552,40 @@ int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt, const AVF
             return ret;
         }
 
-        task.index = c->task_index;
-        task.indata = (void*)new;
-        pthread_mutex_lock(&c->task_fifo_mutex);
-        av_fifo_generic_write(c->task_fifo, &task, sizeof(task), NULL);
-        pthread_cond_signal(&c->task_fifo_cond);
-        pthread_mutex_unlock(&c->task_fifo_mutex);
-
-        c->task_index = (c->task_index+1) % BUFFER_SIZE;
+        if (c->gop_size) {
+            ret = add_to_gop(c, new);
+            if (ret < 0) {
+                av_frame_free(&new);
+                return ret;
+            }
+        } else
+            submit_task(c, new);
+    } else if (c->gop) {
+        submit_task(c, c->gop);
+        c->gop = NULL;
     }
 
     pthread_mutex_lock(&c->finished_task_mutex);
-    if (c->task_index == c->finished_task_index ||
-        (frame && !c->finished_tasks[c->finished_task_index].outdata &&
-         (c->task_index - c->finished_task_index) % BUFFER_SIZE <= avctx->thread_count)) {
+    while (1) {
+        if (c->task_index == c->finished_task_index ||
+            (frame && !c->finished_tasks[c->finished_task_index].outdata &&
+             (c->task_index - c->finished_task_index) % BUFFER_SIZE <= avctx->thread_count)) {
             pthread_mutex_unlock(&c->finished_task_mutex);
             return 0;
         }
 
-    while (!c->finished_tasks[c->finished_task_index].outdata) {
-        pthread_cond_wait(&c->finished_task_cond, &c->finished_task_mutex);
+        while (!c->finished_tasks[c->finished_task_index].outdata) {
+            pthread_cond_wait(&c->finished_task_cond, &c->finished_task_mutex);
+        }
+        if (!c->gop_size)
+            break;
+
+        /* a GOP without packets left must not end the flushing */
+        ret = get_gop_packet(c, pkt, got_packet_ptr);
+        if (*got_packet_ptr || ret < 0) {
+            pthread_mutex_unlock(&c->finished_task_mutex);
+            return ret;
+        }
     }
     task = c->finished_tasks[c->finished_task_index];
     *pkt = *(AVPacket*)(task.outdata);
@@ -68,6 +68,21 @@
  * Codec initializes slice-based threading with a main function
  */
 #define FF_CODEC_CAP_SLICE_THREAD_HAS_MF    (1 << 5)
+/**
+ * The encoder can be run by the frame thread encoder when it is configured
+ * to code every picture on its own: intra-only (gop_size <= 1), without
+ * B-frames or encoding delay and without state carried between pictures,
+ * like rate control or two-pass statistics.
+ */
+#define FF_CODEC_CAP_FRAME_THREADS_INTRA    (1 << 6)
+/**
+ * The encoder can be run by the frame thread encoder, one GOP per thread,
+ * when its GOPs are closed and have a fixed size (or it is intra-only) and
+ * no state like rate control or two-pass statistics is carried between
+ * them. Each thread gets the position of its GOPs through the gop_*
+ * fields of AVCodecInternal and is flushed after each of them.
+ */
+#define FF_CODEC_CAP_FRAME_THREADS_GOP      (1 << 7)
 
 #ifdef TRACE
 #   define ff_tlog(ctx, ...) av_log(ctx, AV_LOG_TRACE, __VA_ARGS__)
@@ -179,6 +194,18 @@ typedef struct AVCodecInternal {
 
     void *frame_thread_encoder;
 
+    /**
+     * Set by the frame thread encoder before it sends the first picture of
+     * a GOP to a thread of an encoder with FF_CODEC_CAP_FRAME_THREADS_GOP,
+     * reset by the encoder when it reads it. The GOP starts with the picture
+     * number gop_picture_number, the pictures before and after it have the
+     * timestamps gop_prev_pts and gop_next_pts, or AV_NOPTS_VALUE.
+     */
+    int gop_start;
+    int64_t gop_picture_number;
+    int64_t gop_prev_pts;
+    int64_t gop_next_pts;
+
     /**
      * Number of audio samples to skip at the start of the next decoded frame
      */
@@ -320,6 +320,37 @@ static inline int pix_abs8_c(MpegEncContext *v, uint8_t *pix1, uint8_t *pix2,
     return s;
 }
 
+#define PIX_ABS_X4(size)                                                      \
+static void pix_abs ## size ## _x4_c(MpegEncContext *v, uint8_t *pix1,        \
+                                     uint8_t *const pix2[4],                  \
+                                     ptrdiff_t stride, int h, int scores[4])  \
+{                                                                             \
+    const uint8_t *p0 = pix2[0], *p1 = pix2[1], *p2 = pix2[2], *p3 = pix2[3]; \
+    int s0 = 0, s1 = 0, s2 = 0, s3 = 0, i, j;                                 \
+                                                                              \
+    for (i = 0; i < h; i++) {                                                 \
+        for (j = 0; j < size; j++) {                                          \
+            const int p = pix1[j];                                            \
+            s0 += abs(p - p0[j]);                                             \
+            s1 += abs(p - p1[j]);                                             \
+            s2 += abs(p - p2[j]);                                             \
+            s3 += abs(p - p3[j]);                                             \
+        }                                                                     \
+        pix1 += stride;                                                       \
+        p0   += stride;                                                       \
+        p1   += stride;                                                       \
+        p2   += stride;                                                       \
+        p3   += stride;                                                       \
+    }                                                                         \
+    scores[0] = s0;                                                           \
+    scores[1] = s1;                                                           \
+    scores[2] = s2;                                                           \
+    scores[3] = s3;                                                           \
+}
+
+PIX_ABS_X4(16)
+PIX_ABS_X4(8)
+
 static inline int pix_median_abs8_c(MpegEncContext *v, uint8_t *pix1, uint8_t *pix2,
                              ptrdiff_t stride, int h)
 {
@@ -1062,6 +1093,8 @@ av_cold void ff_me_cmp_init(MECmpContext *c, AVCodecContext *avctx)
 #endif
     c->sad[0] = pix_abs16_c;
     c->sad[1] = pix_abs8_c;
+    c->sad_x4[0] = pix_abs16_x4_c;
+    c->sad_x4[1] = pix_abs8_x4_c;
     c->sse[0] = sse16_c;
     c->sse[1] = sse8_c;
     c->sse[2] = sse4_c;
@@ -1095,4 +1128,10 @@ av_cold void ff_me_cmp_init(MECmpContext *c, AVCodecContext *avctx)
 
     c->median_sad[0] = pix_median_abs16_c;
     c->median_sad[1] = pix_median_abs8_c;
+
+    /* four calls to an optimized sad are faster than the C sad_x4 */
+    if (c->sad_x4[0] == pix_abs16_x4_c && c->sad[0] != pix_abs16_c)
+        c->sad_x4[0] = NULL;
+    if (c->sad_x4[1] == pix_abs8_x4_c && c->sad[1] != pix_abs8_c)
+        c->sad_x4[1] = NULL;
 }
@@ -50,6 +50,13 @@ typedef int (*me_cmp_func)(struct MpegEncContext *c,
                            uint8_t *blk2 /* align 1 */, ptrdiff_t stride,
                            int h);
 
+/* Compare blk1 against four candidate blocks in one call, scores[i] gets
+ * the score of blk2[i]. Same size and alignment rules as me_cmp_func. */
+typedef void (*me_cmp_x4_func)(struct MpegEncContext *c,
+                               uint8_t *blk1 /* align width (8 or 16) */,
+                               uint8_t *const blk2[4] /* align 1 */,
+                               ptrdiff_t stride, int h, int scores[4]);
+
 typedef struct MECmpContext {
     int (*sum_abs_dctelem)(int16_t *block /* align 16 */);
 
@@ -77,6 +84,9 @@ typedef struct MECmpContext {
 
     me_cmp_func pix_abs[2][4];
     me_cmp_func median_sad[6];
+
+    me_cmp_x4_func sad_x4[2];
+    me_cmp_x4_func me_cmp_x4[2]; ///< me_cmp for 4 fullpel candidates, NULL if unavailable
 } MECmpContext;
 
 int ff_check_alignment(void);
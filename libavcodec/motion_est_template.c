@@ -34,9 +34,9 @@
     const int av_unused ymin= c->ymin;\
     const int av_unused xmax= c->xmax;\
     const int av_unused ymax= c->ymax;\
-    uint8_t *mv_penalty= c->current_mv_penalty;\
-    const int pred_x= c->pred_x;\
-    const int pred_y= c->pred_y;\
+    uint8_t av_unused *mv_penalty= c->current_mv_penalty;\
+    const int av_unused pred_x= c->pred_x;\
+    const int av_unused pred_y= c->pred_y;\
 
 #define CHECK_HALF_MV(dx, dy, x, y)\
 {\
@@ -383,24 +383,6 @@ static int qpel_motion_search(MpegEncContext * s,
     CHECK_MV(Lx2, Ly2)\
 }
 
-#define CHECK_MV_DIR(x,y,new_dir)\
-{\
-    const unsigned key = ((unsigned)(y)<<ME_MAP_MV_BITS) + (x) + map_generation;\
-    const int index= (((unsigned)(y)<<ME_MAP_SHIFT) + (x))&(ME_MAP_SIZE-1);\
-    if(map[index]!=key){\
-        d= cmp(s, x, y, 0, 0, size, h, ref_index, src_index, cmpf, chroma_cmpf, flags);\
-        map[index]= key;\
-        score_map[index]= d;\
-        d += (mv_penalty[(int)((unsigned)(x)<<shift)-pred_x] + mv_penalty[(int)((unsigned)(y)<<shift)-pred_y])*penalty_factor;\
-        if(d<dmin){\
-            best[0]=x;\
-            best[1]=y;\
-            dmin=d;\
-            next_dir= new_dir;\
-        }\
-    }\
-}
-
 #define check(x,y,S,v)\
 if( (x)<(xmin<<(S)) ) av_log(NULL, AV_LOG_ERROR, "%d %d %d %d %d xmin" #v, xmin, (x), (y), s->mb_x, s->mb_y);\
 if( (x)>(xmax<<(S)) ) av_log(NULL, AV_LOG_ERROR, "%d %d %d %d %d xmax" #v, xmax, (x), (y), s->mb_x, s->mb_y);\
@@ -412,6 +394,114 @@ if( (y)>(ymax<<(S)) ) av_log(NULL, AV_LOG_ERROR, "%d %d %d %d %d ymax" #v, ymax,
     const int qpel= flags&FLAG_QPEL;\
     const int shift= 1+qpel;\
 
+#define LOAD_CMP_X4\
+    me_cmp_x4_func cmp_x4= size < 2 && !(flags & (FLAG_DIRECT|FLAG_CHROMA)) ?\
+                           s->mecc.me_cmp_x4[size] : NULL;\
+
+#define ADD_MV(x,y)\
+{\
+    mv[n][0]= x;\
+    mv[n][1]= y;\
+    n++;\
+}
+
+#define ADD_CLIPPED_MV(ax,ay)\
+{\
+    const int Lx= ax;\
+    const int Ly= ay;\
+    ADD_MV(FFMAX(xmin, FFMIN(Lx, xmax)), FFMAX(ymin, FFMIN(Ly, ymax)))\
+}
+
+/**
+ * Check a list of fullpel candidates like CHECK_MV() does one by one, but
+ * score up to 4 of them per cmp_x4() call.
+ * Candidates are committed in order, so map, score_map and best end up
+ * exactly as with the sequential checks.
+ * @param cmp_x4 batched compare function, NULL to score each candidate
+ *               with cmpf and chroma_cmpf
+ * @return index of the last candidate that improved *dmin, -1 if none did
+ */
+static av_always_inline int check_mv_list(MpegEncContext *s, int *best, int *dmin,
+                                          int (*mv)[2], int n,
+                                          int src_index, int ref_index,
+                                          const int penalty_factor, int size, int h,
+                                          int flags, me_cmp_func cmpf,
+                                          me_cmp_func chroma_cmpf, me_cmp_x4_func cmp_x4)
+{
+    MotionEstContext * const c= &s->me;
+    const int stride= c->stride;
+    uint8_t * const src= c->src[src_index][0];
+    uint8_t * const ref= c->ref[ref_index][0];
+    unsigned map_generation = c->map_generation;
+    int ret= -1;
+    int start, i, j;
+    LOAD_COMMON
+    LOAD_COMMON2
+
+    for(start=0; start<n; start+=4){
+        const int end= FFMIN(start + 4, n);
+        uint8_t *blk[4];
+        unsigned keys[4];
+        int todo[4], indices[4], scores[4];
+        int nb_todo= 0;
+
+        for(i=start; i<end; i++){
+            const int x= mv[i][0];
+            const int y= mv[i][1];
+            const unsigned key = ((unsigned)y<<ME_MAP_MV_BITS) + x + map_generation;
+            const int index= (((unsigned)y<<ME_MAP_SHIFT) + x)&(ME_MAP_SIZE-1);
+            unsigned cur= map[index];
+
+            av_assert2(x >= xmin && x <= xmax && y >= ymin && y <= ymax);
+
+            /* an earlier candidate of this batch will have replaced the entry */
+            for(j=0; j<nb_todo; j++)
+                if(indices[j] == index)
+                    cur= keys[j];
+            if(cur == key)
+                continue;
+
+            blk[nb_todo]    = ref + x + y*stride;
+            keys[nb_todo]   = key;
+            indices[nb_todo]= index;
+            todo[nb_todo++] = i;
+        }
+        if(!nb_todo)
+            continue;
+
+        if(cmp_x4 && nb_todo > 1){
+            for(i=nb_todo; i<4; i++)
+                blk[i]= blk[0];
+            cmp_x4(s, src, blk, stride, h, scores);
+        }else{
+            for(i=0; i<nb_todo; i++)
+                scores[i]= cmp(s, mv[todo[i]][0], mv[todo[i]][1], 0, 0, size, h,
+                               ref_index, src_index, cmpf, chroma_cmpf, flags);
+        }
+
+        for(i=0; i<nb_todo; i++){
+            const int x= mv[todo[i]][0];
+            const int y= mv[todo[i]][1];
+            int d= scores[i];
+
+            map[indices[i]]= keys[i];
+            score_map[indices[i]]= d;
+            d += (mv_penalty[((x)*(1<<shift))-pred_x] + mv_penalty[((y)*(1<<shift))-pred_y])*penalty_factor;
+            if(d < *dmin){
+                *dmin= d;
+                best[0]= x;
+                best[1]= y;
+                ret= todo[i];
+            }
+        }
+    }
+    return ret;
+}
+
+#define CHECK_MV_LIST()\
+    check_mv_list(s, best, &dmin, mv, n, src_index, ref_index, penalty_factor,\
+                  size, h, flags, cmpf, chroma_cmpf, cmp_x4)
+
 static av_always_inline int small_diamond_search(MpegEncContext * s, int *best, int dmin,
                                        int src_index, int ref_index, const int penalty_factor,
                                        int size, int h, int flags)
@@ -420,7 +510,8 @@ static av_always_inline int small_diamond_search(MpegEncContext * s, int *best,
     me_cmp_func cmpf, chroma_cmpf;
     int next_dir=-1;
     LOAD_COMMON
-    LOAD_COMMON2
+    uint32_t *map= c->map;
+    LOAD_CMP_X4
     unsigned map_generation = c->map_generation;
 
     cmpf        = s->mecc.me_cmp[size];
@@ -436,20 +527,22 @@ static av_always_inline int small_diamond_search(MpegEncContext * s, int *best,
     }
 
     for(;;){
-        int d;
         const int dir= next_dir;
         const int x= best[0];
         const int y= best[1];
-        next_dir=-1;
+        int mv[4][2], dirs[4];
+        int n= 0, i;
 
-        if(dir!=2 && x>xmin) CHECK_MV_DIR(x-1, y  , 0)
-        if(dir!=3 && y>ymin) CHECK_MV_DIR(x  , y-1, 1)
-        if(dir!=0 && x<xmax) CHECK_MV_DIR(x+1, y  , 2)
-        if(dir!=1 && y<ymax) CHECK_MV_DIR(x  , y+1, 3)
+        if(dir!=2 && x>xmin){ dirs[n]= 0; ADD_MV(x-1, y  ) }
+        if(dir!=3 && y>ymin){ dirs[n]= 1; ADD_MV(x  , y-1) }
+        if(dir!=0 && x<xmax){ dirs[n]= 2; ADD_MV(x+1, y  ) }
+        if(dir!=1 && y<ymax){ dirs[n]= 3; ADD_MV(x  , y+1) }
 
-        if(next_dir==-1){
+        i= CHECK_MV_LIST();
+        if(i<0){
             return dmin;
         }
+        next_dir= dirs[i];
     }
 }
 
@@ -461,8 +554,7 @@ static int funny_diamond_search(MpegEncContext * s, int *best, int dmin,
     me_cmp_func cmpf, chroma_cmpf;
     int dia_size;
     LOAD_COMMON
-    LOAD_COMMON2
-    unsigned map_generation = c->map_generation;
+    LOAD_CMP_X4
 
     cmpf        = s->mecc.me_cmp[size];
     chroma_cmpf = s->mecc.me_cmp[size + 1];
@@ -481,12 +573,14 @@ static int funny_diamond_search(MpegEncContext * s, int *best, int dmin,
            continue;
 
         for(dir= 0; dir<dia_size; dir+=2){
-            int d;
-
-            CHECK_MV(x + dir           , y + dia_size - dir);
-            CHECK_MV(x + dia_size - dir, y - dir           );
-            CHECK_MV(x - dir           , y - dia_size + dir);
-            CHECK_MV(x - dia_size + dir, y + dir           );
+            int mv[4][2];
+            int n= 0;
+
+            ADD_MV(x + dir           , y + dia_size - dir);
+            ADD_MV(x + dia_size - dir, y - dir           );
+            ADD_MV(x - dir           , y - dia_size + dir);
+            ADD_MV(x - dia_size + dir, y + dir           );
+            CHECK_MV_LIST();
         }
 
         if(x!=best[0] || y!=best[1])
@@ -502,9 +596,8 @@ static int hex_search(MpegEncContext * s, int *best, int dmin,
     MotionEstContext * const c= &s->me;
     me_cmp_func cmpf, chroma_cmpf;
     LOAD_COMMON
-    LOAD_COMMON2
-    unsigned map_generation = c->map_generation;
-    int x,y,d;
+    LOAD_CMP_X4
+    int x,y;
     const int dec= dia_size & (dia_size-1);
 
     cmpf        = s->mecc.me_cmp[size];
@@ -512,17 +605,21 @@ static int hex_search(MpegEncContext * s, int *best, int dmin,
 
     for(;dia_size; dia_size= dec ? dia_size-1 : dia_size>>1){
         do{
+            int mv[6][2];
+            int n= 0;
+
             x= best[0];
             y= best[1];
 
-            CHECK_CLIPPED_MV(x  -dia_size    , y);
-            CHECK_CLIPPED_MV(x+  dia_size    , y);
-            CHECK_CLIPPED_MV(x+( dia_size>>1), y+dia_size);
-            CHECK_CLIPPED_MV(x+( dia_size>>1), y-dia_size);
+            ADD_CLIPPED_MV(x  -dia_size    , y);
+            ADD_CLIPPED_MV(x+  dia_size    , y);
+            ADD_CLIPPED_MV(x+( dia_size>>1), y+dia_size);
+            ADD_CLIPPED_MV(x+( dia_size>>1), y-dia_size);
             if(dia_size>1){
-                CHECK_CLIPPED_MV(x+(-dia_size>>1), y+dia_size);
-                CHECK_CLIPPED_MV(x+(-dia_size>>1), y-dia_size);
+                ADD_CLIPPED_MV(x+(-dia_size>>1), y+dia_size);
+                ADD_CLIPPED_MV(x+(-dia_size>>1), y-dia_size);
             }
+            CHECK_MV_LIST();
         }while(best[0] != x || best[1] != y);
     }
 
@@ -536,9 +633,9 @@ static int l2s_dia_search(MpegEncContext * s, int *best, int dmin,
     MotionEstContext * const c= &s->me;
     me_cmp_func cmpf, chroma_cmpf;
     LOAD_COMMON
-    LOAD_COMMON2
-    unsigned map_generation = c->map_generation;
-    int x,y,i,d;
+    LOAD_CMP_X4
+    int mv[8][2];
+    int x,y,i,n;
     int dia_size= c->dia_size&0xFF;
     const int dec= dia_size & (dia_size-1);
     static const int hex[8][2]={{-2, 0}, {-1,-1}, { 0,-2}, { 1,-1},
@@ -551,18 +648,22 @@ static int l2s_dia_search(MpegEncContext * s, int *best, int dmin,
         do{
             x= best[0];
             y= best[1];
+            n= 0;
             for(i=0; i<8; i++){
-                CHECK_CLIPPED_MV(x+hex[i][0]*dia_size, y+hex[i][1]*dia_size);
+                ADD_CLIPPED_MV(x+hex[i][0]*dia_size, y+hex[i][1]*dia_size);
             }
+            CHECK_MV_LIST();
         }while(best[0] != x || best[1] != y);
     }
 
     x= best[0];
     y= best[1];
-    CHECK_CLIPPED_MV(x+1, y);
-    CHECK_CLIPPED_MV(x, y+1);
-    CHECK_CLIPPED_MV(x-1, y);
-    CHECK_CLIPPED_MV(x, y-1);
+    n= 0;
+    ADD_CLIPPED_MV(x+1, y);
+    ADD_CLIPPED_MV(x, y+1);
+    ADD_CLIPPED_MV(x-1, y);
+    ADD_CLIPPED_MV(x, y-1);
+    CHECK_MV_LIST();
 
     return dmin;
 }
@@ -575,8 +676,10 @@ static int umh_search(MpegEncContext * s, int *best, int dmin,
     me_cmp_func cmpf, chroma_cmpf;
     LOAD_COMMON
     LOAD_COMMON2
+    LOAD_CMP_X4
     unsigned map_generation = c->map_generation;
-    int x,y,x2,y2, i, j, d;
+    int mv[25][2];
+    int x,y,x2,y2, i, j, n, d;
     const int dia_size= c->dia_size&0xFE;
     static const int hex[16][2]={{-4,-2}, {-4,-1}, {-4, 0}, {-4, 1}, {-4, 2},
                                  { 4,-2}, { 4,-1}, { 4, 0}, { 4, 1}, { 4, 2},
@@ -597,18 +700,22 @@ static int umh_search(MpegEncContext * s, int *best, int dmin,
 
     x= best[0];
     y= best[1];
+    n= 0;
     for(y2=FFMAX(y-2, ymin); y2<=FFMIN(y+2,ymax); y2++){
         for(x2=FFMAX(x-2, xmin); x2<=FFMIN(x+2,xmax); x2++){
-            CHECK_MV(x2, y2);
+            ADD_MV(x2, y2);
         }
     }
+    CHECK_MV_LIST();
 
 //FIXME prevent the CLIP stuff
 
     for(j=1; j<=dia_size/4; j++){
+        n= 0;
         for(i=0; i<16; i++){
-            CHECK_CLIPPED_MV(x+hex[i][0]*j, y+hex[i][1]*j);
+            ADD_CLIPPED_MV(x+hex[i][0]*j, y+hex[i][1]*j);
         }
+        CHECK_MV_LIST();
     }
 
     return hex_search(s, best, dmin, src_index, ref_index, penalty_factor, size, h, flags, 2);
@@ -873,14 +980,18 @@ static av_always_inline int epzs_motion_search_internal(MpegEncContext * s, int
     const int ref_mv_stride= s->mb_stride; //pass as arg  FIXME
     const int ref_mv_xy = s->mb_x + s->mb_y * ref_mv_stride; // add to last_mv before passing FIXME
     me_cmp_func cmpf, chroma_cmpf;
+    int mv[4][2];
+    int n= 0;
 
     LOAD_COMMON
     LOAD_COMMON2
+    LOAD_CMP_X4
 
     if(c->pre_pass){
         penalty_factor= c->pre_penalty_factor;
         cmpf           = s->mecc.me_pre_cmp[size];
         chroma_cmpf    = s->mecc.me_pre_cmp[size + 1];
+        cmp_x4         = NULL;
     }else{
         penalty_factor= c->penalty_factor;
         cmpf           = s->mecc.me_cmp[size];
@@ -915,10 +1026,11 @@ static av_always_inline int epzs_motion_search_internal(MpegEncContext * s, int
             return dmin;
         }
         CHECK_MV(    P_MEDIAN[0] >>shift ,    P_MEDIAN[1] >>shift)
-        CHECK_CLIPPED_MV((P_MEDIAN[0]>>shift)  , (P_MEDIAN[1]>>shift)-1)
-        CHECK_CLIPPED_MV((P_MEDIAN[0]>>shift)  , (P_MEDIAN[1]>>shift)+1)
-        CHECK_CLIPPED_MV((P_MEDIAN[0]>>shift)-1, (P_MEDIAN[1]>>shift)  )
-        CHECK_CLIPPED_MV((P_MEDIAN[0]>>shift)+1, (P_MEDIAN[1]>>shift)  )
+        ADD_CLIPPED_MV((P_MEDIAN[0]>>shift)  , (P_MEDIAN[1]>>shift)-1)
+        ADD_CLIPPED_MV((P_MEDIAN[0]>>shift)  , (P_MEDIAN[1]>>shift)+1)
+        ADD_CLIPPED_MV((P_MEDIAN[0]>>shift)-1, (P_MEDIAN[1]>>shift)  )
+        ADD_CLIPPED_MV((P_MEDIAN[0]>>shift)+1, (P_MEDIAN[1]>>shift)  )
+        CHECK_MV_LIST();
         CHECK_CLIPPED_MV((last_mv[ref_mv_xy][0]*ref_mv_scale + (1<<15))>>16,
                         (last_mv[ref_mv_xy][1]*ref_mv_scale + (1<<15))>>16)
         CHECK_MV(P_LEFT[0]    >>shift, P_LEFT[1]    >>shift)
@@ -1147,6 +1147,34 @@ static int alloc_picture(MpegEncContext *s, Picture *pic, int shared)
                             &s->linesize, &s->uvlinesize);
 }
 
+/**
+ * Set up the state the pictures before a GOP leave, when a frame thread gets
+ * a GOP which does not follow the pictures it coded before. The GOPs are
+ * closed and end with a reference picture, the picture before the GOP.
+ */
+static void start_thread_gop(MpegEncContext *s, int64_t pts)
+{
+    AVCodecInternal *avci = s->avctx->internal;
+
+    avci->gop_start = 0;
+
+    s->input_picture_number =
+    s->coded_picture_number = avci->gop_picture_number;
+    s->user_specified_pts   = avci->gop_prev_pts;
+    if (avci->gop_prev_pts != AV_NOPTS_VALUE) {
+        s->reordered_pts   = avci->gop_prev_pts;
+        s->last_non_b_time = avci->gop_prev_pts * s->avctx->time_base.num;
+        /* modulo_time_base of MPEG-4 is relative to the previous reference
+         * picture when there is no GOV header */
+        s->time_base       = FFUDIV(s->last_non_b_time, s->avctx->time_base.den);
+    }
+
+    /* the dts of the first picture needs the pts of the second one */
+    if (!avci->gop_picture_number && avci->gop_next_pts != AV_NOPTS_VALUE &&
+        pts != AV_NOPTS_VALUE && !s->low_delay)
+        s->dts_delta = avci->gop_next_pts - pts;
+}
+
 static int load_input_picture(MpegEncContext *s, const AVFrame *pic_arg)
 {
     Picture *pic = NULL;
@@ -1159,6 +1187,8 @@ static int load_input_picture(MpegEncContext *s, const AVFrame *pic_arg)
 
     if (pic_arg) {
         pts = pic_arg->pts;
+        if (s->avctx->internal->gop_start)
+            start_thread_gop(s, pts);
         display_picture_number = s->input_picture_number++;
 
         if (pts != AV_NOPTS_VALUE) {
@@ -3700,6 +3730,23 @@ static int encode_picture(MpegEncContext *s, int picture_number)
         s->q_chroma_intra_matrix16 = s->q_intra_matrix16;
     }
 
+    /* The motion estimation of a picture starts from the vectors and the
+     * f_code of the previous ones, reset them at closed GOPs to keep these
+     * independent of the GOPs before them. */
+    if (s->pict_type == AV_PICTURE_TYPE_I &&
+        (s->avctx->flags & AV_CODEC_FLAG_CLOSED_GOP)) {
+        int mv_table_size = ((s->mb_height + 2) * s->mb_stride + 1) *
+                            2 * sizeof(int16_t);
+
+        memset(s->p_mv_table_base,            0, mv_table_size);
+        memset(s->b_forw_mv_table_base,       0, mv_table_size);
+        memset(s->b_back_mv_table_base,       0, mv_table_size);
+        memset(s->b_bidir_forw_mv_table_base, 0, mv_table_size);
+        memset(s->b_bidir_back_mv_table_base, 0, mv_table_size);
+        memset(s->b_direct_mv_table_base,     0, mv_table_size);
+        s->f_code = s->b_code = 1;
+    }
+
     s->mb_intra=0; //for the rate distortion & bit compare functions
     for(i=1; i<context_count; i++){
         ret = ff_update_duplicate_context(s->thread_context[i], s);
@@ -26,6 +26,7 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/stereo3d.h"
 #include "libavutil/mastering_display_metadata.h"
+#include "libavutil/thread.h"
 
 #include "avcodec.h"
 #include "bytestream.h"
@@ -47,6 +48,14 @@ enum PNGImageState {
     PNG_ALLIMAGE = 1 << 1,
 };
 
+/* number of rows the inflate thread may run ahead of the unfilter thread */
+#define PNG_PIPELINE_ROWS 32
+
+typedef struct PNGIDATChunk {
+    const uint8_t *data;
+    int length;
+} PNGIDATChunk;
+
 typedef struct PNGDecContext {
     PNGDSPContext dsp;
     AVCodecContext *avctx;
@@ -92,6 +101,23 @@ typedef struct PNGDecContext {
     int pass_row_size; /* decompress row size of the current pass */
     int y;
     z_stream zstream;
+
+    /* slice threading: IDAT chunks are inflated on a worker thread while
+     * the calling thread unfilters the rows it has already produced */
+    PNGIDATChunk *idat;
+    unsigned int idat_size;
+    int nb_idat;
+    uint8_t *pipeline_buf;
+    unsigned int pipeline_buf_size;
+    int pipeline_stride;
+    int rows_inflated;
+    int rows_filtered;
+    int inflate_done;
+    int inflate_ret;
+#if HAVE_THREADS
+    pthread_mutex_t progress_mutex;
+    pthread_cond_t progress_cond;
+#endif
 } PNGDecContext;
 
 /* Mask to determine which pixels are valid in a pass */
@@ -242,6 +268,13 @@ void ff_add_png_paeth_prediction(uint8_t *dst, uint8_t *src, uint8_t *top,
         UNROLL1(3, op)                                                        \
     } else if (bpp == 4) {                                                    \
         UNROLL1(4, op)                                                        \
+    } else if (bpp == 6) {                                                    \
+        /* constant distance for 16-bit RGB(A) keeps the addressing simple */ \
+        for (; i < size; i++)                                                 \
+            dst[i] = op(dst[i - 6], src[i], last[i]);                         \
+    } else if (bpp == 8) {                                                    \
+        for (; i < size; i++)                                                 \
+            dst[i] = op(dst[i - 8], src[i], last[i]);                         \
     }                                                                         \
     for (; i < size; i++) {                                                   \
         dst[i] = op(dst[i - bpp], src[i], last[i]);                           \
@@ -280,8 +313,7 @@ static void png_filter_row(PNGDSPContext *dsp, uint8_t *dst, int filter_type,
             p      = (last[i] >> 1);
             dst[i] = p + src[i];
         }
-#define OP_AVG(x, s, l) (((((x) + (l)) >> 1) + (s)) & 0xff)
-        UNROLL_FILTER(OP_AVG);
+        dsp->add_avg_prediction(dst + i, src + i, last + i, size - i, bpp);
         break;
     case PNG_FILTER_VALUE_PAETH:
         for (i = 0; i < bpp; i++) {
@@ -290,8 +322,8 @@ static void png_filter_row(PNGDSPContext *dsp, uint8_t *dst, int filter_type,
         }
         if (bpp > 2 && size > 4) {
             /* would write off the end of the array if we let it process
-             * the last pixel with bpp=3 */
-            int w = (bpp & 3) ? size - 3 : size;
+             * the last pixel with bpp=3 or bpp=6 */
+            int w = (bpp & 3) ? size - bpp : size;
 
             if (w > i) {
                 dsp->add_paeth_prediction(dst + i, src + i, last + i, size - i, bpp);
@@ -431,6 +463,130 @@ static int png_decode_idat(PNGDecContext *s, int length)
     return 0;
 }
 
+#if HAVE_THREADS
+static uint8_t *png_pipeline_row(PNGDecContext *s, int y)
+{
+    /* keep crow_buf + 1 16-byte aligned as in the serial path */
+    return s->pipeline_buf + 15 + (y % PNG_PIPELINE_ROWS) * s->pipeline_stride;
+}
+
+static int png_inflate_rows(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    PNGDecContext *s = avctx->priv_data;
+    int chunk = 0, y, ret = 0;
+
+    s->zstream.avail_in = 0;
+    for (y = 0; y < s->cur_h; y++) {
+        pthread_mutex_lock(&s->progress_mutex);
+        while (y - s->rows_filtered >= PNG_PIPELINE_ROWS)
+            pthread_cond_wait(&s->progress_cond, &s->progress_mutex);
+        pthread_mutex_unlock(&s->progress_mutex);
+
+        s->zstream.next_out  = png_pipeline_row(s, y);
+        s->zstream.avail_out = s->crow_size;
+        while (s->zstream.avail_out > 0) {
+            if (!s->zstream.avail_in) {
+                if (chunk == s->nb_idat)
+                    break;
+                s->zstream.next_in  = (unsigned char *)s->idat[chunk].data;
+                s->zstream.avail_in = s->idat[chunk].length;
+                chunk++;
+                continue;
+            }
+            ret = inflate(&s->zstream, Z_PARTIAL_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END) {
+                av_log(avctx, AV_LOG_ERROR, "inflate returned error %d\n", ret);
+                ret = AVERROR_EXTERNAL;
+                goto end;
+            }
+            if (ret == Z_STREAM_END)
+                break;
+        }
+        /* truncated image, leave the remaining rows untouched */
+        if (s->zstream.avail_out > 0)
+            break;
+
+        pthread_mutex_lock(&s->progress_mutex);
+        s->rows_inflated++;
+        pthread_cond_signal(&s->progress_cond);
+        pthread_mutex_unlock(&s->progress_mutex);
+    }
+    ret = 0;
+
+end:
+    pthread_mutex_lock(&s->progress_mutex);
+    s->inflate_ret  = ret;
+    s->inflate_done = 1;
+    pthread_cond_signal(&s->progress_cond);
+    pthread_mutex_unlock(&s->progress_mutex);
+
+    return ret;
+}
+
+static int png_unfilter_rows(AVCodecContext *avctx)
+{
+    PNGDecContext *s = avctx->priv_data;
+    int y, avail;
+
+    for (y = 0; y < s->cur_h; y++) {
+        pthread_mutex_lock(&s->progress_mutex);
+        while (s->rows_inflated <= y && !s->inflate_done)
+            pthread_cond_wait(&s->progress_cond, &s->progress_mutex);
+        avail = s->rows_inflated > y;
+        pthread_mutex_unlock(&s->progress_mutex);
+        if (!avail)
+            break;
+
+        s->crow_buf = png_pipeline_row(s, y);
+        png_handle_row(s);
+
+        pthread_mutex_lock(&s->progress_mutex);
+        s->rows_filtered++;
+        pthread_cond_signal(&s->progress_cond);
+        pthread_mutex_unlock(&s->progress_mutex);
+    }
+
+    return 0;
+}
+
+/* decode the queued IDAT chunks, inflating and unfiltering concurrently */
+static int png_decode_idat_pipelined(AVCodecContext *avctx, PNGDecContext *s)
+{
+    size_t byte_depth = s->bit_depth > 8 ? 2 : 1;
+
+    s->pipeline_stride = FFALIGN(s->crow_size, 16);
+    av_fast_padded_malloc(&s->pipeline_buf, &s->pipeline_buf_size,
+                          PNG_PIPELINE_ROWS * s->pipeline_stride + 16);
+    if (!s->pipeline_buf)
+        return AVERROR(ENOMEM);
+
+    s->rows_inflated = 0;
+    s->rows_filtered = 0;
+    s->inflate_done  = 0;
+    s->inflate_ret   = 0;
+
+    /* set image to non-transparent bpp while decompressing */
+    if (s->has_trns && s->color_type != PNG_COLOR_TYPE_PALETTE)
+        s->bpp -= byte_depth;
+
+    ff_slice_thread_execute_with_mainfunc(avctx, png_inflate_rows, png_unfilter_rows,
+                                          NULL, NULL, 1);
+
+    if (s->has_trns && s->color_type != PNG_COLOR_TYPE_PALETTE)
+        s->bpp += byte_depth;
+
+    s->nb_idat  = 0;
+    s->crow_buf = NULL;
+
+    return s->inflate_ret;
+}
+#else
+static int png_decode_idat_pipelined(AVCodecContext *avctx, PNGDecContext *s)
+{
+    return AVERROR_BUG;
+}
+#endif
+
 static int decode_zbuf(AVBPrint *bp, const uint8_t *data,
                        const uint8_t *data_end)
 {
@@ -749,6 +905,20 @@ static int decode_idat_chunk(AVCodecContext *avctx, PNGDecContext *s,
 
     s->pic_state |= PNG_IDAT;
 
+    if (HAVE_THREADS && avctx->active_thread_type == FF_THREAD_SLICE &&
+        !s->interlace_type) {
+        PNGIDATChunk *idat = av_fast_realloc(s->idat, &s->idat_size,
+                                             (s->nb_idat + 1) * sizeof(*s->idat));
+        if (!idat)
+            return AVERROR(ENOMEM);
+        s->idat = idat;
+        s->idat[s->nb_idat].data   = s->gb.buffer;
+        s->idat[s->nb_idat].length = FFMIN(length, bytestream2_get_bytes_left(&s->gb));
+        s->nb_idat++;
+        bytestream2_skip(&s->gb, length + 4);
+        return 0;
+    }
+
     /* set image to non-transparent bpp while decompressing */
     if (s->has_trns && s->color_type != PNG_COLOR_TYPE_PALETTE)
         s->bpp -= byte_depth;
@@ -1173,6 +1343,8 @@ static int decode_frame_common(AVCodecContext *avctx, PNGDecContext *s,
     for (;;) {
         length = bytestream2_get_bytes_left(&s->gb);
         if (length <= 0) {
+            if (s->nb_idat && (ret = png_decode_idat_pipelined(avctx, s)) < 0)
+                goto fail;
 
             if (avctx->codec_id == AV_CODEC_ID_PNG &&
                 avctx->skip_frame == AVDISCARD_ALL) {
@@ -1204,6 +1376,11 @@ static int decode_frame_common(AVCodecContext *avctx, PNGDecContext *s,
             av_log(avctx, AV_LOG_DEBUG, "png: tag=%s length=%u\n",
                    av_fourcc2str(tag), length);
 
+        /* the IDAT sequence is over, run the queued chunks */
+        if (s->nb_idat && tag != MKTAG('I', 'D', 'A', 'T') &&
+            (ret = png_decode_idat_pipelined(avctx, s)) < 0)
+            goto fail;
+
         if (avctx->codec_id == AV_CODEC_ID_PNG &&
             avctx->skip_frame == AVDISCARD_ALL) {
             switch(tag) {
@@ -1432,6 +1609,7 @@ static int decode_frame_png(AVCodecContext *avctx,
     s->y = s->has_trns = 0;
     s->hdr_state = 0;
     s->pic_state = 0;
+    s->nb_idat = 0;
 
     /* init the zlib */
     s->zstream.zalloc = ff_png_zalloc;
@@ -1593,6 +1771,11 @@ static av_cold int png_dec_init(AVCodecContext *avctx)
         ff_pngdsp_init(&s->dsp);
     }
 
+#if HAVE_THREADS
+    pthread_mutex_init(&s->progress_mutex, NULL);
+    pthread_cond_init(&s->progress_cond, NULL);
+#endif
+
     return 0;
 }
 
@@ -1612,6 +1795,15 @@ static av_cold int png_dec_end(AVCodecContext *avctx)
     s->last_row_size = 0;
     av_freep(&s->tmp_row);
     s->tmp_row_size = 0;
+    av_freep(&s->idat);
+    s->idat_size = 0;
+    av_freep(&s->pipeline_buf);
+    s->pipeline_buf_size = 0;
+
+#if HAVE_THREADS
+    pthread_mutex_destroy(&s->progress_mutex);
+    pthread_cond_destroy(&s->progress_cond);
+#endif
 
     return 0;
 }
@@ -1645,7 +1837,9 @@ AVCodec ff_png_decoder = {
     .decode         = decode_frame_png,
     .init_thread_copy = ONLY_IF_THREADS_ENABLED(png_dec_init),
     .update_thread_context = ONLY_IF_THREADS_ENABLED(update_thread_context),
-    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS /*| AV_CODEC_CAP_DRAW_HORIZ_BAND*/,
-    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM | FF_CODEC_CAP_INIT_THREADSAFE,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS /*| AV_CODEC_CAP_DRAW_HORIZ_BAND*/,
+    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM | FF_CODEC_CAP_INIT_THREADSAFE |
+                      FF_CODEC_CAP_SLICE_THREAD_HAS_MF,
 };
 #endif
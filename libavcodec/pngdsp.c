@@ -20,6 +20,7 @@
  */
 
 #include "libavutil/attributes.h"
+#include "libavutil/avassert.h"
 #include "libavutil/common.h"
 #include "png.h"
 #include "pngdsp.h"
@@ -40,10 +41,41 @@ static void add_bytes_l2_c(uint8_t *dst, uint8_t *src1, uint8_t *src2, int w)
         dst[i] = src1[i] + src2[i];
 }
 
+static av_always_inline void add_avg_prediction(uint8_t *dst, uint8_t *src,
+                                                uint8_t *top, int w, int bpp)
+{
+    uint8_t prev[8];
+    int i, j;
+
+    /* keep the previous pixel in registers, one per channel */
+    for (j = 0; j < bpp; j++)
+        prev[j] = dst[j - bpp];
+    for (i = 0; i <= w - bpp; i += bpp)
+        for (j = 0; j < bpp; j++)
+            dst[i + j] = prev[j] = src[i + j] + ((prev[j] + top[i + j]) >> 1);
+    for (j = 0; i < w; i++, j++)
+        dst[i] = src[i] + ((prev[j] + top[i]) >> 1);
+}
+
+static void add_avg_prediction_c(uint8_t *dst, uint8_t *src, uint8_t *top,
+                                 int w, int bpp)
+{
+    switch (bpp) {
+    case 1: add_avg_prediction(dst, src, top, w, 1); break;
+    case 2: add_avg_prediction(dst, src, top, w, 2); break;
+    case 3: add_avg_prediction(dst, src, top, w, 3); break;
+    case 4: add_avg_prediction(dst, src, top, w, 4); break;
+    case 6: add_avg_prediction(dst, src, top, w, 6); break;
+    case 8: add_avg_prediction(dst, src, top, w, 8); break;
+    default: av_assert2(0);
+    }
+}
+
 av_cold void ff_pngdsp_init(PNGDSPContext *dsp)
 {
     dsp->add_bytes_l2         = add_bytes_l2_c;
     dsp->add_paeth_prediction = ff_add_png_paeth_prediction;
+    dsp->add_avg_prediction   = add_avg_prediction_c;
 
     if (ARCH_X86)
         ff_pngdsp_init_x86(dsp);
@@ -32,6 +32,10 @@ typedef struct PNGDSPContext {
     /* this might write to dst[w] */
     void (*add_paeth_prediction)(uint8_t *dst, uint8_t *src,
                                  uint8_t *top, int w, int bpp);
+
+    /* dst[-bpp..-1] must hold the previous pixel, bpp <= 8 */
+    void (*add_avg_prediction)(uint8_t *dst, uint8_t *src,
+                               uint8_t *top, int w, int bpp);
 } PNGDSPContext;
 
 void ff_pngdsp_init(PNGDSPContext *dsp);
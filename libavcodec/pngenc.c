@@ -22,6 +22,7 @@
 #include "avcodec.h"
 #include "internal.h"
 #include "bytestream.h"
+#include "deflate_mt.h"
 #include "lossless_videoencdsp.h"
 #include "png.h"
 #include "apng.h"
@@ -54,6 +55,7 @@ typedef struct PNGEncContext {
     uint8_t *bytestream_end;
 
     int filter_type;
+    int compression_level;
 
     z_stream zstream;
     uint8_t buf[IOBUF_SIZE];
@@ -289,6 +291,58 @@ static int png_write_row(AVCodecContext *avctx, const uint8_t *data, int size)
     return 0;
 }
 
+/* filter all rows up front, then deflate them as independent blocks */
+static int png_write_rows_mt(AVCodecContext *avctx, const AVFrame *p,
+                             uint8_t *crow_buf, int row_size)
+{
+    PNGEncContext *s = avctx->priv_data;
+    int64_t size     = (int64_t)(row_size + 1) * p->height;
+    uint8_t *rows = NULL, *zbuf = NULL, *ptr, *top = NULL, *crow;
+    int64_t zbuf_size;
+    int y, pos, ret;
+
+    if (size > INT_MAX)
+        return AVERROR(EINVAL);
+    zbuf_size = ff_deflate_mt_bound(avctx, size);
+    if (zbuf_size > INT_MAX)
+        return AVERROR(EINVAL);
+
+    rows = av_malloc(size);
+    zbuf = av_malloc(zbuf_size);
+    if (!rows || !zbuf) {
+        ret = AVERROR(ENOMEM);
+        goto the_end;
+    }
+
+    for (y = 0; y < p->height; y++) {
+        ptr  = p->data[0] + y * p->linesize[0];
+        crow = png_choose_filter(s, crow_buf, ptr, top,
+                                 row_size, s->bits_per_pixel >> 3);
+        memcpy(rows + y * (row_size + 1), crow, row_size + 1);
+        top  = ptr;
+    }
+
+    ret = ff_deflate_mt(avctx, zbuf, zbuf_size, rows, size,
+                        s->compression_level);
+    if (ret < 0)
+        goto the_end;
+
+    for (pos = 0; pos < ret; pos += IOBUF_SIZE) {
+        int len = FFMIN(ret - pos, IOBUF_SIZE);
+        if (s->bytestream_end - s->bytestream <= len + 100) {
+            ret = AVERROR(ENOSPC);
+            goto the_end;
+        }
+        png_write_image_data(avctx, zbuf + pos, len);
+    }
+    ret = 0;
+
+the_end:
+    av_freep(&rows);
+    av_freep(&zbuf);
+    return ret;
+}
+
 #define AV_WB32_PNG(buf, n) AV_WB32(buf, lrint((n) * 100000))
 static int png_get_chrm(enum AVColorPrimaries prim,  uint8_t *buf)
 {
@@ -483,6 +537,9 @@ static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
                     }
             }
         }
+    } else if (avctx->active_thread_type & FF_THREAD_SLICE) {
+        ret = png_write_rows_mt(avctx, pict, crow_buf, row_size);
+        goto the_end;
     } else {
         top = NULL;
         for (y = 0; y < pict->height; y++) {
@@ -1089,6 +1146,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     compression_level = avctx->compression_level == FF_COMPRESSION_DEFAULT
                       ? Z_DEFAULT_COMPRESSION
                       : av_clip(avctx->compression_level, 0, 9);
+    s->compression_level = compression_level;
     if (deflateInit2(&s->zstream, compression_level, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
         return -1;
 
@@ -1146,7 +1204,8 @@ AVCodec ff_png_encoder = {
     .init           = png_enc_init,
     .close          = png_enc_close,
     .encode2        = encode_png,
-    .capabilities   = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_INTRA_ONLY,
+    .capabilities   = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS |
+                      AV_CODEC_CAP_INTRA_ONLY,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_RGB24, AV_PIX_FMT_RGBA,
         AV_PIX_FMT_RGB48BE, AV_PIX_FMT_RGBA64BE,
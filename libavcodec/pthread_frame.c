@@ -729,7 +729,9 @@ int ff_frame_thread_init(AVCodecContext *avctx)
     int i, err = 0;
 
     if (!thread_count) {
-        int nb_cpus = av_cpu_count();
+        int nb_cpus = av_thread_pool_get_size();
+        if (!nb_cpus)
+            nb_cpus = av_cpu_count();
 #if FF_API_DEBUG_MV
         if ((avctx->debug & (FF_DEBUG_VIS_QP | FF_DEBUG_VIS_MB_TYPE)) || avctx->debug_mv)
             nb_cpus = 1;
@@ -36,6 +36,7 @@
 #include "libavutil/pixdesc.h"
 #include "avcodec.h"
 #include "bytestream.h"
+#include "deflate_mt.h"
 #include "internal.h"
 #include "lzw.h"
 #include "put_bits.h"
@@ -176,6 +177,10 @@ static int encode_strip(TiffEncoderContext *s, const int8_t *src,
     case TIFF_ADOBE_DEFLATE:
     {
         unsigned long zlen = s->buf_size - (*s->buf - s->buf_start);
+        if (CONFIG_DEFLATE_MT &&
+            s->avctx->active_thread_type & FF_THREAD_SLICE)
+            return ff_deflate_mt(s->avctx, dst, FFMIN(zlen, INT_MAX), src, n,
+                                 Z_DEFAULT_COMPRESSION);
         if (compress(dst, &zlen, src, n) != Z_OK) {
             av_log(s->avctx, AV_LOG_ERROR, "Compressing failed\n");
             return AVERROR_EXTERNAL;
@@ -582,7 +587,8 @@ AVCodec ff_tiff_encoder = {
     .priv_data_size = sizeof(TiffEncoderContext),
     .init           = encode_init,
     .close          = encode_close,
-    .capabilities   = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_INTRA_ONLY,
+    .capabilities   = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS |
+                      AV_CODEC_CAP_INTRA_ONLY,
     .encode2        = encode_frame,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_RGB24, AV_PIX_FMT_RGB48LE, AV_PIX_FMT_PAL8,
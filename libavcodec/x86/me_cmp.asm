@@ -524,6 +524,105 @@ SAD 8
 SAD 16
 INIT_XMM sse2
 SAD 16
+;------------------------------------------------------------------------------------------
+;void ff_sad_x4_<opt>(MpegEncContext *v, uint8_t *pix1, uint8_t *const pix2[4],
+;                     ptrdiff_t stride, int h, int scores[4]);
+;------------------------------------------------------------------------------------------
+; %1 = 8/16, %2 = score register, %3 = candidate pointer
+%macro SAD_X4_ROW 3
+%if mmsize == 32 ; two rows of 16 pixels
+    movu     xm5, [%3]
+    vinserti128 m5, m5, [%3+strideq], 1
+%elif %1 == 16
+    movu      m5, [%3]
+%else
+    movq      m5, [%3]
+    movhps    m5, [%3+strideq]
+%endif
+    psadbw    m5, m4
+    paddw    m%2, m5
+%endmacro
+
+;%1 = 8/16
+%macro SAD_X4 1
+cglobal sad%1_x4, 6, 10, 6, v, pix1, pix2, stride, h, scores, p0, p1, p2, p3
+    mov      p0q, [pix2q+0*gprsize]
+    mov      p1q, [pix2q+1*gprsize]
+    mov      p2q, [pix2q+2*gprsize]
+    mov      p3q, [pix2q+3*gprsize]
+    pxor      m0, m0
+    pxor      m1, m1
+    pxor      m2, m2
+    pxor      m3, m3
+
+align 16
+.loop:
+%if %1 == 16 && mmsize == 16
+    movu      m4, [pix1q]
+    SAD_X4_ROW %1, 0, p0q
+    SAD_X4_ROW %1, 1, p1q
+    SAD_X4_ROW %1, 2, p2q
+    SAD_X4_ROW %1, 3, p3q
+    add    pix1q, strideq
+    add      p0q, strideq
+    add      p1q, strideq
+    add      p2q, strideq
+    add      p3q, strideq
+    dec       hd
+%else ; two rows per iteration
+%if mmsize == 32
+    movu     xm4, [pix1q]
+    vinserti128 m4, m4, [pix1q+strideq], 1
+%else
+    movq      m4, [pix1q]
+    movhps    m4, [pix1q+strideq]
+%endif
+    SAD_X4_ROW %1, 0, p0q
+    SAD_X4_ROW %1, 1, p1q
+    SAD_X4_ROW %1, 2, p2q
+    SAD_X4_ROW %1, 3, p3q
+    lea    pix1q, [pix1q+strideq*2]
+    lea      p0q, [p0q+strideq*2]
+    lea      p1q, [p1q+strideq*2]
+    lea      p2q, [p2q+strideq*2]
+    lea      p3q, [p3q+strideq*2]
+    sub       hd, 2
+%endif
+    jg .loop
+
+%if mmsize == 32
+    vextracti128 xm4, m0, 1
+    vextracti128 xm5, m1, 1
+    paddd    xm0, xm4
+    paddd    xm1, xm5
+    vextracti128 xm4, m2, 1
+    vextracti128 xm5, m3, 1
+    paddd    xm2, xm4
+    paddd    xm3, xm5
+%endif
+    ; each register holds two partial sums in the low dword of its qwords,
+    ; interleave them to {s0, s1, s2, s3} for the low and high halves
+    pslldq   xm1, 4
+    pslldq   xm3, 4
+    por      xm0, xm1
+    por      xm2, xm3
+    mova     xm1, xm0
+    punpcklqdq xm0, xm2
+    punpckhqdq xm1, xm2
+    paddd    xm0, xm1
+    movu [scoresq], xm0
+    RET
+%endmacro
+
+%if ARCH_X86_64
+INIT_XMM sse2
+SAD_X4 8
+SAD_X4 16
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+SAD_X4 16
+%endif
+%endif
 
 ;------------------------------------------------------------------------------------------
 ;int ff_sad_x2_<opt>(MpegEncContext *v, uint8_t *pix1, uint8_t *pix2, ptrdiff_t stride, int h);
@@ -47,6 +47,12 @@ int ff_sad16_mmxext(MpegEncContext *v, uint8_t *pix1, uint8_t *pix2,
                     ptrdiff_t stride, int h);
 int ff_sad16_sse2(MpegEncContext *v, uint8_t *pix1, uint8_t *pix2,
                   ptrdiff_t stride, int h);
+void ff_sad8_x4_sse2(MpegEncContext *v, uint8_t *pix1, uint8_t *const pix2[4],
+                     ptrdiff_t stride, int h, int scores[4]);
+void ff_sad16_x4_sse2(MpegEncContext *v, uint8_t *pix1, uint8_t *const pix2[4],
+                      ptrdiff_t stride, int h, int scores[4]);
+void ff_sad16_x4_avx2(MpegEncContext *v, uint8_t *pix1, uint8_t *const pix2[4],
+                      ptrdiff_t stride, int h, int scores[4]);
 int ff_sad8_x2_mmxext(MpegEncContext *v, uint8_t *pix1, uint8_t *pix2,
                       ptrdiff_t stride, int h);
 int ff_sad16_x2_mmxext(MpegEncContext *v, uint8_t *pix1, uint8_t *pix2,
@@ -634,6 +640,10 @@ av_cold void ff_me_cmp_init_x86(MECmpContext *c, AVCodecContext *avctx)
             c->pix_abs[0][2] = ff_sad16_y2_sse2;
 
             c->vsad[4]       = ff_vsad_intra16_sse2;
+#if ARCH_X86_64
+            c->sad_x4[0]     = ff_sad16_x4_sse2;
+            c->sad_x4[1]     = ff_sad8_x4_sse2;
+#endif
             if (!(avctx->flags & AV_CODEC_FLAG_BITEXACT)) {
                 c->pix_abs[0][3] = ff_sad16_approx_xy2_sse2;
                 c->vsad[0]       = ff_vsad16_approx_sse2;
@@ -648,4 +658,9 @@ av_cold void ff_me_cmp_init_x86(MECmpContext *c, AVCodecContext *avctx)
         c->hadamard8_diff[1] = ff_hadamard8_diff_ssse3;
 #endif
     }
+
+#if ARCH_X86_64
+    if (EXTERNAL_AVX2_FAST(cpu_flags) && avctx->codec_id != AV_CODEC_ID_SNOW)
+        c->sad_x4[0] = ff_sad16_x4_avx2;
+#endif
 }
@@ -25,6 +25,7 @@
 
 SECTION_RODATA
 
+cextern pb_1
 cextern pw_255
 
 SECTION .text
@@ -169,5 +170,119 @@ cglobal add_png_paeth_prediction, 5, 7, %1, dst, src, top, w, bpp, end, cntr
 INIT_MMX mmxext
 ADD_PAETH_PRED_FN 0
 
-INIT_MMX ssse3
-ADD_PAETH_PRED_FN 0
+; %1 = load/store instruction, movd for bpp <= 4, movq for bpp <= 8
+%macro PAETH_XMM_LOOP 1
+    %1                  m0, [dstq]
+    %1                  m1, [topq+dstq]
+    punpcklbw           m0, m7
+    punpcklbw           m1, m7
+    add               dstq, bppq
+.loop_%1:
+    mova                m2, m1
+    %1                  m1, [topq+dstq]
+    mova                m3, m2
+    punpcklbw           m1, m7
+    mova                m4, m2
+    psubw               m3, m1
+    psubw               m4, m0
+    mova                m5, m3
+    paddw               m5, m4
+    pabsw               m3, m3
+    pabsw               m4, m4
+    pabsw               m5, m5
+    mova                m6, m4
+    pminsw              m6, m5
+    pcmpgtw             m3, m6
+    pcmpgtw             m4, m5
+    mova                m6, m4
+    pand                m4, m3
+    pandn               m6, m3
+    pandn               m3, m0
+    %1                  m0, [srcq+dstq]
+    pand                m6, m1
+    pand                m2, m4
+    punpcklbw           m0, m7
+    paddw               m0, m6
+    paddw               m3, m2
+    paddw               m0, m3
+    pand                m0, [pw_255]
+    packuswb            m3, m0, m0
+    %1              [dstq], m3
+    add               dstq, bppq
+    cmp               dstq, endq
+    jl .loop_%1
+%endmacro
+
+; a whole pixel fits in the low half of a register, so unlike the mmx
+; version there is a single pass; the last pixel is left to the caller
+; when a store would not fit (bpp 3 and 6)
+INIT_XMM ssse3
+cglobal add_png_paeth_prediction, 5, 6, 8, dst, src, top, w, bpp, end
+%if ARCH_X86_64
+    movsxd            bppq, bppd
+    movsxd              wq, wd
+%endif
+    sub               topq, dstq
+    sub               srcq, dstq
+    pxor                m7, m7
+    cmp               bppd, 4
+    jg .bpp8
+    lea               endq, [dstq+wq-3]
+    sub               dstq, bppq
+    PAETH_XMM_LOOP    movd
+    RET
+.bpp8:
+    lea               endq, [dstq+wq-7]
+    sub               dstq, bppq
+    PAETH_XMM_LOOP    movq
+    RET
+
+%if ARCH_X86_64
+; the prediction depends on the pixel to the left, so each iteration
+; handles one pixel; the floor of the average is pavgb minus the carry
+; of the rounding, (a ^ b) & 1
+INIT_XMM sse2
+cglobal add_png_avg_prediction, 5, 7, 5, dst, src, top, w, bpp, i, tmp
+    movsxd            bppq, bppd
+    movsxd              wq, wd
+    sub               topq, dstq
+    sub               srcq, dstq
+    add                 wq, dstq
+    lea                 iq, [wq-8]
+    cmp               dstq, iq
+    jg .scalar
+
+    mova                m3, [pb_1]
+    mov               tmpq, dstq
+    sub               tmpq, bppq
+    movq                m0, [tmpq]
+.loop:
+    movq                m1, [topq+dstq]
+    movq                m2, [srcq+dstq]
+    mova                m4, m0
+    pxor                m4, m1
+    pavgb               m0, m1
+    pand                m4, m3
+    psubb               m0, m4
+    paddb               m0, m2
+    movq            [dstq], m0
+    add               dstq, bppq
+    cmp               dstq, iq
+    jle .loop
+
+.scalar:
+    neg               bppq
+    jmp .end_s
+.loop_s:
+    movzx             tmpd, byte [dstq+bppq]
+    movzx               id, byte [topq+dstq]
+    add               tmpd, id
+    shr               tmpd, 1
+    add               tmpb, [srcq+dstq]
+    mov             [dstq], tmpb
+    inc               dstq
+.end_s:
+    cmp               dstq, wq
+    jl .loop_s
+    RET
+%endif
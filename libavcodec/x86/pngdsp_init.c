@@ -28,6 +28,8 @@ void ff_add_png_paeth_prediction_mmxext(uint8_t *dst, uint8_t *src,
                                         uint8_t *top, int w, int bpp);
 void ff_add_png_paeth_prediction_ssse3(uint8_t *dst, uint8_t *src,
                                        uint8_t *top, int w, int bpp);
+void ff_add_png_avg_prediction_sse2(uint8_t *dst, uint8_t *src,
+                                    uint8_t *top, int w, int bpp);
 void ff_add_bytes_l2_mmx (uint8_t *dst, uint8_t *src1,
                           uint8_t *src2, int w);
 void ff_add_bytes_l2_sse2(uint8_t *dst, uint8_t *src1,
@@ -43,8 +45,12 @@ av_cold void ff_pngdsp_init_x86(PNGDSPContext *dsp)
 #endif
     if (EXTERNAL_MMXEXT(cpu_flags))
         dsp->add_paeth_prediction = ff_add_png_paeth_prediction_mmxext;
-    if (EXTERNAL_SSE2(cpu_flags))
+    if (EXTERNAL_SSE2(cpu_flags)) {
         dsp->add_bytes_l2         = ff_add_bytes_l2_sse2;
+#if ARCH_X86_64
+        dsp->add_avg_prediction   = ff_add_png_avg_prediction_sse2;
+#endif
+    }
     if (EXTERNAL_SSSE3(cpu_flags))
         dsp->add_paeth_prediction = ff_add_png_paeth_prediction_ssse3;
 }
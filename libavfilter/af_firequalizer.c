@@ -62,6 +62,11 @@ typedef struct OverlapIndex {
     int overlap_idx;
 } OverlapIndex;
 
+typedef struct PartitionIndex {
+    int pos;        ///< number of samples of the current block already filtered
+    int fdl_idx;    ///< slot of the spectrum of the previous block
+} PartitionIndex;
+
 typedef struct FIREqualizerContext {
     const AVClass *class;
 
@@ -72,6 +77,10 @@ typedef struct FIREqualizerContext {
     FFTContext    *fft_ctx;
     RDFTContext   *cepstrum_rdft;
     RDFTContext   *cepstrum_irdft;
+    RDFTContext   **conv_rdft;
+    RDFTContext   **conv_irdft;
+    FFTContext    **conv_fft;
+    int           nb_channels;
     int           analysis_rdft_len;
     int           rdft_len;
     int           cepstrum_len;
@@ -83,6 +92,12 @@ typedef struct FIREqualizerContext {
     float         *cepstrum_buf;
     float         *conv_buf;
     OverlapIndex  *conv_idx;
+    float         *part_kernel_tmp_buf;
+    float         *part_kernel_buf;
+    float         *part_buf;
+    PartitionIndex *part_idx;
+    int           part_size;
+    int           nb_partitions;
     int           fir_len;
     int           nsamples_max;
     int64_t       next_pts;
@@ -104,6 +119,7 @@ typedef struct FIREqualizerContext {
     int           dumpscale;
     int           fft2;
     int           min_phase;
+    int           partition_size;
 
     int           nb_gain_entry;
     int           gain_entry_err;
@@ -141,6 +157,7 @@ static const AVOption firequalizer_options[] = {
     { "dumpscale", "set dump scale", OFFSET(dumpscale), AV_OPT_TYPE_INT, { .i64 = SCALE_LINLOG }, 0, NB_SCALE-1, FLAGS, "scale" },
     { "fft2", "set 2-channels fft", OFFSET(fft2), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
     { "min_phase", "set minimum phase mode", OFFSET(min_phase), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
+    { "partition_size", "set partition size for partitioned convolution", OFFSET(partition_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1 << (RDFT_BITS_MAX - 1), FLAGS },
     { NULL }
 };
 
@@ -148,6 +165,21 @@ AVFILTER_DEFINE_CLASS(firequalizer);
 
 static void common_uninit(FIREqualizerContext *s)
 {
+    int ch;
+
+    for (ch = 0; ch < s->nb_channels; ch++) {
+        if (s->conv_rdft)
+            av_rdft_end(s->conv_rdft[ch]);
+        if (s->conv_irdft)
+            av_rdft_end(s->conv_irdft[ch]);
+        if (s->conv_fft)
+            av_fft_end(s->conv_fft[ch]);
+    }
+    av_freep(&s->conv_rdft);
+    av_freep(&s->conv_irdft);
+    av_freep(&s->conv_fft);
+    s->nb_channels = 0;
+
     av_rdft_end(s->analysis_rdft);
     av_rdft_end(s->analysis_irdft);
     av_rdft_end(s->rdft);
@@ -167,6 +199,10 @@ static void common_uninit(FIREqualizerContext *s)
     av_freep(&s->cepstrum_buf);
     av_freep(&s->conv_buf);
     av_freep(&s->conv_idx);
+    av_freep(&s->part_kernel_tmp_buf);
+    av_freep(&s->part_kernel_buf);
+    av_freep(&s->part_buf);
+    av_freep(&s->part_idx);
 }
 
 static av_cold void uninit(AVFilterContext *ctx)
@@ -208,7 +244,8 @@ static int query_formats(AVFilterContext *ctx)
     return ff_set_common_samplerates(ctx, formats);
 }
 
-static void fast_convolute(FIREqualizerContext *av_restrict s, const float *av_restrict kernel_buf, float *av_restrict conv_buf,
+static void fast_convolute(FIREqualizerContext *av_restrict s, RDFTContext *rdft, RDFTContext *irdft,
+                           const float *av_restrict kernel_buf, float *av_restrict conv_buf,
                            OverlapIndex *av_restrict idx, float *av_restrict data, int nsamples)
 {
     if (nsamples <= s->nsamples_max) {
@@ -220,7 +257,7 @@ static void fast_convolute(FIREqualizerContext *av_restrict s, const float *av_r
         memset(buf, 0, center * sizeof(*data));
         memcpy(buf + center, data, nsamples * sizeof(*data));
         memset(buf + center + nsamples, 0, (s->rdft_len - nsamples - center) * sizeof(*data));
-        av_rdft_calc(s->rdft, buf);
+        av_rdft_calc(rdft, buf);
 
         buf[0] *= kernel_buf[0];
         buf[1] *= kernel_buf[s->rdft_len/2];
@@ -229,7 +266,7 @@ static void fast_convolute(FIREqualizerContext *av_restrict s, const float *av_r
             buf[2*k+1] *= kernel_buf[k];
         }
 
-        av_rdft_calc(s->irdft, buf);
+        av_rdft_calc(irdft, buf);
         for (k = 0; k < s->rdft_len - idx->overlap_idx; k++)
             buf[k] += obuf[k];
         memcpy(data, buf, nsamples * sizeof(*data));
@@ -237,16 +274,17 @@ static void fast_convolute(FIREqualizerContext *av_restrict s, const float *av_r
         idx->overlap_idx = nsamples;
     } else {
         while (nsamples > s->nsamples_max * 2) {
-            fast_convolute(s, kernel_buf, conv_buf, idx, data, s->nsamples_max);
+            fast_convolute(s, rdft, irdft, kernel_buf, conv_buf, idx, data, s->nsamples_max);
             data += s->nsamples_max;
             nsamples -= s->nsamples_max;
         }
-        fast_convolute(s, kernel_buf, conv_buf, idx, data, nsamples/2);
-        fast_convolute(s, kernel_buf, conv_buf, idx, data + nsamples/2, nsamples - nsamples/2);
+        fast_convolute(s, rdft, irdft, kernel_buf, conv_buf, idx, data, nsamples/2);
+        fast_convolute(s, rdft, irdft, kernel_buf, conv_buf, idx, data + nsamples/2, nsamples - nsamples/2);
     }
 }
 
-static void fast_convolute_nonlinear(FIREqualizerContext *av_restrict s, const float *av_restrict kernel_buf,
+static void fast_convolute_nonlinear(FIREqualizerContext *av_restrict s, RDFTContext *rdft, RDFTContext *irdft,
+                                     const float *av_restrict kernel_buf,
                                      float *av_restrict conv_buf, OverlapIndex *av_restrict idx,
                                      float *av_restrict data, int nsamples)
 {
@@ -257,7 +295,7 @@ static void fast_convolute_nonlinear(FIREqualizerContext *av_restrict s, const f
 
         memcpy(buf, data, nsamples * sizeof(*data));
         memset(buf + nsamples, 0, (s->rdft_len - nsamples) * sizeof(*data));
-        av_rdft_calc(s->rdft, buf);
+        av_rdft_calc(rdft, buf);
 
         buf[0] *= kernel_buf[0];
         buf[1] *= kernel_buf[1];
@@ -269,7 +307,7 @@ static void fast_convolute_nonlinear(FIREqualizerContext *av_restrict s, const f
             buf[k+1] = im;
         }
 
-        av_rdft_calc(s->irdft, buf);
+        av_rdft_calc(irdft, buf);
         for (k = 0; k < s->rdft_len - idx->overlap_idx; k++)
             buf[k] += obuf[k];
         memcpy(data, buf, nsamples * sizeof(*data));
@@ -277,16 +315,17 @@ static void fast_convolute_nonlinear(FIREqualizerContext *av_restrict s, const f
         idx->overlap_idx = nsamples;
     } else {
         while (nsamples > s->nsamples_max * 2) {
-            fast_convolute_nonlinear(s, kernel_buf, conv_buf, idx, data, s->nsamples_max);
+            fast_convolute_nonlinear(s, rdft, irdft, kernel_buf, conv_buf, idx, data, s->nsamples_max);
             data += s->nsamples_max;
             nsamples -= s->nsamples_max;
         }
-        fast_convolute_nonlinear(s, kernel_buf, conv_buf, idx, data, nsamples/2);
-        fast_convolute_nonlinear(s, kernel_buf, conv_buf, idx, data + nsamples/2, nsamples - nsamples/2);
+        fast_convolute_nonlinear(s, rdft, irdft, kernel_buf, conv_buf, idx, data, nsamples/2);
+        fast_convolute_nonlinear(s, rdft, irdft, kernel_buf, conv_buf, idx, data + nsamples/2, nsamples - nsamples/2);
     }
 }
 
-static void fast_convolute2(FIREqualizerContext *av_restrict s, const float *av_restrict kernel_buf, FFTComplex *av_restrict conv_buf,
+static void fast_convolute2(FIREqualizerContext *av_restrict s, FFTContext *fft_ctx,
+                            const float *av_restrict kernel_buf, FFTComplex *av_restrict conv_buf,
                             OverlapIndex *av_restrict idx, float *av_restrict data0, float *av_restrict data1, int nsamples)
 {
     if (nsamples <= s->nsamples_max) {
@@ -302,8 +341,8 @@ static void fast_convolute2(FIREqualizerContext *av_restrict s, const float *av_
             buf[center+k].im = data1[k];
         }
         memset(buf + center + nsamples, 0, (s->rdft_len - nsamples - center) * sizeof(*buf));
-        av_fft_permute(s->fft_ctx, buf);
-        av_fft_calc(s->fft_ctx, buf);
+        av_fft_permute(fft_ctx, buf);
+        av_fft_calc(fft_ctx, buf);
 
         /* swap re <-> im, do backward fft using forward fft_ctx */
         /* normalize with 0.5f */
@@ -323,8 +362,8 @@ static void fast_convolute2(FIREqualizerContext *av_restrict s, const float *av_
         buf[k].re = 0.5f * kernel_buf[k] * buf[k].im;
         buf[k].im = 0.5f * kernel_buf[k] * tmp;
 
-        av_fft_permute(s->fft_ctx, buf);
-        av_fft_calc(s->fft_ctx, buf);
+        av_fft_permute(fft_ctx, buf);
+        av_fft_calc(fft_ctx, buf);
 
         for (k = 0; k < s->rdft_len - idx->overlap_idx; k++) {
             buf[k].re += obuf[k].re;
@@ -340,13 +379,106 @@ static void fast_convolute2(FIREqualizerContext *av_restrict s, const float *av_
         idx->overlap_idx = nsamples;
     } else {
         while (nsamples > s->nsamples_max * 2) {
-            fast_convolute2(s, kernel_buf, conv_buf, idx, data0, data1, s->nsamples_max);
+            fast_convolute2(s, fft_ctx, kernel_buf, conv_buf, idx, data0, data1, s->nsamples_max);
             data0 += s->nsamples_max;
             data1 += s->nsamples_max;
             nsamples -= s->nsamples_max;
         }
-        fast_convolute2(s, kernel_buf, conv_buf, idx, data0, data1, nsamples/2);
-        fast_convolute2(s, kernel_buf, conv_buf, idx, data0 + nsamples/2, data1 + nsamples/2, nsamples - nsamples/2);
+        fast_convolute2(s, fft_ctx, kernel_buf, conv_buf, idx, data0, data1, nsamples/2);
+        fast_convolute2(s, fft_ctx, kernel_buf, conv_buf, idx, data0 + nsamples/2, data1 + nsamples/2, nsamples - nsamples/2);
+    }
+}
+
+/* dst = acc + x * h, with x and h in the packed rdft layout */
+static void cmul_add(float *dst, const float *acc, const float *av_restrict x,
+                     const float *av_restrict h, int len)
+{
+    int k;
+
+    dst[0] = acc[0] + x[0] * h[0];
+    dst[1] = acc[1] + x[1] * h[1];
+    for (k = 2; k < len; k += 2) {
+        float re = acc[k]   + x[k] * h[k]   - x[k+1] * h[k+1];
+        float im = acc[k+1] + x[k] * h[k+1] + x[k+1] * h[k];
+        dst[k]   = re;
+        dst[k+1] = im;
+    }
+}
+
+/*
+ * Uniformly partitioned overlap-save convolution. The kernel is split in
+ * nb_partitions blocks of part_size taps, and the spectra of the last
+ * nb_partitions - 1 input blocks are kept in a frequency domain delay line.
+ * Input that does not fill a block is filtered right away with the block
+ * zero padded, so the filter adds no latency with frames of any size;
+ * frames of part_size samples are the cheapest.
+ */
+static void partitioned_convolute(FIREqualizerContext *av_restrict s, RDFTContext *rdft, RDFTContext *irdft,
+                                  const float *av_restrict kernel_buf, float *av_restrict part_buf,
+                                  PartitionIndex *av_restrict idx, float *av_restrict data, int nsamples)
+{
+    const int part_size = s->part_size, len = 2 * part_size;
+    const int nb_slots = s->nb_partitions - 1;
+    float *in  = part_buf;
+    float *buf = part_buf + len;
+    float *sum = part_buf + 2 * len;
+    float *out = part_buf + 3 * len;
+    float *fdl = part_buf + 4 * len;
+    int k;
+
+    while (nsamples > 0) {
+        const int n = FFMIN(nsamples, part_size - idx->pos);
+
+        if (!idx->pos) {
+            /* the older blocks contribute the same to the whole block */
+            memset(sum, 0, len * sizeof(*sum));
+            for (k = 1; k <= nb_slots; k++)
+                cmul_add(sum, sum, fdl + (idx->fdl_idx + k - 1) % nb_slots * len,
+                         kernel_buf + k * len, len);
+        }
+
+        memcpy(in + part_size + idx->pos, data, n * sizeof(*data));
+        memcpy(buf, in, (part_size + idx->pos + n) * sizeof(*buf));
+        memset(buf + part_size + idx->pos + n, 0, (part_size - idx->pos - n) * sizeof(*buf));
+        av_rdft_calc(rdft, buf);
+
+        cmul_add(out, sum, buf, kernel_buf, len);
+        av_rdft_calc(irdft, out);
+        memcpy(data, out + part_size + idx->pos, n * sizeof(*data));
+
+        idx->pos += n;
+        data     += n;
+        nsamples -= n;
+
+        if (idx->pos == part_size) {
+            if (nb_slots) {
+                idx->fdl_idx = (idx->fdl_idx + nb_slots - 1) % nb_slots;
+                memcpy(fdl + idx->fdl_idx * len, buf, len * sizeof(*buf));
+            }
+            memcpy(in, in + part_size, part_size * sizeof(*in));
+            idx->pos = 0;
+        }
+    }
+}
+
+/*
+ * Split the kernel in rdft_buf, still in the time domain, into the
+ * partitions used by partitioned_convolute().
+ */
+static void generate_partition_kernel(FIREqualizerContext *s, const float *rdft_buf, float *part_kernel)
+{
+    const int len = 2 * s->part_size;
+    const int offset = s->min_phase ? 0 : s->rdft_len - s->fir_len / 2;
+    const float scale = (float)s->rdft_len / len;
+    int i, k;
+
+    for (i = 0; i < s->nb_partitions; i++) {
+        float *buf = part_kernel + i * len;
+
+        memset(buf, 0, len * sizeof(*buf));
+        for (k = 0; k < s->part_size && i * s->part_size + k < s->fir_len; k++)
+            buf[k] = rdft_buf[(i * s->part_size + k + offset) % s->rdft_len] * scale;
+        av_rdft_calc(s->conv_rdft[0], buf);
     }
 }
 
@@ -717,6 +849,9 @@ static int generate_kernel(AVFilterContext *ctx, const char *gain, const char *g
         memcpy(rdft_buf + s->rdft_len/2, s->analysis_buf + s->analysis_rdft_len - s->rdft_len/2, s->rdft_len/2 * sizeof(*s->analysis_buf));
         if (s->min_phase)
             generate_min_phase_kernel(s, rdft_buf);
+        if (s->part_size)
+            generate_partition_kernel(s, rdft_buf, s->part_kernel_tmp_buf +
+                                      ch * s->nb_partitions * 2 * s->part_size);
         av_rdft_calc(s->rdft, rdft_buf);
 
         for (k = 0; k < s->rdft_len; k++) {
@@ -744,6 +879,9 @@ static int generate_kernel(AVFilterContext *ctx, const char *gain, const char *g
     }
 
     memcpy(s->kernel_buf, s->kernel_tmp_buf, (s->multi ? inlink->channels : 1) * s->rdft_len * sizeof(*s->kernel_buf));
+    if (s->part_size)
+        memcpy(s->part_kernel_buf, s->part_kernel_tmp_buf, (s->multi ? inlink->channels : 1) *
+               s->nb_partitions * 2 * s->part_size * sizeof(*s->part_kernel_buf));
     av_expr_free(gain_expr);
     if (dump_fp)
         fclose(dump_fp);
@@ -757,7 +895,7 @@ static int config_input(AVFilterLink *inlink)
 {
     AVFilterContext *ctx = inlink->dst;
     FIREqualizerContext *s = ctx->priv;
-    int rdft_bits;
+    int rdft_bits, part_bits, ch;
 
     common_uninit(s);
 
@@ -782,8 +920,35 @@ static int config_input(AVFilterLink *inlink)
     if (!(s->rdft = av_rdft_init(rdft_bits, DFT_R2C)) || !(s->irdft = av_rdft_init(rdft_bits, IDFT_C2R)))
         return AVERROR(ENOMEM);
 
-    if (s->fft2 && !s->multi && inlink->channels > 1 && !(s->fft_ctx = av_fft_init(rdft_bits, 0)))
+    s->part_size = 0;
+    if (s->partition_size) {
+        for (part_bits = RDFT_BITS_MIN; part_bits < RDFT_BITS_MAX && 1 << (part_bits - 1) < s->partition_size; part_bits++);
+        s->part_size = 1 << (part_bits - 1);
+        s->nb_partitions = (s->fir_len + s->part_size - 1) / s->part_size;
+    } else if (s->fft2 && !s->multi && !s->min_phase && inlink->channels > 1 &&
+               !(s->fft_ctx = av_fft_init(rdft_bits, 0))) {
         return AVERROR(ENOMEM);
+    }
+
+    /* the transforms keep state while running, every channel needs its own */
+    s->conv_rdft  = av_calloc(inlink->channels, sizeof(*s->conv_rdft));
+    s->conv_irdft = av_calloc(inlink->channels, sizeof(*s->conv_irdft));
+    s->conv_fft   = av_calloc(inlink->channels, sizeof(*s->conv_fft));
+    if (!s->conv_rdft || !s->conv_irdft || !s->conv_fft)
+        return AVERROR(ENOMEM);
+    s->nb_channels = inlink->channels;
+    for (ch = 0; ch < inlink->channels; ch++) {
+        if (s->fft_ctx && !(ch & 1) && ch + 1 < inlink->channels) {
+            if (!(s->conv_fft[ch] = av_fft_init(rdft_bits, 0)))
+                return AVERROR(ENOMEM);
+        } else {
+            int bits = s->part_size ? part_bits : rdft_bits;
+            s->conv_rdft[ch]  = av_rdft_init(bits, DFT_R2C);
+            s->conv_irdft[ch] = av_rdft_init(bits, IDFT_C2R);
+            if (!s->conv_rdft[ch] || !s->conv_irdft[ch])
+                return AVERROR(ENOMEM);
+        }
+    }
 
     if (s->min_phase) {
         int cepstrum_bits = rdft_bits + 2;
@@ -831,40 +996,64 @@ static int config_input(AVFilterLink *inlink)
     if (!s->analysis_buf || !s->kernel_tmp_buf || !s->kernel_buf || !s->conv_buf || !s->conv_idx)
         return AVERROR(ENOMEM);
 
+    if (s->part_size) {
+        int kernel_size = (s->multi ? inlink->channels : 1) * s->nb_partitions * 2 * s->part_size;
+
+        s->part_kernel_tmp_buf = av_malloc_array(kernel_size, sizeof(*s->part_kernel_tmp_buf));
+        s->part_kernel_buf = av_malloc_array(kernel_size, sizeof(*s->part_kernel_buf));
+        s->part_buf = av_calloc(inlink->channels * (s->nb_partitions + 3) * 2 * s->part_size, sizeof(*s->part_buf));
+        s->part_idx = av_calloc(inlink->channels, sizeof(*s->part_idx));
+        if (!s->part_kernel_tmp_buf || !s->part_kernel_buf || !s->part_buf || !s->part_idx)
+            return AVERROR(ENOMEM);
+        av_log(ctx, AV_LOG_DEBUG, "partition_size = %d, nb_partitions = %d.\n", s->part_size, s->nb_partitions);
+    }
+
     av_log(ctx, AV_LOG_DEBUG, "sample_rate = %d, channels = %d, analysis_rdft_len = %d, rdft_len = %d, fir_len = %d, nsamples_max = %d.\n",
            inlink->sample_rate, inlink->channels, s->analysis_rdft_len, s->rdft_len, s->fir_len, s->nsamples_max);
 
     if (s->fixed)
-        inlink->min_samples = inlink->max_samples = inlink->partial_buf_size = s->nsamples_max;
+        inlink->min_samples = inlink->max_samples = inlink->partial_buf_size =
+            s->part_size ? s->part_size : s->nsamples_max;
 
     return generate_kernel(ctx, SELECT_GAIN(s), SELECT_GAIN_ENTRY(s));
 }
 
+static int convolute_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FIREqualizerContext *s = ctx->priv;
+    AVFrame *frame = arg;
+    int ch = s->fft_ctx ? 2 * jobnr : jobnr;
+    const float *kernel_buf = s->kernel_buf + (s->multi ? ch * s->rdft_len : 0);
+    float *conv_buf = s->conv_buf + 2 * ch * s->rdft_len;
+    float *data = (float *) frame->extended_data[ch];
+
+    if (s->part_size) {
+        partitioned_convolute(s, s->conv_rdft[ch], s->conv_irdft[ch],
+                              s->part_kernel_buf + (s->multi ? ch * s->nb_partitions * 2 * s->part_size : 0),
+                              s->part_buf + ch * (s->nb_partitions + 3) * 2 * s->part_size,
+                              s->part_idx + ch, data, frame->nb_samples);
+    } else if (s->min_phase) {
+        fast_convolute_nonlinear(s, s->conv_rdft[ch], s->conv_irdft[ch], kernel_buf,
+                                 conv_buf, s->conv_idx + ch, data, frame->nb_samples);
+    } else if (s->conv_fft[ch]) {
+        fast_convolute2(s, s->conv_fft[ch], s->kernel_buf, (FFTComplex *) conv_buf,
+                        s->conv_idx + ch, data, (float *) frame->extended_data[ch+1],
+                        frame->nb_samples);
+    } else {
+        fast_convolute(s, s->conv_rdft[ch], s->conv_irdft[ch], kernel_buf,
+                       conv_buf, s->conv_idx + ch, data, frame->nb_samples);
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
 {
     AVFilterContext *ctx = inlink->dst;
     FIREqualizerContext *s = ctx->priv;
-    int ch;
+    int nb_jobs = s->fft_ctx ? (inlink->channels + 1) / 2 : inlink->channels;
 
-    if (!s->min_phase) {
-        for (ch = 0; ch + 1 < inlink->channels && s->fft_ctx; ch += 2) {
-            fast_convolute2(s, s->kernel_buf, (FFTComplex *)(s->conv_buf + 2 * ch * s->rdft_len),
-                            s->conv_idx + ch, (float *) frame->extended_data[ch],
-                            (float *) frame->extended_data[ch+1], frame->nb_samples);
-        }
-
-        for ( ; ch < inlink->channels; ch++) {
-            fast_convolute(s, s->kernel_buf + (s->multi ? ch * s->rdft_len : 0),
-                        s->conv_buf + 2 * ch * s->rdft_len, s->conv_idx + ch,
-                        (float *) frame->extended_data[ch], frame->nb_samples);
-        }
-    } else {
-        for (ch = 0; ch < inlink->channels; ch++) {
-            fast_convolute_nonlinear(s, s->kernel_buf + (s->multi ? ch * s->rdft_len : 0),
-                                     s->conv_buf + 2 * ch * s->rdft_len, s->conv_idx + ch,
-                                     (float *) frame->extended_data[ch], frame->nb_samples);
-        }
-    }
+    ctx->internal->execute(ctx, convolute_channel, frame, NULL, nb_jobs);
 
     s->next_pts = AV_NOPTS_VALUE;
     if (frame->pts != AV_NOPTS_VALUE) {
@@ -977,4 +1166,5 @@ AVFilter ff_af_firequalizer = {
     .inputs             = firequalizer_inputs,
     .outputs            = firequalizer_outputs,
     .priv_class         = &firequalizer_class,
+    .flags              = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -24,6 +24,12 @@
  */
 
 #include "dnn_backend_native.h"
+#include "libavutil/time.h"
+
+// Number of output pixels whose input patches are gathered at once.
+#define CONV_TILE_W 32
+
+static void convolve_worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads);
 
 static DNNReturnType set_input_output_native(void *model, DNNData *input, DNNData *output)
 {
@@ -89,11 +95,67 @@ static DNNReturnType set_input_output_native(void *model, DNNData *input, DNNDat
     return DNN_SUCCESS;
 }
 
+static void pack_kernel(ConvolutionalParams *conv_params)
+{
+    int n_filter, ch, kernel_y, kernel_x;
+    int filter_linesize = conv_params->kernel_size * conv_params->input_num;
+    int filter_size = conv_params->kernel_size * filter_linesize;
+    float *dst = conv_params->packed_kernel;
+
+    for (n_filter = 0; n_filter < conv_params->output_num; ++n_filter){
+        for (ch = 0; ch < conv_params->input_num; ++ch){
+            for (kernel_y = 0; kernel_y < conv_params->kernel_size; ++kernel_y){
+                for (kernel_x = 0; kernel_x < conv_params->kernel_size; ++kernel_x){
+                    *dst++ = conv_params->kernel[n_filter * filter_size + kernel_y * filter_linesize +
+                                                 kernel_x * conv_params->input_num + ch];
+                }
+            }
+        }
+    }
+}
+
+// Allocates what the execution of the network needs besides the layer outputs.
+static int init_execution(ConvolutionalNetwork *network, int nb_threads)
+{
+    ConvolutionalParams *conv_params;
+    int32_t layer;
+    int patch_size, max_patch_size = 0;
+
+    for (layer = 1; layer < network->layers_num; ++layer){
+        if (network->layers[layer].type == CONV){
+            conv_params = (ConvolutionalParams *)network->layers[layer].params;
+            patch_size = conv_params->input_num * conv_params->kernel_size * conv_params->kernel_size;
+            conv_params->packed_kernel = av_malloc_array(patch_size, conv_params->output_num * sizeof(float));
+            if (!conv_params->packed_kernel){
+                return AVERROR(ENOMEM);
+            }
+            pack_kernel(conv_params);
+            max_patch_size = FFMAX(max_patch_size, patch_size);
+        }
+    }
+
+    network->nb_threads = avpriv_slicethread_create(&network->slicethread, network,
+                                                    convolve_worker, NULL, nb_threads);
+    if (network->nb_threads <= 1){
+        avpriv_slicethread_free(&network->slicethread);
+        network->nb_threads = 1;
+    }
+
+    network->patches_size = CONV_TILE_W * max_patch_size;
+    network->patches = av_malloc_array(network->nb_threads, network->patches_size * sizeof(float));
+    network->layer_time = av_mallocz_array(network->layers_num, sizeof(*network->layer_time));
+    if (!network->patches || !network->layer_time){
+        return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
 // Loads model and its parameters that are stored in a binary file with following structure:
 // layers_num,layer_type,layer_parameterss,layer_type,layer_parameters...
 // For CONV layer: activation_function, input_num, output_num, kernel_size, kernel, biases
 // For DEPTH_TO_SPACE layer: block_size
-DNNModel *ff_dnn_load_model_native(const char *model_filename)
+DNNModel *ff_dnn_load_model_native(const char *model_filename, int nb_threads)
 {
     DNNModel *model = NULL;
     ConvolutionalNetwork *network = NULL;
@@ -115,7 +177,7 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename)
     }
     file_size = avio_size(model_file_context);
 
-    network = av_malloc(sizeof(ConvolutionalNetwork));
+    network = av_mallocz(sizeof(ConvolutionalNetwork));
     if (!network){
         avio_closep(&model_file_context);
         av_freep(&model);
@@ -151,7 +213,7 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename)
         dnn_size += 4;
         switch (layer_type){
         case CONV:
-            conv_params = av_malloc(sizeof(ConvolutionalParams));
+            conv_params = av_mallocz(sizeof(ConvolutionalParams));
             if (!conv_params){
                 avio_closep(&model_file_context);
                 ff_dnn_free_model_native(&model);
@@ -212,6 +274,11 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename)
         return NULL;
     }
 
+    if (init_execution(network, nb_threads) < 0){
+        ff_dnn_free_model_native(&model);
+        return NULL;
+    }
+
     model->set_input_output = &set_input_output_native;
 
     return model;
@@ -219,44 +286,150 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename)
 
 #define CLAMP_TO_EDGE(x, w) ((x) < 0 ? 0 : ((x) >= (w) ? (w - 1) : (x)))
 
-static void convolve(const float *input, float *output, const ConvolutionalParams *conv_params, int width, int height)
+static av_always_inline float activate(float x, DNNActivationFunc activation)
+{
+    switch (activation){
+    case RELU:
+        return FFMAX(x, 0.0);
+    case TANH:
+        return 2.0f  / (1.0f + exp(-2.0f * x)) - 1.0f;
+    case SIGMOID:
+        return 1.0f / (1.0f + exp(-x));
+    }
+    return x;
+}
+
+// Multiplies the patches of nb_pixels output pixels by the packed kernel.
+// Every output is computed as bias + sum of products in the order of the
+// patch, as a direct convolution would, 4 pixels times 4 filters at once.
+static void convolve_patches(const float *patches, float *output,
+                             const ConvolutionalParams *conv_params, int nb_pixels)
 {
-    int y, x, n_filter, ch, kernel_y, kernel_x;
+    const int patch_size = conv_params->input_num * conv_params->kernel_size * conv_params->kernel_size;
+    const int output_num = conv_params->output_num;
+    const float *kernel = conv_params->packed_kernel;
+    int pixel, n_filter, i, j, k;
+
+    for (pixel = 0; pixel + 4 <= nb_pixels; pixel += 4){
+        const float *patch = patches + pixel * patch_size;
+        float *out = output + pixel * output_num;
+
+        for (n_filter = 0; n_filter + 4 <= output_num; n_filter += 4){
+            const float *filter = kernel + n_filter * patch_size;
+            float sum[4][4];
+
+            for (i = 0; i < 4; ++i){
+                for (j = 0; j < 4; ++j){
+                    sum[i][j] = conv_params->biases[n_filter + j];
+                }
+            }
+            for (k = 0; k < patch_size; ++k){
+                for (i = 0; i < 4; ++i){
+                    for (j = 0; j < 4; ++j){
+                        sum[i][j] += patch[i * patch_size + k] * filter[j * patch_size + k];
+                    }
+                }
+            }
+            for (i = 0; i < 4; ++i){
+                for (j = 0; j < 4; ++j){
+                    out[i * output_num + n_filter + j] = sum[i][j];
+                }
+            }
+        }
+        for (; n_filter < output_num; ++n_filter){
+            const float *filter = kernel + n_filter * patch_size;
+            float sum[4];
+
+            for (i = 0; i < 4; ++i){
+                sum[i] = conv_params->biases[n_filter];
+            }
+            for (k = 0; k < patch_size; ++k){
+                for (i = 0; i < 4; ++i){
+                    sum[i] += patch[i * patch_size + k] * filter[k];
+                }
+            }
+            for (i = 0; i < 4; ++i){
+                out[i * output_num + n_filter] = sum[i];
+            }
+        }
+    }
+    for (; pixel < nb_pixels; ++pixel){
+        const float *patch = patches + pixel * patch_size;
+
+        for (n_filter = 0; n_filter < output_num; ++n_filter){
+            const float *filter = kernel + n_filter * patch_size;
+            float sum = conv_params->biases[n_filter];
+
+            for (k = 0; k < patch_size; ++k){
+                sum += patch[k] * filter[k];
+            }
+            output[pixel * output_num + n_filter] = sum;
+        }
+    }
+
+    for (i = 0; i < nb_pixels * output_num; ++i){
+        output[i] = activate(output[i], conv_params->activation);
+    }
+}
+
+// Computes the output rows y_start to y_end - 1, gathering the input patches
+// of CONV_TILE_W output pixels at once into patches (im2col).
+static void convolve(const float *input, float *output, const ConvolutionalParams *conv_params,
+                     int width, int height, int y_start, int y_end, float *patches)
+{
+    int y, x, x0, nb_pixels, ch, kernel_y, kernel_x;
     int radius = conv_params->kernel_size >> 1;
     int src_linesize = width * conv_params->input_num;
-    int filter_linesize = conv_params->kernel_size * conv_params->input_num;
-    int filter_size = conv_params->kernel_size * filter_linesize;
+    float *patch;
 
-    for (y = 0; y < height; ++y){
-        for (x = 0; x < width; ++x){
-            for (n_filter = 0; n_filter < conv_params->output_num; ++n_filter){
-                output[n_filter] = conv_params->biases[n_filter];
+    output += y_start * width * conv_params->output_num;
+    for (y = y_start; y < y_end; ++y){
+        for (x0 = 0; x0 < width; x0 += CONV_TILE_W){
+            nb_pixels = FFMIN(CONV_TILE_W, width - x0);
+            patch = patches;
+            for (x = x0; x < x0 + nb_pixels; ++x){
                 for (ch = 0; ch < conv_params->input_num; ++ch){
                     for (kernel_y = 0; kernel_y < conv_params->kernel_size; ++kernel_y){
+                        const float *src = input + CLAMP_TO_EDGE(y + kernel_y - radius, height) * src_linesize + ch;
                         for (kernel_x = 0; kernel_x < conv_params->kernel_size; ++kernel_x){
-                            output[n_filter] += input[CLAMP_TO_EDGE(y + kernel_y - radius, height) * src_linesize +
-                                                      CLAMP_TO_EDGE(x + kernel_x - radius, width) * conv_params->input_num + ch] *
-                                                conv_params->kernel[n_filter * filter_size + kernel_y * filter_linesize +
-                                                                    kernel_x * conv_params->input_num + ch];
+                            *patch++ = src[CLAMP_TO_EDGE(x + kernel_x - radius, width) * conv_params->input_num];
                         }
                     }
                 }
-                switch (conv_params->activation){
-                case RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0);
-                    break;
-                case TANH:
-                    output[n_filter] = 2.0f  / (1.0f + exp(-2.0f * output[n_filter])) - 1.0f;
-                    break;
-                case SIGMOID:
-                    output[n_filter] = 1.0f / (1.0f + exp(-output[n_filter]));
-                }
             }
-            output += conv_params->output_num;
+            convolve_patches(patches, output, conv_params, nb_pixels);
+            output += nb_pixels * conv_params->output_num;
         }
     }
 }
 
+static void convolve_worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ConvolutionalNetwork *network = priv;
+    int height = network->conv_height;
+    int slice_start = (height *  jobnr     ) / nb_jobs;
+    int slice_end   = (height * (jobnr + 1)) / nb_jobs;
+
+    convolve(network->conv_input, network->conv_output, network->conv_params,
+             network->conv_width, height, slice_start, slice_end,
+             network->patches + threadnr * network->patches_size);
+}
+
+static void execute_convolution(ConvolutionalNetwork *network, const float *input, float *output,
+                                const ConvolutionalParams *conv_params, int width, int height)
+{
+    if (!network->slicethread){
+        convolve(input, output, conv_params, width, height, 0, height, network->patches);
+        return;
+    }
+    network->conv_input  = input;
+    network->conv_output = output;
+    network->conv_params = conv_params;
+    network->conv_width  = width;
+    network->conv_height = height;
+    avpriv_slicethread_execute(network->slicethread, FFMIN(height, network->nb_threads), 0);
+}
+
 static void depth_to_space(const float *input, float *output, int block_size, int width, int height, int channels)
 {
     int y, x, by, bx, ch;
@@ -288,6 +461,7 @@ DNNReturnType ff_dnn_execute_model_native(const DNNModel *model)
     InputParams *input_params;
     ConvolutionalParams *conv_params;
     DepthToSpaceParams *depth_to_space_params;
+    int64_t time;
 
     if (network->layers_num <= 0 || network->layers[0].type != INPUT || !network->layers[0].output){
         return DNN_ERROR;
@@ -303,10 +477,12 @@ DNNReturnType ff_dnn_execute_model_native(const DNNModel *model)
         if (!network->layers[layer].output){
             return DNN_ERROR;
         }
+        time = av_gettime_relative();
         switch (network->layers[layer].type){
         case CONV:
             conv_params = (ConvolutionalParams *)network->layers[layer].params;
-            convolve(network->layers[layer - 1].output, network->layers[layer].output, conv_params, cur_width, cur_height);
+            execute_convolution(network, network->layers[layer - 1].output, network->layers[layer].output,
+                                conv_params, cur_width, cur_height);
             cur_channels = conv_params->output_num;
             break;
         case DEPTH_TO_SPACE:
@@ -320,11 +496,35 @@ DNNReturnType ff_dnn_execute_model_native(const DNNModel *model)
         case INPUT:
             return DNN_ERROR;
         }
+        network->layer_time[layer] += av_gettime_relative() - time;
     }
+    network->nb_runs++;
 
     return DNN_SUCCESS;
 }
 
+static void log_layer_times(const ConvolutionalNetwork *network)
+{
+    const ConvolutionalParams *conv_params;
+    int32_t layer;
+
+    if (!network->nb_runs || !network->layer_time){
+        return;
+    }
+    for (layer = 1; layer < network->layers_num; ++layer){
+        double time = network->layer_time[layer] / (1000.0 * network->nb_runs);
+        if (network->layers[layer].type == CONV){
+            conv_params = (const ConvolutionalParams *)network->layers[layer].params;
+            av_log(NULL, AV_LOG_VERBOSE, "DNN layer %d: conv %dx%d %d->%d, %.3f ms per run\n",
+                   layer, conv_params->kernel_size, conv_params->kernel_size,
+                   conv_params->input_num, conv_params->output_num, time);
+        }
+        else{
+            av_log(NULL, AV_LOG_VERBOSE, "DNN layer %d: depth to space, %.3f ms per run\n", layer, time);
+        }
+    }
+}
+
 void ff_dnn_free_model_native(DNNModel **model)
 {
     ConvolutionalNetwork *network;
@@ -334,12 +534,17 @@ void ff_dnn_free_model_native(DNNModel **model)
     if (*model)
     {
         network = (ConvolutionalNetwork *)(*model)->model;
+        log_layer_times(network);
+        avpriv_slicethread_free(&network->slicethread);
+        av_freep(&network->patches);
+        av_freep(&network->layer_time);
         for (layer = 0; layer < network->layers_num; ++layer){
             av_freep(&network->layers[layer].output);
             if (network->layers[layer].type == CONV){
                 conv_params = (ConvolutionalParams *)network->layers[layer].params;
                 av_freep(&conv_params->kernel);
                 av_freep(&conv_params->biases);
+                av_freep(&conv_params->packed_kernel);
             }
             av_freep(&network->layers[layer].params);
         }
@@ -29,6 +29,7 @@
 
 #include "dnn_interface.h"
 #include "libavformat/avio.h"
+#include "libavutil/slicethread.h"
 
 typedef enum {INPUT, CONV, DEPTH_TO_SPACE} DNNLayerType;
 
@@ -45,6 +46,9 @@ typedef struct ConvolutionalParams{
     DNNActivationFunc activation;
     float *kernel;
     float *biases;
+    // Kernel with the weights of every filter in input channel major order,
+    // in the order they are summed.
+    float *packed_kernel;
 } ConvolutionalParams;
 
 typedef struct InputParams{
@@ -59,9 +63,22 @@ typedef struct DepthToSpaceParams{
 typedef struct ConvolutionalNetwork{
     Layer *layers;
     int32_t layers_num;
+    AVSliceThread *slicethread;
+    int nb_threads;
+    // Per thread buffers for the input patches of a tile of output pixels.
+    float *patches;
+    int patches_size;
+    // Convolution being executed by the slice threads.
+    const float *conv_input;
+    float *conv_output;
+    const ConvolutionalParams *conv_params;
+    int conv_width, conv_height;
+    // Time spent in every layer, in microseconds.
+    int64_t *layer_time;
+    int nb_runs;
 } ConvolutionalNetwork;
 
-DNNModel *ff_dnn_load_model_native(const char *model_filename);
+DNNModel *ff_dnn_load_model_native(const char *model_filename, int nb_threads);
 
 DNNReturnType ff_dnn_execute_model_native(const DNNModel *model);
 
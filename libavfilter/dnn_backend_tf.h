@@ -29,7 +29,7 @@
 
 #include "dnn_interface.h"
 
-DNNModel *ff_dnn_load_model_tf(const char *model_filename);
+DNNModel *ff_dnn_load_model_tf(const char *model_filename, int nb_threads);
 
 DNNReturnType ff_dnn_execute_model_tf(const DNNModel *model);
 
@@ -45,8 +45,9 @@ typedef struct DNNModel{
 
 // Stores pointers to functions for loading, executing, freeing DNN models for one of the backends.
 typedef struct DNNModule{
-    // Loads model and parameters from given file. Returns NULL if it is not possible.
-    DNNModel *(*load_model)(const char *model_filename);
+    // Loads model and parameters from given file, to be run with up to nb_threads
+    // threads, 0 for automatic. Returns NULL if it is not possible.
+    DNNModel *(*load_model)(const char *model_filename, int nb_threads);
     // Executes model with specified input and output. Returns DNN_ERROR otherwise.
     DNNReturnType (*execute_model)(const DNNModel *model);
     // Frees memory allocated for model.
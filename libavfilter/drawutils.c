@@ -594,6 +594,35 @@ static void blend_line_hv16(uint8_t *dst, int dst_delta,
                       right, hband, hsub + vsub, xm);
 }
 
+/* blend_pixel() on a whole line, for 8 bits masks */
+static void blend_line_mask8(uint8_t *dst, int dst_delta,
+                             unsigned src, unsigned alpha,
+                             const uint8_t *mask, int mask_linesize, int w,
+                             unsigned hsub, unsigned vsub, int hband)
+{
+    unsigned shift = hsub + vsub;
+    int x, xs, y;
+
+    for (x = 0; x < w; x++) {
+        const uint8_t *m = mask + (x << hsub);
+        unsigned t = 0, a;
+
+        if (!shift) {
+            t = *m;
+        } else {
+            for (y = 0; y < hband; y++, m += mask_linesize)
+                for (xs = 0; xs < 1 << hsub; xs++)
+                    t += m[xs];
+        }
+        /* a transparent mask leaves the pixel untouched */
+        if (t) {
+            a = (t >> shift) * alpha;
+            *dst = ((0x1010101 - a) * *dst + a * src) >> 24;
+        }
+        dst += dst_delta;
+    }
+}
+
 static void blend_line_hv(uint8_t *dst, int dst_delta,
                           unsigned src, unsigned alpha,
                           const uint8_t *mask, int mask_linesize, int l2depth, int w,
@@ -608,6 +637,13 @@ static void blend_line_hv(uint8_t *dst, int dst_delta,
         dst += dst_delta;
         xm += left;
     }
+    if (l2depth == 3) {
+        blend_line_mask8(dst, dst_delta, src, alpha, mask + xm, mask_linesize,
+                         w, hsub, vsub, hband);
+        dst += w * dst_delta;
+        xm += w << hsub;
+        w = 0;
+    }
     for (x = 0; x < w; x++) {
         blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
                     1 << hsub, hband, hsub + vsub, xm);
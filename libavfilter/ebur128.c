@@ -46,6 +46,7 @@
 #include <float.h>
 #include <limits.h>
 #include <math.h>               /* You may have to define _USE_MATH_DEFINES if you use MSVC */
+#include <string.h>
 
 #include "libavutil/common.h"
 #include "libavutil/mem.h"
@@ -78,12 +79,10 @@ struct FFEBUR128StateInternal {
     int *channel_map;
     /** How many samples fit in 100ms (rounded). */
     unsigned long samples_in_100ms;
-    /** BS.1770 filter coefficients (nominator). */
-    double b[5];
-    /** BS.1770 filter coefficients (denominator). */
-    double a[5];
-    /** BS.1770 filter state. */
-    double v[5][5];
+    /** BS.1770 filter coefficients. */
+    FFEBUR128KFilter kfilter;
+    /** BS.1770 filter state, one per channel. */
+    double *kfilter_state;
     /** Histograms, used to calculate LRA. */
     unsigned long *block_energy_histogram;
     unsigned long *short_term_block_energy_histogram;
@@ -103,8 +102,6 @@ static DECLARE_ALIGNED(32, double, histogram_energy_boundaries)[1001];
 
 static void ebur128_init_filter(FFEBUR128State * st)
 {
-    int i, j;
-
     double f0 = 1681.974450955533;
     double G = 3.999843853973347;
     double Q = 0.7071752369554196;
@@ -132,23 +129,10 @@ static void ebur128_init_filter(FFEBUR128State * st)
     ra[1] = 2.0 * (K * K - 1.0) / (1.0 + K / Q + K * K);
     ra[2] = (1.0 - K / Q + K * K) / (1.0 + K / Q + K * K);
 
-    st->d->b[0] = pb[0] * rb[0];
-    st->d->b[1] = pb[0] * rb[1] + pb[1] * rb[0];
-    st->d->b[2] = pb[0] * rb[2] + pb[1] * rb[1] + pb[2] * rb[0];
-    st->d->b[3] = pb[1] * rb[2] + pb[2] * rb[1];
-    st->d->b[4] = pb[2] * rb[2];
-
-    st->d->a[0] = pa[0] * ra[0];
-    st->d->a[1] = pa[0] * ra[1] + pa[1] * ra[0];
-    st->d->a[2] = pa[0] * ra[2] + pa[1] * ra[1] + pa[2] * ra[0];
-    st->d->a[3] = pa[1] * ra[2] + pa[2] * ra[1];
-    st->d->a[4] = pa[2] * ra[2];
-
-    for (i = 0; i < 5; ++i) {
-        for (j = 0; j < 5; ++j) {
-            st->d->v[i][j] = 0.0;
-        }
-    }
+    memcpy(st->d->kfilter.b[0], pb, sizeof(pb));
+    memcpy(st->d->kfilter.a[0], pa, sizeof(pa));
+    memcpy(st->d->kfilter.b[1], rb, sizeof(rb));
+    memcpy(st->d->kfilter.a[1], ra, sizeof(ra));
 }
 
 static int ebur128_init_channel_map(FFEBUR128State * st)
@@ -256,11 +240,15 @@ FFEBUR128State *ff_ebur128_init(unsigned int channels,
                                     st->channels * sizeof(double));
     CHECK_ERROR(!st->d->audio_data, 0, free_sample_peak)
 
+    st->d->kfilter_state =
+        (double *) av_mallocz_array(channels,
+                                    FF_EBUR128_KFILTER_STATE * sizeof(double));
+    CHECK_ERROR(!st->d->kfilter_state, 0, free_audio_data)
     ebur128_init_filter(st);
 
     st->d->block_energy_histogram =
         av_mallocz(1000 * sizeof(unsigned long));
-    CHECK_ERROR(!st->d->block_energy_histogram, 0, free_audio_data)
+    CHECK_ERROR(!st->d->block_energy_histogram, 0, free_kfilter_state)
     st->d->short_term_block_energy_histogram =
         av_mallocz(1000 * sizeof(unsigned long));
     CHECK_ERROR(!st->d->short_term_block_energy_histogram, 0,
@@ -285,6 +273,8 @@ free_short_term_block_energy_histogram:
     av_free(st->d->short_term_block_energy_histogram);
 free_block_energy_histogram:
     av_free(st->d->block_energy_histogram);
+free_kfilter_state:
+    av_free(st->d->kfilter_state);
 free_audio_data:
     av_free(st->d->audio_data);
 free_sample_peak:
@@ -304,6 +294,7 @@ void ff_ebur128_destroy(FFEBUR128State ** st)
     av_free((*st)->d->block_energy_histogram);
     av_free((*st)->d->short_term_block_energy_histogram);
     av_free((*st)->d->audio_data);
+    av_free((*st)->d->kfilter_state);
     av_free((*st)->d->channel_map);
     av_free((*st)->d->sample_peak);
     av_free((*st)->d->data_ptrs);
@@ -312,6 +303,52 @@ void ff_ebur128_destroy(FFEBUR128State ** st)
     *st = NULL;
 }
 
+#define FLUSH_DENORMAL(x) (fabs(x) < DBL_MIN ? 0.0 : (x))
+
+#define EBUR128_KWEIGHT(type, scaling_factor)                                      \
+static void ebur128_kweight_##type(const FFEBUR128KFilter *f, double *state,       \
+                                   double *dst, ptrdiff_t dst_stride,              \
+                                   const type *src, ptrdiff_t src_stride,          \
+                                   size_t frames) {                                \
+    const double scale = 1.0 / (scaling_factor);                                   \
+    const double pb0 = f->b[0][0], pb1 = f->b[0][1], pb2 = f->b[0][2];             \
+    const double pa1 = f->a[0][1], pa2 = f->a[0][2];                               \
+    const double rb0 = f->b[1][0], rb1 = f->b[1][1], rb2 = f->b[1][2];             \
+    const double ra1 = f->a[1][1], ra2 = f->a[1][2];                               \
+    double x1 = state[0], x2 = state[1];                                           \
+    double y1 = state[2], y2 = state[3];                                           \
+    double z1 = state[4], z2 = state[5];                                           \
+    size_t i;                                                                      \
+                                                                                   \
+    for (i = 0; i < frames; ++i) {                                                 \
+        const double x0 = src[i * src_stride] * scale;                             \
+        const double y0 = x0 * pb0 + x1 * pb1 + x2 * pb2 - y1 * pa1 - y2 * pa2;    \
+        const double z0 = y0 * rb0 + y1 * rb1 + y2 * rb2 - z1 * ra1 - z2 * ra2;    \
+        dst[i * dst_stride] = z0;                                                  \
+        x2 = x1; x1 = x0;                                                          \
+        y2 = y1; y1 = y0;                                                          \
+        z2 = z1; z1 = z0;                                                          \
+    }                                                                              \
+    state[0] = FLUSH_DENORMAL(x1);                                                 \
+    state[1] = FLUSH_DENORMAL(x2);                                                 \
+    state[2] = FLUSH_DENORMAL(y1);                                                 \
+    state[3] = FLUSH_DENORMAL(y2);                                                 \
+    state[4] = FLUSH_DENORMAL(z1);                                                 \
+    state[5] = FLUSH_DENORMAL(z2);                                                 \
+}
+EBUR128_KWEIGHT(short, -((double)SHRT_MIN))
+EBUR128_KWEIGHT(int, -((double)INT_MIN))
+EBUR128_KWEIGHT(float,  1.0)
+EBUR128_KWEIGHT(double, 1.0)
+
+void ff_ebur128_kweight_double(const FFEBUR128KFilter *f, double *state,
+                               double *dst, ptrdiff_t dst_stride,
+                               const double *src, ptrdiff_t src_stride,
+                               size_t frames)
+{
+    ebur128_kweight_double(f, state, dst, dst_stride, src, src_stride, frames);
+}
+
 #define EBUR128_FILTER(type, scaling_factor)                                       \
 static void ebur128_filter_##type(FFEBUR128State* st, const type** srcs,           \
                                   size_t src_index, size_t frames,                 \
@@ -335,30 +372,12 @@ static void ebur128_filter_##type(FFEBUR128State* st, const type** srcs,
         }                                                                          \
     }                                                                              \
     for (c = 0; c < st->channels; ++c) {                                           \
-        int ci = st->d->channel_map[c] - 1;                                        \
-        if (ci < 0) continue;                                                      \
-        else if (ci == FF_EBUR128_DUAL_MONO - 1) ci = 0; /*dual mono */            \
-        for (i = 0; i < frames; ++i) {                                             \
-            st->d->v[ci][0] = (double) (srcs[c][src_index + i * stride] / scaling_factor) \
-                         - st->d->a[1] * st->d->v[ci][1]                           \
-                         - st->d->a[2] * st->d->v[ci][2]                           \
-                         - st->d->a[3] * st->d->v[ci][3]                           \
-                         - st->d->a[4] * st->d->v[ci][4];                          \
-            audio_data[i * st->channels + c] =                                     \
-                           st->d->b[0] * st->d->v[ci][0]                           \
-                         + st->d->b[1] * st->d->v[ci][1]                           \
-                         + st->d->b[2] * st->d->v[ci][2]                           \
-                         + st->d->b[3] * st->d->v[ci][3]                           \
-                         + st->d->b[4] * st->d->v[ci][4];                          \
-            st->d->v[ci][4] = st->d->v[ci][3];                                     \
-            st->d->v[ci][3] = st->d->v[ci][2];                                     \
-            st->d->v[ci][2] = st->d->v[ci][1];                                     \
-            st->d->v[ci][1] = st->d->v[ci][0];                                     \
-        }                                                                          \
-        st->d->v[ci][4] = fabs(st->d->v[ci][4]) < DBL_MIN ? 0.0 : st->d->v[ci][4]; \
-        st->d->v[ci][3] = fabs(st->d->v[ci][3]) < DBL_MIN ? 0.0 : st->d->v[ci][3]; \
-        st->d->v[ci][2] = fabs(st->d->v[ci][2]) < DBL_MIN ? 0.0 : st->d->v[ci][2]; \
-        st->d->v[ci][1] = fabs(st->d->v[ci][1]) < DBL_MIN ? 0.0 : st->d->v[ci][1]; \
+        if (st->d->channel_map[c] == FF_EBUR128_UNUSED)                            \
+            continue;                                                              \
+        ebur128_kweight_##type(&st->d->kfilter,                                    \
+                               st->d->kfilter_state + c * FF_EBUR128_KFILTER_STATE, \
+                               audio_data + c, st->channels,                       \
+                               srcs[c] + src_index, stride, frames);               \
     }                                                                              \
 }
 EBUR128_FILTER(short, -((double)SHRT_MIN))
@@ -366,6 +385,68 @@ EBUR128_FILTER(int, -((double)INT_MIN))
 EBUR128_FILTER(float,  1.0)
 EBUR128_FILTER(double, 1.0)
 
+/* Polyphase FIR interpolation filter of BS.1770-4 Annex 2, the taps of every
+ * phase are in the order of the input samples they apply to. Phases 2 and 3
+ * are phases 1 and 0 reversed. */
+static const double true_peak_coeffs[2][FF_EBUR128_TRUE_PEAK_HISTORY + 1] = {
+    {  0.0017089843750,  0.0109863281250, -0.0196533203125,  0.0332031250000,
+      -0.0594482421875,  0.1373291015625,  0.9721679687500, -0.1022949218750,
+       0.0476074218750, -0.0266113281250,  0.0148925781250, -0.0083007812500 },
+    { -0.0291748046875,  0.0292968750000, -0.0517578125000,  0.0891113281250,
+      -0.1665039062500,  0.4650878906250,  0.7797851562500, -0.2003173828125,
+       0.1015625000000, -0.0582275390625,  0.0330810546875, -0.0189208984375 },
+};
+
+#define TRUE_PEAK_HALF  ((FF_EBUR128_TRUE_PEAK_HISTORY + 1) / 2)
+/* upper bound of the sum of the absolute values of the taps of a phase */
+#define TRUE_PEAK_GAIN  2.0229
+#define TRUE_PEAK_BLOCK 16
+
+double ff_ebur128_true_peak(const double *buf, size_t frames, double peak)
+{
+    double sum[2][TRUE_PEAK_HALF], diff[2][TRUE_PEAK_HALF];
+    size_t i, j;
+    int k, p;
+
+    /* With a phase and its reverse, v = h * x and w = reverse(h) * x,
+     * max(|v|, |w|) = (|v + w| + |v - w|) / 2, and v + w and v - w only
+     * need half of the taps applied to the sums and differences of the
+     * symmetric input samples. */
+    for (p = 0; p < 2; p++) {
+        for (k = 0; k < TRUE_PEAK_HALF; k++) {
+            sum [p][k] = true_peak_coeffs[p][k] + true_peak_coeffs[p][FF_EBUR128_TRUE_PEAK_HISTORY - k];
+            diff[p][k] = true_peak_coeffs[p][k] - true_peak_coeffs[p][FF_EBUR128_TRUE_PEAK_HISTORY - k];
+        }
+    }
+
+    for (i = 0; i < frames; i += TRUE_PEAK_BLOCK) {
+        const size_t end = FFMIN(i + TRUE_PEAK_BLOCK, frames);
+        double max = 0.0;
+
+        /* no interpolated sample of the block can exceed the peak */
+        for (j = i; j < end + FF_EBUR128_TRUE_PEAK_HISTORY; j++)
+            max = FFMAX(max, fabs(buf[j]));
+        if (max * TRUE_PEAK_GAIN <= peak)
+            continue;
+
+        for (j = i; j < end; j++) {
+            const double *x = buf + j;
+            double s0 = 0.0, d0 = 0.0, s1 = 0.0, d1 = 0.0;
+
+            for (k = 0; k < TRUE_PEAK_HALF; k++) {
+                const double a = x[k] + x[FF_EBUR128_TRUE_PEAK_HISTORY - k];
+                const double b = x[k] - x[FF_EBUR128_TRUE_PEAK_HISTORY - k];
+                s0 += sum [0][k] * a;
+                d0 += diff[0][k] * b;
+                s1 += sum [1][k] * a;
+                d1 += diff[1][k] * b;
+            }
+            peak = FFMAX(peak, 0.5 * FFMAX(fabs(s0) + fabs(d0), fabs(s1) + fabs(d1)));
+        }
+    }
+    return peak;
+}
+
 static double ebur128_energy_to_loudness(double energy)
 {
     return 10 * (log(energy) / log(10.0)) - 0.691;
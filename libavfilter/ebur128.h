@@ -293,4 +293,53 @@ int ff_ebur128_sample_peak(FFEBUR128State * st,
  */
 int ff_ebur128_relative_threshold(FFEBUR128State * st, double *out);
 
+/** \brief Coefficients of the K-weighting filter of BS.1770.
+ *
+ *  The filter is made of the high shelving pre-filter followed by the RLB
+ *  high-pass filter, both as direct form I biquads.
+ */
+typedef struct FFEBUR128KFilter {
+    double b[2][3];                   /**< Numerators of the two stages. */
+    double a[2][3];                   /**< Denominators, a[i][0] is 1. */
+} FFEBUR128KFilter;
+
+/** Number of doubles of K-weighting filter state per channel. */
+#define FF_EBUR128_KFILTER_STATE 6
+
+/** \brief Apply the K-weighting filter to one channel.
+ *
+ *  @param f filter coefficients
+ *  @param state FF_EBUR128_KFILTER_STATE values of filter state of the
+ *               channel, zeroed before the first call
+ *  @param dst filtered samples
+ *  @param dst_stride distance between two filtered samples in dst
+ *  @param src input samples
+ *  @param src_stride distance between two input samples in src
+ *  @param frames number of samples to filter
+ */
+void ff_ebur128_kweight_double(const FFEBUR128KFilter *f, double *state,
+                               double *dst, ptrdiff_t dst_stride,
+                               const double *src, ptrdiff_t src_stride,
+                               size_t frames);
+
+/** Number of previous samples of a channel needed by ff_ebur128_true_peak. */
+#define FF_EBUR128_TRUE_PEAK_HISTORY 11
+
+/** \brief Get the true peak of one channel.
+ *
+ *  The channel is 4x oversampled with the polyphase interpolation filter
+ *  of BS.1770-4 Annex 2, and only the peak of the oversampled signal is
+ *  computed: blocks of input which cannot exceed the peak found so far
+ *  are not interpolated.
+ *
+ *  @param buf the FF_EBUR128_TRUE_PEAK_HISTORY samples preceding the
+ *             block, zeroes at the start of the stream, followed by the
+ *             frames samples of the block
+ *  @param frames number of samples of the block
+ *  @param peak peak found so far
+ *  @return the maximum of peak and the absolute values of the
+ *          oversampled block
+ */
+double ff_ebur128_true_peak(const double *buf, size_t frames, double peak);
+
 #endif                          /* AVFILTER_EBUR128_H */
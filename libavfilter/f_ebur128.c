@@ -37,9 +37,9 @@
 #include "libavutil/xga_font_data.h"
 #include "libavutil/opt.h"
 #include "libavutil/timestamp.h"
-#include "libswresample/swresample.h"
 #include "audio.h"
 #include "avfilter.h"
+#include "ebur128.h"
 #include "formats.h"
 #include "internal.h"
 
@@ -59,6 +59,11 @@
 #define RLB_A1 -1.99004745483398
 #define RLB_A2  0.99007225036621
 
+static const FFEBUR128KFilter kfilter = {
+    .b = { { PRE_B0, PRE_B1, PRE_B2 }, { RLB_B0, RLB_B1, RLB_B2 } },
+    .a = { { 1.0,    PRE_A1, PRE_A2 }, { 1.0,    RLB_A1, RLB_A2 } },
+};
+
 #define ABS_THRES    -70            ///< silence gate: we discard anything below this absolute (LUFS) threshold
 #define ABS_UP_THRES  10            ///< upper loud limit to consider (ABS_THRES being the minimum)
 #define HIST_GRAIN   100            ///< defines histogram precision
@@ -98,11 +103,8 @@ typedef struct EBUR128Context {
     double *true_peaks;             ///< true peaks per channel
     double *sample_peaks;           ///< sample peaks per channel
     double *true_peaks_per_frame;   ///< true peaks in a frame per channel
-#if CONFIG_SWRESAMPLE
-    SwrContext *swr_ctx;            ///< over-sampling context for true peak metering
-    double *swr_buf;                ///< resampled audio data for true peak metering
-    int swr_linesize;
-#endif
+    double *tp_history;             ///< last input samples of every channel for true peak metering
+    double *tp_buf;                 ///< history and input samples of one channel for true peak metering
 
     /* video  */
     int do_video;                   ///< 1 if video output enabled, 0 otherwise
@@ -121,12 +123,11 @@ typedef struct EBUR128Context {
     double *ch_weighting;           ///< channel weighting mapping
     int sample_count;               ///< sample count used for refresh frequency, reset at refresh
 
-    /* Filter caches.
-     * The mult by 3 in the following is for X[i], X[i-1] and X[i-2] */
-    double x[MAX_CHANNELS * 3];     ///< 3 input samples cache for each channel
-    double y[MAX_CHANNELS * 3];     ///< 3 pre-filter samples cache for each channel
-    double z[MAX_CHANNELS * 3];     ///< 3 RLB-filter samples cache for each channel
+    /* K-weighting filter */
+    double kfilter_state[MAX_CHANNELS * FF_EBUR128_KFILTER_STATE]; ///< filter state for each channel
+    double *kfilter_buf;            ///< filtered samples of one channel, up to the next 100ms block
 
+#define I100_BINS  (48000 / 10)
 #define I400_BINS  (48000 * 4 / 10)
 #define I3000_BINS (48000 * 3)
     struct integrator i400;         ///< 400ms integrator, used for Momentary loudness  (M), and Integrated loudness (I)
@@ -353,10 +354,9 @@ static int config_audio_input(AVFilterLink *inlink)
 
     /* Force 100ms framing in case of metadata injection: the frames must have
      * a granularity of the window overlap to be accurately exploited.
-     * As for the true peaks mode, it just simplifies the resampling buffer
-     * allocation and the lookup in it (since sample buffers differ in size, it
-     * can be more complex to integrate in the one-sample loop of
-     * filter_frame()). */
+     * As for the true peaks mode, it makes the true peaks per frame match the
+     * 100ms blocks they are logged with, and bounds the size of the buffer
+     * used for their lookup. */
     if (ebur128->metadata || (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS))
         inlink->min_samples =
         inlink->max_samples =
@@ -402,31 +402,21 @@ static int config_audio_output(AVFilterLink *outlink)
             return AVERROR(ENOMEM);
     }
 
-#if CONFIG_SWRESAMPLE
-    if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
-        int ret;
+    ebur128->kfilter_buf = av_malloc_array(I100_BINS, sizeof(*ebur128->kfilter_buf));
+    if (!ebur128->kfilter_buf)
+        return AVERROR(ENOMEM);
 
-        ebur128->swr_buf    = av_malloc_array(nb_channels, 19200 * sizeof(double));
+    if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
         ebur128->true_peaks = av_calloc(nb_channels, sizeof(*ebur128->true_peaks));
         ebur128->true_peaks_per_frame = av_calloc(nb_channels, sizeof(*ebur128->true_peaks_per_frame));
-        ebur128->swr_ctx    = swr_alloc();
-        if (!ebur128->swr_buf || !ebur128->true_peaks ||
-            !ebur128->true_peaks_per_frame || !ebur128->swr_ctx)
+        ebur128->tp_history = av_calloc(nb_channels * FF_EBUR128_TRUE_PEAK_HISTORY,
+                                        sizeof(*ebur128->tp_history));
+        ebur128->tp_buf     = av_malloc_array(FF_EBUR128_TRUE_PEAK_HISTORY + outlink->sample_rate / 10,
+                                              sizeof(*ebur128->tp_buf));
+        if (!ebur128->true_peaks || !ebur128->true_peaks_per_frame ||
+            !ebur128->tp_history || !ebur128->tp_buf)
             return AVERROR(ENOMEM);
-
-        av_opt_set_int(ebur128->swr_ctx, "in_channel_layout",    outlink->channel_layout, 0);
-        av_opt_set_int(ebur128->swr_ctx, "in_sample_rate",       outlink->sample_rate, 0);
-        av_opt_set_sample_fmt(ebur128->swr_ctx, "in_sample_fmt", outlink->format, 0);
-
-        av_opt_set_int(ebur128->swr_ctx, "out_channel_layout",    outlink->channel_layout, 0);
-        av_opt_set_int(ebur128->swr_ctx, "out_sample_rate",       192000, 0);
-        av_opt_set_sample_fmt(ebur128->swr_ctx, "out_sample_fmt", outlink->format, 0);
-
-        ret = swr_init(ebur128->swr_ctx);
-        if (ret < 0)
-            return ret;
     }
-#endif
 
     if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS) {
         ebur128->sample_peaks = av_calloc(nb_channels, sizeof(*ebur128->sample_peaks));
@@ -469,12 +459,6 @@ static av_cold int init(AVFilterContext *ctx)
             ebur128->loglevel = AV_LOG_INFO;
     }
 
-    if (!CONFIG_SWRESAMPLE && (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS)) {
-        av_log(ctx, AV_LOG_ERROR,
-               "True-peak mode requires libswresample to be performed\n");
-        return AVERROR(EINVAL);
-    }
-
     // if meter is  +9 scale, scale range is from -18 LU to  +9 LU (or 3*9)
     // if meter is +18 scale, scale range is from -36 LU to +18 LU (or 3*18)
     ebur128->scale_range = 3 * ebur128->meter;
@@ -548,9 +532,42 @@ static int gate_update(struct integrator *integ, double power,
     return gate_hist_pos;
 }
 
+/* add the squared filtered samples of a channel to the caches of both
+ * integrators, keeping the sums of the cache contents up to date */
+static void integrate(EBUR128Context *ebur128, int ch, const double *z, int nb)
+{
+    double *cache_400  = ebur128->i400.cache[ch];
+    double *cache_3000 = ebur128->i3000.cache[ch];
+    double sum_400  = ebur128->i400.sum[ch];
+    double sum_3000 = ebur128->i3000.sum[ch];
+    int pos_400  = ebur128->i400.cache_pos;
+    int pos_3000 = ebur128->i3000.cache_pos;
+    int i;
+
+    for (i = 0; i < nb; i++) {
+        const double bin = z[i] * z[i];
+
+        /* add the new value, and limit the sum to the cache size (400ms or 3s)
+         * by removing the oldest one */
+        sum_400  = sum_400  + bin - cache_400 [pos_400];
+        sum_3000 = sum_3000 + bin - cache_3000[pos_3000];
+
+        /* override old cache entry with the new value */
+        cache_400 [pos_400 ] = bin;
+        cache_3000[pos_3000] = bin;
+
+        if (++pos_400 == I400_BINS)
+            pos_400 = 0;
+        if (++pos_3000 == I3000_BINS)
+            pos_3000 = 0;
+    }
+    ebur128->i400.sum[ch]  = sum_400;
+    ebur128->i3000.sum[ch] = sum_3000;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
 {
-    int i, ch, idx_insample;
+    int i, ch, idx_insample, nb;
     AVFilterContext *ctx = inlink->dst;
     EBUR128Context *ebur128 = ctx->priv;
     const int nb_channels = ebur128->nb_channels;
@@ -558,89 +575,66 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
     const double *samples = (double *)insamples->data[0];
     AVFrame *pic = ebur128->outpicref;
 
-#if CONFIG_SWRESAMPLE
     if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
-        const double *swr_samples = ebur128->swr_buf;
-        int ret = swr_convert(ebur128->swr_ctx, (uint8_t**)&ebur128->swr_buf, 19200,
-                              (const uint8_t **)insamples->data, nb_samples);
-        if (ret < 0)
-            return ret;
-        for (ch = 0; ch < nb_channels; ch++)
-            ebur128->true_peaks_per_frame[ch] = 0.0;
-        for (idx_insample = 0; idx_insample < ret; idx_insample++) {
-            for (ch = 0; ch < nb_channels; ch++) {
-                ebur128->true_peaks[ch] = FFMAX(ebur128->true_peaks[ch], fabs(*swr_samples));
-                ebur128->true_peaks_per_frame[ch] = FFMAX(ebur128->true_peaks_per_frame[ch],
-                                                          fabs(*swr_samples));
-                swr_samples++;
-            }
-        }
-    }
-#endif
+        double *buf = ebur128->tp_buf;
 
-    for (idx_insample = 0; idx_insample < nb_samples; idx_insample++) {
-        const int bin_id_400  = ebur128->i400.cache_pos;
-        const int bin_id_3000 = ebur128->i3000.cache_pos;
+        for (ch = 0; ch < nb_channels; ch++) {
+            double *history = ebur128->tp_history + ch * FF_EBUR128_TRUE_PEAK_HISTORY;
 
-#define MOVE_TO_NEXT_CACHED_ENTRY(time) do {                \
-    ebur128->i##time.cache_pos++;                           \
-    if (ebur128->i##time.cache_pos == I##time##_BINS) {     \
-        ebur128->i##time.filled    = 1;                     \
-        ebur128->i##time.cache_pos = 0;                     \
-    }                                                       \
-} while (0)
+            memcpy(buf, history, FF_EBUR128_TRUE_PEAK_HISTORY * sizeof(*buf));
+            for (i = 0; i < nb_samples; i++)
+                buf[FF_EBUR128_TRUE_PEAK_HISTORY + i] = samples[i * nb_channels + ch];
+            memcpy(history, buf + nb_samples, FF_EBUR128_TRUE_PEAK_HISTORY * sizeof(*buf));
+
+            ebur128->true_peaks_per_frame[ch] = ff_ebur128_true_peak(buf, nb_samples, 0.0);
+            ebur128->true_peaks[ch] = FFMAX(ebur128->true_peaks[ch],
+                                            ebur128->true_peaks_per_frame[ch]);
+        }
+    }
 
-        MOVE_TO_NEXT_CACHED_ENTRY(400);
-        MOVE_TO_NEXT_CACHED_ENTRY(3000);
+    /* process the samples up to the end of the current 100ms block at once */
+    for (idx_insample = 0; idx_insample < nb_samples; idx_insample += nb) {
+        nb = FFMIN(nb_samples - idx_insample, I100_BINS - ebur128->sample_count);
 
         for (ch = 0; ch < nb_channels; ch++) {
-            double bin;
-
-            if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS)
-                ebur128->sample_peaks[ch] = FFMAX(ebur128->sample_peaks[ch], fabs(*samples));
+            const double *src = samples + idx_insample * nb_channels + ch;
 
-            ebur128->x[ch * 3] = *samples++; // set X[i]
+            if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS) {
+                double peak = ebur128->sample_peaks[ch];
+                for (i = 0; i < nb; i++)
+                    peak = FFMAX(peak, fabs(src[i * nb_channels]));
+                ebur128->sample_peaks[ch] = peak;
+            }
 
             if (!ebur128->ch_weighting[ch])
                 continue;
 
-            /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
-#define FILTER(Y, X, name) do {                                                 \
-            double *dst = ebur128->Y + ch*3;                                    \
-            double *src = ebur128->X + ch*3;                                    \
-            dst[2] = dst[1];                                                    \
-            dst[1] = dst[0];                                                    \
-            dst[0] = src[0]*name##_B0 + src[1]*name##_B1 + src[2]*name##_B2     \
-                                      - dst[1]*name##_A1 - dst[2]*name##_A2;    \
-} while (0)
-
-            // TODO: merge both filters in one?
-            FILTER(y, x, PRE);  // apply pre-filter
-            ebur128->x[ch * 3 + 2] = ebur128->x[ch * 3 + 1];
-            ebur128->x[ch * 3 + 1] = ebur128->x[ch * 3    ];
-            FILTER(z, y, RLB);  // apply RLB-filter
-
-            bin = ebur128->z[ch * 3] * ebur128->z[ch * 3];
+            ff_ebur128_kweight_double(&kfilter, ebur128->kfilter_state + ch * FF_EBUR128_KFILTER_STATE,
+                                      ebur128->kfilter_buf, 1, src, nb_channels, nb);
+            integrate(ebur128, ch, ebur128->kfilter_buf, nb);
+        }
 
-            /* add the new value, and limit the sum to the cache size (400ms or 3s)
-             * by removing the oldest one */
-            ebur128->i400.sum [ch] = ebur128->i400.sum [ch] + bin - ebur128->i400.cache [ch][bin_id_400];
-            ebur128->i3000.sum[ch] = ebur128->i3000.sum[ch] + bin - ebur128->i3000.cache[ch][bin_id_3000];
+#define MOVE_TO_NEXT_CACHED_ENTRIES(time) do {              \
+    ebur128->i##time.cache_pos += nb;                       \
+    if (ebur128->i##time.cache_pos >= I##time##_BINS) {     \
+        ebur128->i##time.filled     = 1;                    \
+        ebur128->i##time.cache_pos -= I##time##_BINS;       \
+    }                                                       \
+} while (0)
 
-            /* override old cache entry with the new value */
-            ebur128->i400.cache [ch][bin_id_400 ] = bin;
-            ebur128->i3000.cache[ch][bin_id_3000] = bin;
-        }
+        MOVE_TO_NEXT_CACHED_ENTRIES(400);
+        MOVE_TO_NEXT_CACHED_ENTRIES(3000);
 
         /* For integrated loudness, gating blocks are 400ms long with 75%
          * overlap (see BS.1770-2 p5), so a re-computation is needed each 100ms
          * (4800 samples at 48kHz). */
-        if (++ebur128->sample_count == 4800) {
+        ebur128->sample_count += nb;
+        if (ebur128->sample_count == I100_BINS) {
             double loudness_400, loudness_3000;
             double power_400 = 1e-12, power_3000 = 1e-12;
             AVFilterLink *outlink = ctx->outputs[0];
             const int64_t pts = insamples->pts +
-                av_rescale_q(idx_insample, (AVRational){ 1, inlink->sample_rate },
+                av_rescale_q(idx_insample + nb - 1, (AVRational){ 1, inlink->sample_rate },
                              outlink->time_base);
 
             ebur128->sample_count = 0;
@@ -921,6 +915,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&ebur128->true_peaks);
     av_freep(&ebur128->sample_peaks);
     av_freep(&ebur128->true_peaks_per_frame);
+    av_freep(&ebur128->tp_history);
+    av_freep(&ebur128->tp_buf);
+    av_freep(&ebur128->kfilter_buf);
     av_freep(&ebur128->i400.histogram);
     av_freep(&ebur128->i3000.histogram);
     for (i = 0; i < ebur128->nb_channels; i++) {
@@ -930,10 +927,6 @@ static av_cold void uninit(AVFilterContext *ctx)
     for (i = 0; i < ctx->nb_outputs; i++)
         av_freep(&ctx->output_pads[i].name);
     av_frame_free(&ebur128->outpicref);
-#if CONFIG_SWRESAMPLE
-    av_freep(&ebur128->swr_buf);
-    swr_free(&ebur128->swr_ctx);
-#endif
 }
 
 static const AVFilterPad ebur128_inputs[] = {
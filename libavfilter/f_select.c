@@ -28,6 +28,7 @@
 #include "libavutil/fifo.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
 #include "libavutil/pixelutils.h"
 #include "avfilter.h"
 #include "audio.h"
@@ -148,20 +149,24 @@ typedef struct SelectContext {
     av_pixelutils_sad_fn sad;       ///< Sum of the absolute difference function (scene detect only)
     double prev_mafd;               ///< previous MAFD                           (scene detect only)
     AVFrame *prev_picref;           ///< previous frame                          (scene detect only)
+    int scene_downscale;            ///< downscaling factor of the compared frames (scene detect only)
+    int nb_comp;                    ///< number of compared components per pixel (scene detect only)
+    int reduced_w, reduced_h;       ///< size of the downscaled frames           (scene detect only)
+    int reduced_linesize;
+    uint8_t *reduced[2];            ///< current and previous downscaled frames  (scene detect only)
+    int has_prev_reduced;           ///< 1 if reduced[1] holds the previous frame
+    int64_t *job_sad;               ///< SAD computed by each job                (scene detect only)
     double select;
     int select_out;                 ///< mark the selected output pad index
     int nb_outputs;
 } SelectContext;
 
 #define OFFSET(x) offsetof(SelectContext, x)
-#define DEFINE_OPTIONS(filt_name, FLAGS)                            \
-static const AVOption filt_name##_options[] = {                     \
+#define COMMON_OPTIONS(FLAGS)                                       \
     { "expr", "set an expression to use for selecting frames", OFFSET(expr_str), AV_OPT_TYPE_STRING, { .str = "1" }, .flags=FLAGS }, \
     { "e",    "set an expression to use for selecting frames", OFFSET(expr_str), AV_OPT_TYPE_STRING, { .str = "1" }, .flags=FLAGS }, \
     { "outputs", "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
-    { "n",       "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
-    { NULL }                                                            \
-}
+    { "n",       "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS },
 
 static int request_frame(AVFilterLink *outlink);
 
@@ -242,46 +247,155 @@ static int config_input(AVFilterLink *inlink)
         inlink->type == AVMEDIA_TYPE_AUDIO ? inlink->sample_rate : NAN;
 
     if (select->do_scene_detect) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+
         select->sad = av_pixelutils_get_sad_fn(3, 3, 2, select); // 8x8 both sources aligned
         if (!select->sad)
             return AVERROR(EINVAL);
+
+        av_freep(&select->job_sad);
+        av_freep(&select->reduced[0]);
+        select->has_prev_reduced = 0;
+
+        select->job_sad = av_calloc(ff_filter_get_nb_threads(inlink->dst), sizeof(*select->job_sad));
+        if (!select->job_sad)
+            return AVERROR(ENOMEM);
+
+        if (select->scene_downscale > 1) {
+            /* packed RGB is compared on all components, YUV on the luma plane */
+            select->nb_comp   = desc->flags & AV_PIX_FMT_FLAG_RGB ? 3 : 1;
+            select->reduced_w = inlink->w / select->scene_downscale;
+            select->reduced_h = inlink->h / select->scene_downscale;
+            select->reduced_linesize = FFALIGN(select->reduced_w * select->nb_comp, 32);
+            select->reduced[0] = av_malloc_array(select->reduced_h, 2 * select->reduced_linesize);
+            if (!select->reduced[0])
+                return AVERROR(ENOMEM);
+            select->reduced[1] = select->reduced[0] + select->reduced_linesize * select->reduced_h;
+        }
     }
     return 0;
 }
 
+typedef struct ThreadData {
+    AVFrame *frame;                 ///< frame to downscale into cur, or NULL
+    const uint8_t *cur, *prev;      ///< compared pictures, prev is NULL if there is nothing to compare
+    int cur_linesize, prev_linesize;
+    int width;                      ///< width of the compared pictures in bytes
+    int nb_block_rows;              ///< number of 8 lines high rows of blocks
+} ThreadData;
+
+/**
+ * Downscale lines [y0, y1) of the reduced picture: every reduced pixel is
+ * the average of scene_downscale horizontally adjacent pixels, taken from
+ * the middle line of every group of scene_downscale lines.
+ */
+static void downscale_lines(const SelectContext *select, const AVFrame *frame,
+                            uint8_t *dst, int y0, int y1)
+{
+    const int f = select->scene_downscale, nb_comp = select->nb_comp;
+    const int w = select->reduced_w * nb_comp, step = f * nb_comp;
+    int x, y, c, k;
+
+    for (y = y0; y < y1; y++) {
+        const uint8_t *src = frame->data[0] + (y * f + f / 2) * frame->linesize[0];
+        uint8_t *d = dst + y * select->reduced_linesize;
+
+        for (c = 0; c < nb_comp; c++) {
+            const uint8_t *s = src + c;
+
+            for (x = c; x < w; x += nb_comp) {
+                int sum = 0;
+                for (k = 0; k < step; k += nb_comp)
+                    sum += s[k];
+                d[x] = (sum + f / 2) / f;
+                s += step;
+            }
+        }
+    }
+}
+
+static int scene_sad_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    SelectContext *select = ctx->priv;
+    const ThreadData *td = arg;
+    const int start = (td->nb_block_rows *  jobnr     ) / nb_jobs;
+    const int end   = (td->nb_block_rows * (jobnr + 1)) / nb_jobs;
+    int64_t sad = 0;
+    int x, y;
+
+    if (td->frame)
+        downscale_lines(select, td->frame, (uint8_t *)td->cur, start * 8, end * 8);
+
+    if (td->prev) {
+        for (y = start; y < end; y++) {
+            const uint8_t *p1 = td->cur  + y * 8 * td->cur_linesize;
+            const uint8_t *p2 = td->prev + y * 8 * td->prev_linesize;
+
+            for (x = 0; x < td->width - 7; x += 8)
+                sad += select->sad(p1 + x, td->cur_linesize, p2 + x, td->prev_linesize);
+        }
+        emms_c();
+    }
+    select->job_sad[jobnr] = sad;
+    return 0;
+}
+
 static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
 {
     double ret = 0;
     SelectContext *select = ctx->priv;
     AVFrame *prev_picref = select->prev_picref;
+    ThreadData td = { 0 };
+
+    if (select->scene_downscale > 1) {
+        /* the previous frame is only kept downscaled, no reference to it is held */
+        if (frame->width  != ctx->inputs[0]->w ||
+            frame->height != ctx->inputs[0]->h) {
+            select->has_prev_reduced = 0;
+            return 0;
+        }
+        td.frame        = frame;
+        td.cur          = select->reduced[0];
+        td.prev         = select->has_prev_reduced ? select->reduced[1] : NULL;
+        td.cur_linesize = td.prev_linesize = select->reduced_linesize;
+        td.width        = select->reduced_w * select->nb_comp;
+        td.nb_block_rows = select->reduced_h / 8;
+    } else if (prev_picref &&
+               frame->height == prev_picref->height &&
+               frame->width  == prev_picref->width) {
+        td.cur           = frame->data[0];
+        td.prev          = prev_picref->data[0];
+        td.cur_linesize  = frame->linesize[0];
+        td.prev_linesize = prev_picref->linesize[0];
+        td.width         = frame->width * 3;
+        td.nb_block_rows = frame->height / 8;
+    }
 
-    if (prev_picref &&
-        frame->height == prev_picref->height &&
-        frame->width  == prev_picref->width) {
-        int x, y, nb_sad = 0;
-        int64_t sad = 0;
-        double mafd, diff;
-        uint8_t *p1 =      frame->data[0];
-        uint8_t *p2 = prev_picref->data[0];
-        const int p1_linesize =       frame->linesize[0];
-        const int p2_linesize = prev_picref->linesize[0];
-
-        for (y = 0; y < frame->height - 7; y += 8) {
-            for (x = 0; x < frame->width*3 - 7; x += 8) {
-                sad += select->sad(p1 + x, p1_linesize, p2 + x, p2_linesize);
-                nb_sad += 8 * 8;
-            }
-            p1 += 8 * p1_linesize;
-            p2 += 8 * p2_linesize;
+    if (td.frame || td.prev) {
+        int nb_jobs = av_clip(td.nb_block_rows, 1, ff_filter_get_nb_threads(ctx));
+        ctx->internal->execute(ctx, scene_sad_slice, &td, NULL, nb_jobs);
+
+        if (td.prev) {
+            int64_t sad = 0, nb_sad = (int64_t)td.nb_block_rows * (td.width / 8) * 8 * 8;
+            double mafd, diff;
+            int i;
+
+            for (i = 0; i < nb_jobs; i++)
+                sad += select->job_sad[i];
+            mafd = nb_sad ? (double)sad / nb_sad : 0;
+            diff = fabs(mafd - select->prev_mafd);
+            ret  = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
+            select->prev_mafd = mafd;
         }
-        emms_c();
-        mafd = nb_sad ? (double)sad / nb_sad : 0;
-        diff = fabs(mafd - select->prev_mafd);
-        ret  = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
-        select->prev_mafd = mafd;
-        av_frame_free(&prev_picref);
     }
-    select->prev_picref = av_frame_clone(frame);
+
+    if (select->scene_downscale > 1) {
+        FFSWAP(uint8_t *, select->reduced[0], select->reduced[1]);
+        select->has_prev_reduced = 1;
+    } else {
+        av_frame_free(&select->prev_picref);
+        select->prev_picref = av_frame_clone(frame);
+    }
     return ret;
 }
 
@@ -338,17 +452,19 @@ static void select_frame(AVFilterContext *ctx, AVFrame *frame)
             !frame->interlaced_frame ? INTERLACE_TYPE_P :
         frame->top_field_first ? INTERLACE_TYPE_T : INTERLACE_TYPE_B;
         select->var_values[VAR_PICT_TYPE] = frame->pict_type;
-        if (select->do_scene_detect) {
-            char buf[32];
+        if (select->do_scene_detect)
             select->var_values[VAR_SCENE] = get_scene_score(ctx, frame);
-            // TODO: document metadata
-            snprintf(buf, sizeof(buf), "%f", select->var_values[VAR_SCENE]);
-            av_dict_set(&frame->metadata, "lavfi.scene_score", buf, 0);
-        }
         break;
     }
 
     select->select = res = av_expr_eval(select->expr, select->var_values, NULL);
+    if (res && select->do_scene_detect) {
+        char buf[32];
+        /* dropped frames are freed right away, only annotate the selected ones */
+        // TODO: document metadata
+        snprintf(buf, sizeof(buf), "%f", select->var_values[VAR_SCENE]);
+        av_dict_set(&frame->metadata, "lavfi.scene_score", buf, 0);
+    }
     av_log(inlink->dst, AV_LOG_DEBUG,
            "n:%f pts:%f t:%f key:%d",
            select->var_values[VAR_N],
@@ -427,6 +543,8 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     if (select->do_scene_detect) {
         av_frame_free(&select->prev_picref);
+        av_freep(&select->reduced[0]);
+        av_freep(&select->job_sad);
     }
 }
 
@@ -442,7 +560,19 @@ static int query_formats(AVFilterContext *ctx)
             AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24,
             AV_PIX_FMT_NONE
         };
-        AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+        /* downscaled frames can also be compared on their luma plane */
+        static const enum AVPixelFormat reduced_pix_fmts[] = {
+            AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24,
+            AV_PIX_FMT_GRAY8,
+            AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P,
+            AV_PIX_FMT_YUV410P, AV_PIX_FMT_YUV411P, AV_PIX_FMT_YUV440P,
+            AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P, AV_PIX_FMT_YUVJ444P,
+            AV_PIX_FMT_YUVJ440P, AV_PIX_FMT_YUVA420P, AV_PIX_FMT_YUVA444P,
+            AV_PIX_FMT_NV12, AV_PIX_FMT_NV21,
+            AV_PIX_FMT_NONE
+        };
+        AVFilterFormats *fmts_list = ff_make_format_list(select->scene_downscale > 1 ?
+                                                         reduced_pix_fmts : pix_fmts);
 
         if (!fmts_list)
             return AVERROR(ENOMEM);
@@ -455,7 +585,10 @@ static int query_formats(AVFilterContext *ctx)
 
 #if CONFIG_ASELECT_FILTER
 
-DEFINE_OPTIONS(aselect, AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_FILTERING_PARAM);
+static const AVOption aselect_options[] = {
+    COMMON_OPTIONS(AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_FILTERING_PARAM)
+    { NULL }
+};
 AVFILTER_DEFINE_CLASS(aselect);
 
 static av_cold int aselect_init(AVFilterContext *ctx)
@@ -498,7 +631,12 @@ AVFilter ff_af_aselect = {
 
 #if CONFIG_SELECT_FILTER
 
-DEFINE_OPTIONS(select, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM);
+#define VFLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+static const AVOption select_options[] = {
+    COMMON_OPTIONS(VFLAGS)
+    { "scene_downscale", "set the downscaling factor of the frames compared for scene detection", OFFSET(scene_downscale), AV_OPT_TYPE_INT, {.i64 = 1}, 1, 64, .flags=VFLAGS },
+    { NULL }
+};
 AVFILTER_DEFINE_CLASS(select);
 
 static av_cold int select_init(AVFilterContext *ctx)
@@ -530,6 +668,6 @@ AVFilter ff_vf_select = {
     .priv_size     = sizeof(SelectContext),
     .priv_class    = &select_class,
     .inputs        = avfilter_vf_select_inputs,
-    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif /* CONFIG_SELECT_FILTER */
@@ -0,0 +1,224 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program checks the convolutions of the native DNN backend
+ * against a direct convolution, with one and three threads. With
+ * "bench [width height [threads]]" it runs an ESPCN-like x2 super resolution
+ * model instead and reports the time spent in every layer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavfilter/dnn_backend_native.c"
+#include "libavutil/lfg.h"
+
+static void convolve_ref(const float *input, float *output, const ConvolutionalParams *conv_params,
+                         int width, int height)
+{
+    int y, x, n_filter, ch, kernel_y, kernel_x;
+    int radius = conv_params->kernel_size >> 1;
+    int src_linesize = width * conv_params->input_num;
+    int filter_linesize = conv_params->kernel_size * conv_params->input_num;
+    int filter_size = conv_params->kernel_size * filter_linesize;
+
+    for (y = 0; y < height; ++y){
+        for (x = 0; x < width; ++x){
+            for (n_filter = 0; n_filter < conv_params->output_num; ++n_filter){
+                output[n_filter] = conv_params->biases[n_filter];
+                for (ch = 0; ch < conv_params->input_num; ++ch){
+                    for (kernel_y = 0; kernel_y < conv_params->kernel_size; ++kernel_y){
+                        for (kernel_x = 0; kernel_x < conv_params->kernel_size; ++kernel_x){
+                            output[n_filter] += input[CLAMP_TO_EDGE(y + kernel_y - radius, height) * src_linesize +
+                                                      CLAMP_TO_EDGE(x + kernel_x - radius, width) * conv_params->input_num + ch] *
+                                                conv_params->kernel[n_filter * filter_size + kernel_y * filter_linesize +
+                                                                    kernel_x * conv_params->input_num + ch];
+                        }
+                    }
+                }
+                output[n_filter] = activate(output[n_filter], conv_params->activation);
+            }
+            output += conv_params->output_num;
+        }
+    }
+}
+
+static float random_float(AVLFG *lfg)
+{
+    return av_lfg_get(lfg) / (float)UINT32_MAX - 0.5f;
+}
+
+typedef struct LayerDesc {
+    int kernel_size, output_num;
+    DNNActivationFunc activation;
+    int block_size;
+} LayerDesc;
+
+static DNNModel *create_model(const LayerDesc *desc, int nb_layers, int channels,
+                              int nb_threads, AVLFG *lfg)
+{
+    DNNModel *model = av_mallocz(sizeof(*model));
+    ConvolutionalNetwork *network = av_mallocz(sizeof(*network));
+    int i, j, size;
+
+    if (!model || !network) {
+        av_free(model);
+        av_free(network);
+        return NULL;
+    }
+    model->model = network;
+    network->layers = av_mallocz_array(nb_layers + 1, sizeof(*network->layers));
+    if (!network->layers)
+        goto fail;
+    network->layers_num = nb_layers + 1;
+    network->layers[0].type = INPUT;
+    network->layers[0].params = av_mallocz(sizeof(InputParams));
+    if (!network->layers[0].params)
+        goto fail;
+
+    for (i = 0; i < nb_layers; i++) {
+        Layer *layer = &network->layers[i + 1];
+        if (desc[i].block_size) {
+            DepthToSpaceParams *params = av_mallocz(sizeof(*params));
+            if (!params)
+                goto fail;
+            layer->type = DEPTH_TO_SPACE;
+            layer->params = params;
+            params->block_size = desc[i].block_size;
+            channels /= desc[i].block_size * desc[i].block_size;
+        } else {
+            ConvolutionalParams *params = av_mallocz(sizeof(*params));
+            if (!params)
+                goto fail;
+            layer->type = CONV;
+            layer->params = params;
+            params->input_num   = channels;
+            params->output_num  = desc[i].output_num;
+            params->kernel_size = desc[i].kernel_size;
+            params->activation  = desc[i].activation;
+            size = params->input_num * params->output_num * params->kernel_size * params->kernel_size;
+            params->kernel = av_malloc_array(size, sizeof(float));
+            params->biases = av_malloc_array(params->output_num, sizeof(float));
+            if (!params->kernel || !params->biases)
+                goto fail;
+            for (j = 0; j < size; j++)
+                params->kernel[j] = random_float(lfg);
+            for (j = 0; j < params->output_num; j++)
+                params->biases[j] = random_float(lfg);
+            channels = params->output_num;
+        }
+    }
+
+    if (init_execution(network, nb_threads) < 0)
+        goto fail;
+    return model;
+
+fail:
+    ff_dnn_free_model_native(&model);
+    return NULL;
+}
+
+static int run_model(DNNModel *model, DNNData *input, DNNData *output, AVLFG *lfg)
+{
+    int i;
+
+    if (set_input_output_native(model->model, input, output) != DNN_SUCCESS)
+        return -1;
+    for (i = 0; i < input->width * input->height * input->channels; i++)
+        input->data[i] = random_float(lfg);
+    return ff_dnn_execute_model_native(model) == DNN_SUCCESS ? 0 : -1;
+}
+
+static int check_conv(int width, int height, int input_num, int output_num,
+                      int kernel_size, DNNActivationFunc activation, int nb_threads,
+                      AVLFG *lfg)
+{
+    const LayerDesc desc = { kernel_size, output_num, activation };
+    DNNModel *model = create_model(&desc, 1, input_num, nb_threads, lfg);
+    ConvolutionalNetwork *network;
+    DNNData input = { NULL, width, height, input_num }, output;
+    float *ref = av_malloc_array(width * height * output_num, sizeof(*ref));
+    int ret = -1;
+
+    if (!model || !ref || run_model(model, &input, &output, lfg) < 0)
+        goto end;
+    network = model->model;
+    convolve_ref(input.data, ref, network->layers[1].params, width, height);
+    ret = memcmp(ref, output.data, width * height * output_num * sizeof(*ref)) != 0;
+    if (ret)
+        fprintf(stderr, "mismatch for %dx%d, %d->%d channels, kernel %d, activation %d\n",
+                width, height, input_num, output_num, kernel_size, activation);
+
+end:
+    av_free(ref);
+    ff_dnn_free_model_native(&model);
+    return ret;
+}
+
+static int bench(int width, int height, int nb_threads, AVLFG *lfg)
+{
+    static const LayerDesc espcn[] = {
+        { 5, 64, TANH    },
+        { 3, 32, TANH    },
+        { 3,  4, SIGMOID },
+        { 0,  0, 0, 2    },
+    };
+    DNNModel *model = create_model(espcn, FF_ARRAY_ELEMS(espcn), 1, nb_threads, lfg);
+    ConvolutionalNetwork *network;
+    DNNData input = { NULL, width, height, 1 }, output;
+    int i, runs = 3, ret = -1;
+
+    if (!model || run_model(model, &input, &output, lfg) < 0)
+        goto end;
+    for (i = 1; i < runs; i++)
+        if (ff_dnn_execute_model_native(model) != DNN_SUCCESS)
+            goto end;
+    network = model->model;
+    printf("%dx%d, %d threads\n", width, height, network->nb_threads);
+    for (i = 1; i < network->layers_num; i++)
+        printf("layer %d: %8.2f ms\n", i, network->layer_time[i] / (1000.0 * runs));
+    ret = 0;
+
+end:
+    ff_dnn_free_model_native(&model);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    static const int sizes[][2] = { { 1, 1 }, { 3, 5 }, { 37, 11 }, { 70, 9 } };
+    static const int channels[][2] = { { 1, 64 }, { 64, 32 }, { 32, 1 }, { 3, 7 }, { 32, 4 } };
+    static const int kernels[] = { 1, 3, 5, 9 };
+    AVLFG lfg;
+    int i, j, k, ret = 0;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        return bench(argc > 3 ? atoi(argv[2]) : 1920, argc > 3 ? atoi(argv[3]) : 1080,
+                     argc > 4 ? atoi(argv[4]) : 0, &lfg) < 0;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(sizes); i++)
+        for (j = 0; j < FF_ARRAY_ELEMS(channels); j++)
+            for (k = 0; k < FF_ARRAY_ELEMS(kernels); k++)
+                ret |= check_conv(sizes[i][0], sizes[i][1], channels[j][0], channels[j][1],
+                                  kernels[k], (i + j + k) % 3, 1 + 2 * (k & 1), &lfg);
+    return ret;
+}
@@ -57,7 +57,8 @@ static uint32_t lowpass(int prev, int cur, int16_t *coef, int depth)
 av_always_inline
 static void denoise_temporal(uint8_t *src, uint8_t *dst,
                              uint16_t *frame_ant,
-                             int w, int h, int sstride, int dstride,
+                             int x0, int x1, int y0, int y1, int w,
+                             int sstride, int dstride,
                              int16_t *temporal, int depth)
 {
     long x, y;
@@ -65,8 +66,12 @@ static void denoise_temporal(uint8_t *src, uint8_t *dst,
 
     temporal += 256 << LUT_BITS;
 
-    for (y = 0; y < h; y++) {
-        for (x = 0; x < w; x++) {
+    src       += y0 * sstride;
+    dst       += y0 * dstride;
+    frame_ant += y0 * w;
+
+    for (y = y0; y < y1; y++) {
+        for (x = x0; x < x1; x++) {
             frame_ant[x] = tmp = lowpass(frame_ant[x], LOAD(x), temporal, depth);
             STORE(x, tmp);
         }
@@ -76,11 +81,20 @@ static void denoise_temporal(uint8_t *src, uint8_t *dst,
     }
 }
 
+/**
+ * Filter the pixels [x0, x1) of the lines [y0, y1).
+ *
+ * line_ant must hold the vertically filtered line y0 - 1 over these
+ * columns, and pixel_ant the horizontally filtered pixel x0 of every line
+ * unless x0 is 0.
+ */
 av_always_inline
 static void denoise_spatial(HQDN3DContext *s,
                             uint8_t *src, uint8_t *dst,
                             uint16_t *line_ant, uint16_t *frame_ant,
-                            int w, int h, int sstride, int dstride,
+                            uint16_t *pixel_ant_line,
+                            int x0, int x1, int y0, int y1, int w,
+                            int sstride, int dstride,
                             int16_t *spatial, int16_t *temporal, int depth)
 {
     long x, y;
@@ -90,86 +104,128 @@ static void denoise_spatial(HQDN3DContext *s,
     spatial  += 256 << LUT_BITS;
     temporal += 256 << LUT_BITS;
 
-    /* First line has no top neighbor. Only left one for each tmp and
-     * last frame */
-    pixel_ant = LOAD(0);
-    for (x = 0; x < w; x++) {
-        line_ant[x] = tmp = pixel_ant = lowpass(pixel_ant, LOAD(x), spatial, depth);
-        frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
-        STORE(x, tmp);
-    }
-
-    for (y = 1; y < h; y++) {
+    src       += y0 * sstride;
+    dst       += y0 * dstride;
+    frame_ant += y0 * w;
+
+    for (y = y0; y < y1; y++) {
+        pixel_ant = x0 ? pixel_ant_line[y] : LOAD(0);
+        if (!y) {
+            /* First line has no top neighbor. Only left one for each tmp and
+             * last frame */
+            for (x = x0; x < x1; x++) {
+                line_ant[x] = tmp = pixel_ant = lowpass(pixel_ant, LOAD(x), spatial, depth);
+                frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
+                STORE(x, tmp);
+            }
+        } else if (!x0 && x1 == w && s->denoise_row[depth]) {
+            s->denoise_row[depth](src, dst, line_ant, frame_ant, w, spatial, temporal);
+        } else {
+            for (x = x0; x < FFMIN(x1, w - 1); x++) {
+                line_ant[x] = tmp = lowpass(line_ant[x], pixel_ant, spatial, depth);
+                pixel_ant = lowpass(pixel_ant, LOAD(x+1), spatial, depth);
+                frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
+                STORE(x, tmp);
+            }
+            if (x1 == w) {
+                x = w - 1;
+                line_ant[x] = tmp = lowpass(line_ant[x], pixel_ant, spatial, depth);
+                frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
+                STORE(x, tmp);
+            }
+        }
+        pixel_ant_line[y] = pixel_ant;
         src += sstride;
         dst += dstride;
         frame_ant += w;
-        if (s->denoise_row[depth]) {
-            s->denoise_row[depth](src, dst, line_ant, frame_ant, w, spatial, temporal);
-            continue;
-        }
-        pixel_ant = LOAD(0);
-        for (x = 0; x < w-1; x++) {
-            line_ant[x] = tmp = lowpass(line_ant[x], pixel_ant, spatial, depth);
-            pixel_ant = lowpass(pixel_ant, LOAD(x+1), spatial, depth);
-            frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
-            STORE(x, tmp);
-        }
-        line_ant[x] = tmp = lowpass(line_ant[x], pixel_ant, spatial, depth);
-        frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
-        STORE(x, tmp);
     }
 }
 
 av_always_inline
-static int denoise_depth(HQDN3DContext *s,
-                         uint8_t *src, uint8_t *dst,
-                         uint16_t *line_ant, uint16_t **frame_ant_ptr,
-                         int w, int h, int sstride, int dstride,
-                         int16_t *spatial, int16_t *temporal, int depth)
+static void denoise_depth(HQDN3DContext *s,
+                          uint8_t *src, uint8_t *dst,
+                          uint16_t *line_ant, uint16_t *frame_ant,
+                          uint16_t *pixel_ant_line, int init,
+                          int x0, int x1, int y0, int y1, int w,
+                          int sstride, int dstride,
+                          int16_t *spatial, int16_t *temporal, int depth)
 {
     // FIXME: For 16-bit depth, frame_ant could be a pointer to the previous
     // filtered frame rather than a separate buffer.
     long x, y;
-    uint16_t *frame_ant = *frame_ant_ptr;
-    if (!frame_ant) {
+
+    if (init) {
         uint8_t *frame_src = src;
-        *frame_ant_ptr = frame_ant = av_malloc_array(w, h*sizeof(uint16_t));
-        if (!frame_ant)
-            return AVERROR(ENOMEM);
-        for (y = 0; y < h; y++, src += sstride, frame_ant += w)
-            for (x = 0; x < w; x++)
+        uint16_t *frame_dst = frame_ant;
+        src       += y0 * sstride;
+        frame_ant += y0 * w;
+        for (y = y0; y < y1; y++, src += sstride, frame_ant += w)
+            for (x = x0; x < x1; x++)
                 frame_ant[x] = LOAD(x);
         src = frame_src;
-        frame_ant = *frame_ant_ptr;
+        frame_ant = frame_dst;
     }
 
     if (spatial[0])
-        denoise_spatial(s, src, dst, line_ant, frame_ant,
-                        w, h, sstride, dstride, spatial, temporal, depth);
+        denoise_spatial(s, src, dst, line_ant, frame_ant, pixel_ant_line,
+                        x0, x1, y0, y1, w, sstride, dstride,
+                        spatial, temporal, depth);
     else
         denoise_temporal(src, dst, frame_ant,
-                         w, h, sstride, dstride, temporal, depth);
-    emms_c();
-    return 0;
+                         x0, x1, y0, y1, w, sstride, dstride,
+                         temporal, depth);
 }
 
 #define denoise(...)                                                          \
     do {                                                                      \
-        int ret = AVERROR_BUG;                                                \
         switch (s->depth) {                                                   \
-            case  8: ret = denoise_depth(__VA_ARGS__,  8); break;             \
-            case  9: ret = denoise_depth(__VA_ARGS__,  9); break;             \
-            case 10: ret = denoise_depth(__VA_ARGS__, 10); break;             \
-            case 16: ret = denoise_depth(__VA_ARGS__, 16); break;             \
-        }                                                                     \
-        if (ret < 0) {                                                        \
-            av_frame_free(&out);                                              \
-            if (!direct)                                                      \
-                av_frame_free(&in);                                           \
-            return ret;                                                       \
+            case  8: denoise_depth(__VA_ARGS__,  8); break;                   \
+            case  9: denoise_depth(__VA_ARGS__,  9); break;                   \
+            case 10: denoise_depth(__VA_ARGS__, 10); break;                   \
+            case 16: denoise_depth(__VA_ARGS__, 16); break;                   \
         }                                                                     \
     } while (0)
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int init;
+    /* the tiles with tx + ty == wave are filtered, all of them if < 0 */
+    int wave;
+} ThreadData;
+
+static int denoise_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HQDN3DContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in, *out = td->out;
+    int tx_start = td->wave < 0 ? 0                : td->wave - jobnr;
+    int tx_end   = td->wave < 0 ? s->nb_tiles_x : tx_start + 1;
+    int c;
+
+    if (tx_start < 0 || tx_start >= s->nb_tiles_x)
+        return 0;
+
+    for (c = 0; c < 3; c++) {
+        const int w  = AV_CEIL_RSHIFT(in->width,  (!!c * s->hsub));
+        const int h  = AV_CEIL_RSHIFT(in->height, (!!c * s->vsub));
+        const int x0 = w *  tx_start    / s->nb_tiles_x;
+        const int x1 = w *  tx_end      / s->nb_tiles_x;
+        const int y0 = h *  jobnr       / nb_jobs;
+        const int y1 = h * (jobnr + 1)  / nb_jobs;
+
+        if (x0 == x1 || y0 == y1)
+            continue;
+
+        denoise(s, in->data[c], out->data[c],
+                s->line[c], s->frame_prev[c], s->pixel_ant[c], td->init,
+                x0, x1, y0, y1, w,
+                in->linesize[c], out->linesize[c],
+                s->coefs[c ? CHROMA_SPATIAL : LUMA_SPATIAL],
+                s->coefs[c ? CHROMA_TMP     : LUMA_TMP]);
+    }
+    return 0;
+}
+
 static int16_t *precalc_coefs(double dist25, int depth)
 {
     int i;
@@ -223,7 +279,12 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->coefs[1]);
     av_freep(&s->coefs[2]);
     av_freep(&s->coefs[3]);
-    av_freep(&s->line);
+    av_freep(&s->line[0]);
+    av_freep(&s->line[1]);
+    av_freep(&s->line[2]);
+    av_freep(&s->pixel_ant[0]);
+    av_freep(&s->pixel_ant[1]);
+    av_freep(&s->pixel_ant[2]);
     av_freep(&s->frame_prev[0]);
     av_freep(&s->frame_prev[1]);
     av_freep(&s->frame_prev[2]);
@@ -261,8 +322,10 @@ static int query_formats(AVFilterContext *ctx)
 
 static int config_input(AVFilterLink *inlink)
 {
-    HQDN3DContext *s = inlink->dst->priv;
+    AVFilterContext *ctx = inlink->dst;
+    HQDN3DContext *s = ctx->priv;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int nb_threads = ff_filter_get_nb_threads(ctx);
     int i;
 
     uninit(inlink->dst);
@@ -271,9 +334,19 @@ static int config_input(AVFilterLink *inlink)
     s->vsub  = desc->log2_chroma_h;
     s->depth = desc->comp[0].depth;
 
-    s->line = av_malloc_array(inlink->w, sizeof(*s->line));
-    if (!s->line)
-        return AVERROR(ENOMEM);
+    for (i = 0; i < 3; i++) {
+        s->line[i]      = av_malloc_array(inlink->w, sizeof(*s->line[i]));
+        s->pixel_ant[i] = av_malloc_array(inlink->h, sizeof(*s->pixel_ant[i]));
+        if (!s->line[i] || !s->pixel_ant[i])
+            return AVERROR(ENOMEM);
+    }
+
+    /* The spatial lowpass runs down every column and along every line, so
+     * a band of lines can filter a tile of columns once the band above and
+     * the tile on the left are done. More tiles than bands keep most of the
+     * threads busy while the wavefront fills and drains. */
+    s->nb_tiles_y = FFMIN(nb_threads, AV_CEIL_RSHIFT(inlink->h, s->vsub));
+    s->nb_tiles_x = nb_threads > 1 ? FFMIN(4 * nb_threads, AV_CEIL_RSHIFT(inlink->w, s->hsub)) : 1;
 
     for (i = 0; i < 4; i++) {
         s->coefs[i] = precalc_coefs(s->strength[i], s->depth);
@@ -292,6 +365,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     AVFilterContext *ctx  = inlink->dst;
     HQDN3DContext *s = ctx->priv;
     AVFilterLink *outlink = ctx->outputs[0];
+    ThreadData td;
 
     AVFrame *out;
     int c, direct = av_frame_is_writable(in) && !ctx->is_disabled;
@@ -308,15 +382,32 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         av_frame_copy_props(out, in);
     }
 
-    for (c = 0; c < 3; c++) {
-        denoise(s, in->data[c], out->data[c],
-                s->line, &s->frame_prev[c],
-                AV_CEIL_RSHIFT(in->width,  (!!c * s->hsub)),
-                AV_CEIL_RSHIFT(in->height, (!!c * s->vsub)),
-                in->linesize[c], out->linesize[c],
-                s->coefs[c ? CHROMA_SPATIAL : LUMA_SPATIAL],
-                s->coefs[c ? CHROMA_TMP     : LUMA_TMP]);
+    td.in   = in;
+    td.out  = out;
+    td.init = !s->frame_prev[0];
+    for (c = 0; c < 3 && td.init; c++) {
+        int w = AV_CEIL_RSHIFT(in->width,  (!!c * s->hsub));
+        int h = AV_CEIL_RSHIFT(in->height, (!!c * s->vsub));
+
+        s->frame_prev[c] = av_malloc_array(w, h * sizeof(*s->frame_prev[c]));
+        if (!s->frame_prev[c]) {
+            av_freep(&s->frame_prev[0]);
+            av_freep(&s->frame_prev[1]);
+            av_frame_free(&out);
+            if (!direct)
+                av_frame_free(&in);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    if (s->coefs[LUMA_SPATIAL][0] || s->coefs[CHROMA_SPATIAL][0]) {
+        for (td.wave = 0; td.wave < s->nb_tiles_x + s->nb_tiles_y - 1; td.wave++)
+            ctx->internal->execute(ctx, denoise_slice, &td, NULL, s->nb_tiles_y);
+    } else {
+        td.wave = -1;
+        ctx->internal->execute(ctx, denoise_slice, &td, NULL, s->nb_tiles_y);
     }
+    emms_c();
 
     if (ctx->is_disabled) {
         av_frame_free(&out);
@@ -370,5 +461,5 @@ AVFilter ff_vf_hqdn3d = {
     .query_formats = query_formats,
     .inputs        = avfilter_vf_hqdn3d_inputs,
     .outputs       = avfilter_vf_hqdn3d_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -46,6 +46,7 @@ enum color_search_method {
     COLOR_SEARCH_NNS_ITERATIVE,
     COLOR_SEARCH_NNS_RECURSIVE,
     COLOR_SEARCH_BRUTEFORCE,
+    COLOR_SEARCH_LUT,
     NB_COLOR_SEARCHES
 };
 
@@ -75,16 +76,38 @@ struct cache_node {
     int nb_entries;
 };
 
+/* the inverse colormap splits the RGB cube in cells of (1<<(8-LUT_NBITS))^3 colors */
+#define LUT_NBITS 5
+#define LUT_NB_CELLS (1<<(3*LUT_NBITS))
+
+/* Error diffusion runs on tiles shifted left by diffusion_skew() pixels on
+ * every row. Two tiles whose column index plus twice the row index is the
+ * same, called a wave, do not depend on each other and do not write to the
+ * same pixels. */
+#define TILE_W        128
+#define TILE_H         16
+
+struct inverse_colormap {
+    int offset[LUT_NB_CELLS + 1];   /* position of the first candidate of every cell */
+    uint8_t *entries;               /* palette entries which can be the nearest to a color of the cell */
+    unsigned entries_size;
+};
+
 struct PaletteUseContext;
 
-typedef int (*set_frame_func)(struct PaletteUseContext *s, AVFrame *out, AVFrame *in,
-                              int x_start, int y_start, int width, int height);
+typedef int (*set_frame_func)(struct PaletteUseContext *s, struct cache_node *cache,
+                              AVFrame *out, AVFrame *in,
+                              int x_start, int y_start, int width, int height,
+                              int tx_start, int tx_end, int ty_start, int ty_end);
 
 typedef struct PaletteUseContext {
     const AVClass *class;
     FFFrameSync fs;
-    struct cache_node cache[CACHE_SIZE];    /* lookup cache */
+    struct cache_node *cache;               /* lookup caches, CACHE_SIZE nodes per job */
+    int nb_caches;
+    int *job_ret;
     struct color_node map[AVPALETTE_COUNT]; /* 3D-Tree (KD-Tree with K=3) for reverse colormap */
+    struct inverse_colormap lut;            /* cells of the RGB cube for the lut color search */
     uint32_t palette[AVPALETTE_COUNT];
     int transparency_index; /* index in the palette of transparency. -1 if there is no transparency in the palette. */
     int trans_thresh;
@@ -127,6 +150,7 @@ static const AVOption paletteuse_options[] = {
         { "nns_iterative", "iterative search",             0, AV_OPT_TYPE_CONST, {.i64=COLOR_SEARCH_NNS_ITERATIVE}, INT_MIN, INT_MAX, FLAGS, "search" },
         { "nns_recursive", "recursive search",             0, AV_OPT_TYPE_CONST, {.i64=COLOR_SEARCH_NNS_RECURSIVE}, INT_MIN, INT_MAX, FLAGS, "search" },
         { "bruteforce",    "brute-force into the palette", 0, AV_OPT_TYPE_CONST, {.i64=COLOR_SEARCH_BRUTEFORCE},    INT_MIN, INT_MAX, FLAGS, "search" },
+        { "lut",           "precomputed inverse colormap", 0, AV_OPT_TYPE_CONST, {.i64=COLOR_SEARCH_LUT},           INT_MIN, INT_MAX, FLAGS, "search" },
     { "mean_err", "compute and print mean error", OFFSET(calc_mean_err), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS },
     { "debug_accuracy", "test color search accuracy", OFFSET(debug_accuracy), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS },
     { NULL }
@@ -327,9 +351,42 @@ end:
     return root[best_node_id].palette_id;
 }
 
-#define COLORMAP_NEAREST(search, palette, root, target, trans_thresh)                                    \
+/**
+ * Same result as colormap_nearest_bruteforce(), but only the palette entries
+ * which can be the nearest to some color of the cell of the target are
+ * checked.
+ */
+static av_always_inline uint8_t colormap_nearest_lut(const uint32_t *palette, const struct inverse_colormap *lut,
+                                                     const uint8_t *argb, const int trans_thresh)
+{
+    const int r = argb[1], g = argb[2], b = argb[3];
+    const int cell = (r >> (8 - LUT_NBITS)) << (2 * LUT_NBITS) |
+                     (g >> (8 - LUT_NBITS)) <<      LUT_NBITS  |
+                     (b >> (8 - LUT_NBITS));
+    int i, pal_id = -1, min_dist = INT_MAX;
+
+    if (argb[0] < trans_thresh)
+        return colormap_nearest_bruteforce(palette, argb, trans_thresh);
+
+    for (i = lut->offset[cell]; i < lut->offset[cell + 1]; i++) {
+        const int id = lut->entries[i];
+        const uint32_t c = palette[id];
+        const int dr = r - (c >> 16 & 0xff);
+        const int dg = g - (c >>  8 & 0xff);
+        const int db = b - (c       & 0xff);
+        const int d = dr*dr + dg*dg + db*db;
+        if (d < min_dist) {
+            pal_id = id;
+            min_dist = d;
+        }
+    }
+    return pal_id;
+}
+
+#define COLORMAP_NEAREST(search, palette, root, lut, target, trans_thresh)                               \
     search == COLOR_SEARCH_NNS_ITERATIVE ? colormap_nearest_iterative(root, target, trans_thresh) :      \
     search == COLOR_SEARCH_NNS_RECURSIVE ? colormap_nearest_recursive(root, target, trans_thresh) :      \
+    search == COLOR_SEARCH_LUT           ? colormap_nearest_lut(palette, lut, target, trans_thresh) :    \
                                            colormap_nearest_bruteforce(palette, target, trans_thresh)
 
 /**
@@ -338,8 +395,8 @@ end:
  * Note: a, r, g, and b are the components of color, but are passed as well to avoid
  * recomputing them (they are generally computed by the caller for other uses).
  */
-static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
-                                      uint8_t a, uint8_t r, uint8_t g, uint8_t b,
+static av_always_inline int color_get(PaletteUseContext *s, struct cache_node *cache,
+                                      uint32_t color, uint8_t a, uint8_t r, uint8_t g, uint8_t b,
                                       const enum color_search_method search_method)
 {
     int i;
@@ -348,7 +405,7 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
     const uint8_t ghash = g & ((1<<NBITS)-1);
     const uint8_t bhash = b & ((1<<NBITS)-1);
     const unsigned hash = rhash<<(NBITS*2) | ghash<<NBITS | bhash;
-    struct cache_node *node = &s->cache[hash];
+    struct cache_node *node = &cache[hash];
     struct cached_color *e;
 
     // first, check for transparency
@@ -356,6 +413,10 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
         return s->transparency_index;
     }
 
+    // the inverse colormap is about as fast as the cache
+    if (search_method == COLOR_SEARCH_LUT)
+        return colormap_nearest_lut(s->palette, &s->lut, argb_elts, s->trans_thresh);
+
     for (i = 0; i < node->nb_entries; i++) {
         e = &node->entries[i];
         if (e->color == color)
@@ -367,12 +428,12 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
     if (!e)
         return AVERROR(ENOMEM);
     e->color = color;
-    e->pal_entry = COLORMAP_NEAREST(search_method, s->palette, s->map, argb_elts, s->trans_thresh);
+    e->pal_entry = COLORMAP_NEAREST(search_method, s->palette, s->map, &s->lut, argb_elts, s->trans_thresh);
 
     return e->pal_entry;
 }
 
-static av_always_inline int get_dst_color_err(PaletteUseContext *s,
+static av_always_inline int get_dst_color_err(PaletteUseContext *s, struct cache_node *cache,
                                               uint32_t c, int *er, int *eg, int *eb,
                                               const enum color_search_method search_method)
 {
@@ -381,7 +442,7 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     const uint8_t g = c >>  8 & 0xff;
     const uint8_t b = c       & 0xff;
     uint32_t dstc;
-    const int dstx = color_get(s, c, a, r, g, b, search_method);
+    const int dstx = color_get(s, cache, c, a, r, g, b, search_method);
     if (dstx < 0)
         return dstx;
     dstc = s->palette[dstx];
@@ -391,26 +452,58 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     return dstx;
 }
 
-static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFrame *in,
+/**
+ * Return the shift between two rows of error diffusion tiles. A pixel gets
+ * errors from its left neighbours up to the reach of the dither to the right
+ * and from the previous row. The errors clip, so their order matters: every
+ * pixel of the previous row that pushes to a pixel must run before its left
+ * neighbours in the skewed order, which needs a shift of the right reach plus
+ * the reach to the left on the next row.
+ */
+static av_always_inline int diffusion_skew(enum dithering_mode dither)
+{
+    switch (dither) {
+    case DITHERING_HECKBERT:        return 1;
+    case DITHERING_FLOYD_STEINBERG:
+    case DITHERING_SIERRA2_4A:      return 2;
+    case DITHERING_SIERRA2:         return 4;
+    default:                        return 0;
+    }
+}
+
+/**
+ * Process the pixels of the (x_start, y_start, w, h) window which are in the
+ * rows ty_start to ty_end - 1 and, once the row y is shifted right by
+ * diffusion_skew(dither) * (y - y_start) pixels, in the columns tx_start to
+ * tx_end - 1 of the window.
+ */
+static av_always_inline int set_frame(PaletteUseContext *s, struct cache_node *cache,
+                                      AVFrame *out, AVFrame *in,
                                       int x_start, int y_start, int w, int h,
+                                      int tx_start, int tx_end, int ty_start, int ty_end,
                                       enum dithering_mode dither,
                                       const enum color_search_method search_method)
 {
     int x, y;
     const int src_linesize = in ->linesize[0] >> 2;
     const int dst_linesize = out->linesize[0];
-    uint32_t *src = ((uint32_t *)in ->data[0]) + y_start*src_linesize;
-    uint8_t  *dst =              out->data[0]  + y_start*dst_linesize;
+    uint32_t *src = ((uint32_t *)in ->data[0]) + ty_start*src_linesize;
+    uint8_t  *dst =              out->data[0]  + ty_start*dst_linesize;
 
     w += x_start;
     h += y_start;
 
-    for (y = y_start; y < h; y++) {
-        for (x = x_start; x < w; x++) {
+    for (y = ty_start; y < ty_end; y++) {
+        const int skew = diffusion_skew(dither) * (y - y_start);
+        const int xs = FFMAX(x_start + tx_start - skew, x_start);
+        const int xe = FFMIN(x_start + tx_end   - skew, w);
+        const int *ordered_dither = s->ordered_dither + ((y & 7) << 3);
+
+        for (x = xs; x < xe; x++) {
             int er, eg, eb;
 
             if (dither == DITHERING_BAYER) {
-                const int d = s->ordered_dither[(y & 7)<<3 | (x & 7)];
+                const int d = ordered_dither[x & 7];
                 const uint8_t a8 = src[x] >> 24 & 0xff;
                 const uint8_t r8 = src[x] >> 16 & 0xff;
                 const uint8_t g8 = src[x] >>  8 & 0xff;
@@ -418,7 +511,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t r = av_clip_uint8(r8 + d);
                 const uint8_t g = av_clip_uint8(g8 + d);
                 const uint8_t b = av_clip_uint8(b8 + d);
-                const int color = color_get(s, src[x], a8, r, g, b, search_method);
+                const int color = color_get(s, cache, src[x], a8, r, g, b, search_method);
 
                 if (color < 0)
                     return color;
@@ -426,7 +519,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_HECKBERT) {
                 const int right = x < w - 1, down = y < h - 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -438,7 +531,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_FLOYD_STEINBERG) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -452,7 +545,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA2) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -471,7 +564,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_SIERRA2_4A) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -486,7 +579,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t r = src[x] >> 16 & 0xff;
                 const uint8_t g = src[x] >>  8 & 0xff;
                 const uint8_t b = src[x]       & 0xff;
-                const int color = color_get(s, src[x], a, r, g, b, search_method);
+                const int color = color_get(s, cache, src[x], a, r, g, b, search_method);
 
                 if (color < 0)
                     return color;
@@ -554,7 +647,8 @@ static int disp_tree(const struct color_node *node, const char *fname)
     return 0;
 }
 
-static int debug_accuracy(const struct color_node *node, const uint32_t *palette, const int trans_thresh,
+static int debug_accuracy(const struct color_node *node, const uint32_t *palette,
+                          const struct inverse_colormap *lut, const int trans_thresh,
                           const enum color_search_method search_method)
 {
     int r, g, b, ret = 0;
@@ -563,7 +657,7 @@ static int debug_accuracy(const struct color_node *node, const uint32_t *palette
         for (g = 0; g < 256; g++) {
             for (b = 0; b < 256; b++) {
                 const uint8_t argb[] = {0xff, r, g, b};
-                const int r1 = COLORMAP_NEAREST(search_method, palette, node, argb, trans_thresh);
+                const int r1 = COLORMAP_NEAREST(search_method, palette, node, lut, argb, trans_thresh);
                 const int r2 = colormap_nearest_bruteforce(palette, argb, trans_thresh);
                 if (r1 != r2) {
                     const uint32_t c1 = palette[r1];
@@ -729,7 +823,76 @@ static int cmp_pal_entry(const void *a, const void *b)
     return c1 - c2;
 }
 
-static void load_colormap(PaletteUseContext *s)
+static int load_inverse_colormap(struct inverse_colormap *lut, const uint32_t *palette,
+                                 const int trans_thresh)
+{
+    const int cell_size = 1 << (8 - LUT_NBITS);
+    uint8_t  (*dmin)[1<<LUT_NBITS][AVPALETTE_COUNT] = av_malloc(3 * sizeof(*dmin));
+    uint16_t (*dmax)[1<<LUT_NBITS][AVPALETTE_COUNT] = av_malloc(3 * sizeof(*dmax));
+    int i, c, v, r, g, b, nb_entries = 0, ret = 0;
+
+    if (!dmin || !dmax) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    /* distances along every component from the palette colors to the
+     * nearest and the farthest color of every cell */
+    for (i = 0; i < AVPALETTE_COUNT; i++) {
+        for (c = 0; c < 3; c++) {
+            const int p = palette[i] >> (16 - 8 * c) & 0xff;
+            for (v = 0; v < 1 << LUT_NBITS; v++) {
+                const int lo = v * cell_size, hi = lo + cell_size - 1;
+                const int d = p < lo ? lo - p : p > hi ? p - hi : 0;
+                const int dm = FFMAX(FFABS(p - lo), FFABS(p - hi));
+                dmin[c][v][i] = d;
+                dmax[c][v][i] = dm * dm;
+            }
+        }
+    }
+
+    for (r = 0; r < 1 << LUT_NBITS; r++) {
+        for (g = 0; g < 1 << LUT_NBITS; g++) {
+            for (b = 0; b < 1 << LUT_NBITS; b++) {
+                const int cell = r << (2 * LUT_NBITS) | g << LUT_NBITS | b;
+                int best_max = INT_MAX;
+                uint8_t *entries;
+
+                /* no color of the cell is farther than best_max from its
+                 * nearest palette color, so a palette color nearer than that
+                 * to none of them is never selected */
+                for (i = 0; i < AVPALETTE_COUNT; i++)
+                    if (palette[i] >> 24 >= trans_thresh)
+                        best_max = FFMIN(best_max, dmax[0][r][i] + dmax[1][g][i] + dmax[2][b][i]);
+
+                entries = av_fast_realloc(lut->entries, &lut->entries_size,
+                                          nb_entries + AVPALETTE_COUNT);
+                if (!entries) {
+                    ret = AVERROR(ENOMEM);
+                    goto end;
+                }
+                lut->entries = entries;
+
+                lut->offset[cell] = nb_entries;
+                for (i = 0; i < AVPALETTE_COUNT; i++) {
+                    if (palette[i] >> 24 >= trans_thresh &&
+                        dmin[0][r][i] * dmin[0][r][i] +
+                        dmin[1][g][i] * dmin[1][g][i] +
+                        dmin[2][b][i] * dmin[2][b][i] <= best_max)
+                        entries[nb_entries++] = i;
+                }
+            }
+        }
+    }
+    lut->offset[LUT_NB_CELLS] = nb_entries;
+
+end:
+    av_free(dmin);
+    av_free(dmax);
+    return ret;
+}
+
+static int load_colormap(PaletteUseContext *s)
 {
     int i, nb_used = 0;
     uint8_t color_used[AVPALETTE_COUNT] = {0};
@@ -766,13 +929,21 @@ static void load_colormap(PaletteUseContext *s)
 
     colormap_insert(s->map, color_used, &nb_used, s->palette, s->trans_thresh, &box);
 
+    if (s->color_search_method == COLOR_SEARCH_LUT) {
+        int ret = load_inverse_colormap(&s->lut, s->palette, s->trans_thresh);
+        if (ret < 0)
+            return ret;
+    }
+
     if (s->dot_filename)
         disp_tree(s->map, s->dot_filename);
 
     if (s->debug_accuracy) {
-        if (!debug_accuracy(s->map, s->palette, s->trans_thresh, s->color_search_method))
+        if (!debug_accuracy(s->map, s->palette, &s->lut, s->trans_thresh, s->color_search_method))
             av_log(NULL, AV_LOG_INFO, "Accuracy check passed\n");
     }
+
+    return 0;
 }
 
 static void debug_mean_error(PaletteUseContext *s, const AVFrame *in1,
@@ -894,6 +1065,84 @@ static void set_processing_window(enum diff_mode diff_mode,
     *hp = height;
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int x_start, y_start, w, h;
+    int nb_tiles_x, nb_tiles_y;
+    int wave;
+} ThreadData;
+
+static int set_frame_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int slice_start = td->y_start + (td->h *  jobnr   ) / nb_jobs;
+    const int slice_end   = td->y_start + (td->h * (jobnr+1)) / nb_jobs;
+
+    return s->set_frame(s, s->cache + jobnr * CACHE_SIZE, td->out, td->in,
+                        td->x_start, td->y_start, td->w, td->h,
+                        0, td->w, slice_start, slice_end);
+}
+
+static int set_frame_wave(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int ty_min = FFMAX(0, (td->wave - td->nb_tiles_x + 2) / 2);
+    const int ty_max = FFMIN(td->nb_tiles_y - 1, td->wave / 2);
+    int ty, ret;
+
+    for (ty = ty_min + jobnr; ty <= ty_max; ty += nb_jobs) {
+        const int tx = td->wave - 2 * ty;
+        ret = s->set_frame(s, s->cache + jobnr * CACHE_SIZE, td->out, td->in,
+                           td->x_start, td->y_start, td->w, td->h,
+                           tx * TILE_W, (tx + 1) * TILE_W,
+                           td->y_start + ty * TILE_H,
+                           td->y_start + FFMIN((ty + 1) * TILE_H, td->h));
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+static int set_frame_threaded(AVFilterContext *ctx, AVFrame *out, AVFrame *in,
+                              int x, int y, int w, int h)
+{
+    PaletteUseContext *s = ctx->priv;
+    const int nb_threads = FFMIN(ff_filter_get_nb_threads(ctx), s->nb_caches);
+    const int skew = diffusion_skew(s->dither);
+    ThreadData td = { .in = in, .out = out, .x_start = x, .y_start = y, .w = w, .h = h };
+    int i, nb_waves;
+
+    if (nb_threads <= 1)
+        return s->set_frame(s, s->cache, out, in, x, y, w, h,
+                            0, w + skew * h, y, y + h);
+
+    if (s->dither == DITHERING_NONE || s->dither == DITHERING_BAYER) {
+        const int nb_jobs = FFMIN(h, nb_threads);
+        ctx->internal->execute(ctx, set_frame_slice, &td, s->job_ret, nb_jobs);
+        for (i = 0; i < nb_jobs; i++)
+            if (s->job_ret[i] < 0)
+                return s->job_ret[i];
+        return 0;
+    }
+
+    td.nb_tiles_x = (w - 1 + skew * (h - 1)) / TILE_W + 1;
+    td.nb_tiles_y = (h + TILE_H - 1) / TILE_H;
+    nb_waves = td.nb_tiles_x + 2 * (td.nb_tiles_y - 1);
+    for (td.wave = 0; td.wave < nb_waves; td.wave++) {
+        const int ty_min = FFMAX(0, (td.wave - td.nb_tiles_x + 2) / 2);
+        const int ty_max = FFMIN(td.nb_tiles_y - 1, td.wave / 2);
+        const int nb_jobs = FFMIN(ty_max - ty_min + 1, nb_threads);
+
+        ctx->internal->execute(ctx, set_frame_wave, &td, s->job_ret, nb_jobs);
+        for (i = 0; i < nb_jobs; i++)
+            if (s->job_ret[i] < 0)
+                return s->job_ret[i];
+    }
+    return 0;
+}
+
 static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
 {
     int x, y, w, h, ret;
@@ -926,7 +1175,7 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     ff_dlog(ctx, "%dx%d rect: (%d;%d) -> (%d,%d) [area:%dx%d]\n",
             w, h, x, y, x+w, y+h, in->width, in->height);
 
-    ret = s->set_frame(s, out, in, x, y, w, h);
+    ret = set_frame_threaded(ctx, out, in, x, y, w, h);
     if (ret < 0) {
         av_frame_free(&out);
         *outf = NULL;
@@ -940,12 +1189,33 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     return 0;
 }
 
+static void reset_caches(PaletteUseContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->nb_caches * CACHE_SIZE; i++) {
+        av_freep(&s->cache[i].entries);
+        s->cache[i].nb_entries = 0;
+    }
+}
+
 static int config_output(AVFilterLink *outlink)
 {
     int ret;
     AVFilterContext *ctx = outlink->src;
     PaletteUseContext *s = ctx->priv;
 
+    reset_caches(s);
+    av_freep(&s->cache);
+    av_freep(&s->job_ret);
+    s->nb_caches = ff_filter_get_nb_threads(ctx);
+    s->cache   = av_calloc(s->nb_caches * CACHE_SIZE, sizeof(*s->cache));
+    s->job_ret = av_calloc(s->nb_caches, sizeof(*s->job_ret));
+    if (!s->cache || !s->job_ret) {
+        s->nb_caches = 0;
+        return AVERROR(ENOMEM);
+    }
+
     ret = ff_framesync_init_dualinput(&s->fs, ctx);
     if (ret < 0)
         return ret;
@@ -977,9 +1247,9 @@ static int config_input_palette(AVFilterLink *inlink)
     return 0;
 }
 
-static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
+static int load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
 {
-    int i, x, y;
+    int i, x, y, ret;
     const uint32_t *p = (const uint32_t *)palette_frame->data[0];
     const int p_linesize = palette_frame->linesize[0] >> 2;
 
@@ -988,9 +1258,7 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
     if (s->new) {
         memset(s->palette, 0, sizeof(s->palette));
         memset(s->map, 0, sizeof(s->map));
-        for (i = 0; i < CACHE_SIZE; i++)
-            av_freep(&s->cache[i].entries);
-        memset(s->cache, 0, sizeof(s->cache));
+        reset_caches(s);
     }
 
     i = 0;
@@ -1005,10 +1273,12 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
         p += p_linesize;
     }
 
-    load_colormap(s);
+    if ((ret = load_colormap(s)) < 0)
+        return ret;
 
     if (!s->new)
         s->palette_loaded = 1;
+    return 0;
 }
 
 static int load_apply_palette(FFFrameSync *fs)
@@ -1028,7 +1298,8 @@ static int load_apply_palette(FFFrameSync *fs)
         goto error;
     }
     if (!s->palette_loaded) {
-        load_palette(s, second);
+        if ((ret = load_palette(s, second)) < 0)
+            goto error;
     }
     ret = apply_palette(inlink, master, &out);
     if (ret < 0)
@@ -1041,10 +1312,13 @@ error:
 }
 
 #define DEFINE_SET_FRAME(color_search, name, value)                             \
-static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,    \
-                            int x_start, int y_start, int w, int h)             \
+static int set_frame_##name(PaletteUseContext *s, struct cache_node *cache,     \
+                            AVFrame *out, AVFrame *in,                          \
+                            int x_start, int y_start, int w, int h,             \
+                            int tx_start, int tx_end, int ty_start, int ty_end) \
 {                                                                               \
-    return set_frame(s, out, in, x_start, y_start, w, h, value, color_search);  \
+    return set_frame(s, cache, out, in, x_start, y_start, w, h,                 \
+                     tx_start, tx_end, ty_start, ty_end, value, color_search);  \
 }
 
 #define DEFINE_SET_FRAME_COLOR_SEARCH(color_search, color_search_macro)                                 \
@@ -1058,6 +1332,7 @@ static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,
 DEFINE_SET_FRAME_COLOR_SEARCH(nns_iterative, COLOR_SEARCH_NNS_ITERATIVE)
 DEFINE_SET_FRAME_COLOR_SEARCH(nns_recursive, COLOR_SEARCH_NNS_RECURSIVE)
 DEFINE_SET_FRAME_COLOR_SEARCH(bruteforce,    COLOR_SEARCH_BRUTEFORCE)
+DEFINE_SET_FRAME_COLOR_SEARCH(lut,           COLOR_SEARCH_LUT)
 
 #define DITHERING_ENTRIES(color_search) {       \
     set_frame_##color_search##_none,            \
@@ -1072,6 +1347,7 @@ static const set_frame_func set_frame_lut[NB_COLOR_SEARCHES][NB_DITHERING] = {
     DITHERING_ENTRIES(nns_iterative),
     DITHERING_ENTRIES(nns_recursive),
     DITHERING_ENTRIES(bruteforce),
+    DITHERING_ENTRIES(lut),
 };
 
 static int dither_value(int p)
@@ -1107,12 +1383,13 @@ static int activate(AVFilterContext *ctx)
 
 static av_cold void uninit(AVFilterContext *ctx)
 {
-    int i;
     PaletteUseContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
-    for (i = 0; i < CACHE_SIZE; i++)
-        av_freep(&s->cache[i].entries);
+    reset_caches(s);
+    av_freep(&s->cache);
+    av_freep(&s->job_ret);
+    av_freep(&s->lut.entries);
     av_frame_free(&s->last_in);
     av_frame_free(&s->last_out);
 }
@@ -1149,4 +1426,5 @@ AVFilter ff_vf_paletteuse = {
     .inputs        = paletteuse_inputs,
     .outputs       = paletteuse_outputs,
     .priv_class    = &paletteuse_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -59,13 +59,20 @@ typedef struct SSIMContext {
     uint8_t rgba_map[4];
     int planewidth[4];
     int planeheight[4];
-    int *temp;
+    int depth;
+    int nb_threads;
+    void **temp;
+    float *line_ssim[4];
+    uint64_t (*sse)[4];
     int is_rgb;
-    float (*ssim_plane)(SSIMDSPContext *dsp,
-                        uint8_t *main, int main_stride,
-                        uint8_t *ref, int ref_stride,
-                        int width, int height, void *temp,
-                        int max);
+    int psnr;
+    double mse_comp[4], mse_total, min_mse, max_mse;
+    void (*ssim_plane)(SSIMDSPContext *dsp,
+                       uint8_t *main, int main_stride,
+                       uint8_t *ref, int ref_stride,
+                       int width, int z_start, int z_end,
+                       void *temp, int max,
+                       float *line_ssim, uint64_t *sse);
     SSIMDSPContext dsp;
 } SSIMContext;
 
@@ -75,6 +82,7 @@ typedef struct SSIMContext {
 static const AVOption ssim_options[] = {
     {"stats_file", "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
     {"f",          "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    {"psnr",       "Also compute the PSNR from the same pass over the frames", OFFSET(psnr), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS },
     { NULL }
 };
 
@@ -221,60 +229,156 @@ static float ssim_endn_8bit(const int (*sum0)[4], const int (*sum1)[4], int widt
 
 #define SUM_LEN(w) (((w) >> 2) + 3)
 
-static float ssim_plane_16bit(SSIMDSPContext *dsp,
-                              uint8_t *main, int main_stride,
-                              uint8_t *ref, int ref_stride,
-                              int width, int height, void *temp,
-                              int max)
+/*
+ * The squared error of a 4x4 block is ss - 2 * s12, so the PSNR comes for
+ * free with the block sums.
+ */
+static uint64_t sse_sums_16bit(const int64_t (*sums)[4], int width)
 {
-    int z = 0, y;
-    float ssim = 0.0;
+    uint64_t sse = 0;
+    int i;
+
+    for (i = 0; i < width; i++)
+        sse += sums[i][2] - 2 * sums[i][3];
+    return sse;
+}
+
+static uint64_t sse_sums_8bit(const int (*sums)[4], int width)
+{
+    uint64_t sse = 0;
+    int i;
+
+    for (i = 0; i < width; i++)
+        sse += sums[i][2] - 2 * sums[i][3];
+    return sse;
+}
+
+/*
+ * Compute the 4x4 block sums of the block lines [z_start - 1, z_end) and
+ * store the SSIM of the block lines [z_start, z_end) except the first one,
+ * which has no block line above. If sse is not NULL, the squared error of
+ * the blocks of the lines [z_start, z_end) is added to it.
+ */
+static void ssim_plane_16bit(SSIMDSPContext *dsp,
+                             uint8_t *main, int main_stride,
+                             uint8_t *ref, int ref_stride,
+                             int width, int z_start, int z_end,
+                             void *temp, int max,
+                             float *line_ssim, uint64_t *sse)
+{
+    int z = FFMAX(z_start - 1, 0);
     int64_t (*sum0)[4] = temp;
     int64_t (*sum1)[4] = sum0 + SUM_LEN(width);
 
     width >>= 2;
-    height >>= 2;
-
-    for (y = 1; y < height; y++) {
-        for (; z <= y; z++) {
-            FFSWAP(void*, sum0, sum1);
-            ssim_4x4xn_16bit(&main[4 * z * main_stride], main_stride,
-                             &ref[4 * z * ref_stride], ref_stride,
-                             sum0, width);
-        }
 
-        ssim += ssim_endn_16bit((const int64_t (*)[4])sum0, (const int64_t (*)[4])sum1, width - 1, max);
+    for (; z < z_end; z++) {
+        FFSWAP(void*, sum0, sum1);
+        ssim_4x4xn_16bit(&main[4 * z * main_stride], main_stride,
+                         &ref[4 * z * ref_stride], ref_stride,
+                         sum0, width);
+        if (z < z_start)
+            continue;
+        if (sse)
+            *sse += sse_sums_16bit((const int64_t (*)[4])sum0, width);
+        if (z)
+            line_ssim[z] = ssim_endn_16bit((const int64_t (*)[4])sum0, (const int64_t (*)[4])sum1, width - 1, max);
     }
-
-    return ssim / ((height - 1) * (width - 1));
 }
 
-static float ssim_plane(SSIMDSPContext *dsp,
-                        uint8_t *main, int main_stride,
-                        uint8_t *ref, int ref_stride,
-                        int width, int height, void *temp,
-                        int max)
+static void ssim_plane(SSIMDSPContext *dsp,
+                       uint8_t *main, int main_stride,
+                       uint8_t *ref, int ref_stride,
+                       int width, int z_start, int z_end,
+                       void *temp, int max,
+                       float *line_ssim, uint64_t *sse)
 {
-    int z = 0, y;
-    float ssim = 0.0;
+    int z = FFMAX(z_start - 1, 0);
     int (*sum0)[4] = temp;
     int (*sum1)[4] = sum0 + SUM_LEN(width);
 
     width >>= 2;
-    height >>= 2;
-
-    for (y = 1; y < height; y++) {
-        for (; z <= y; z++) {
-            FFSWAP(void*, sum0, sum1);
-            dsp->ssim_4x4_line(&main[4 * z * main_stride], main_stride,
-                               &ref[4 * z * ref_stride], ref_stride,
-                               sum0, width);
+
+    for (; z < z_end; z++) {
+        FFSWAP(void*, sum0, sum1);
+        dsp->ssim_4x4_line(&main[4 * z * main_stride], main_stride,
+                           &ref[4 * z * ref_stride], ref_stride,
+                           sum0, width);
+        if (z < z_start)
+            continue;
+        if (sse)
+            *sse += sse_sums_8bit((const int (*)[4])sum0, width);
+        if (z)
+            line_ssim[z] = dsp->ssim_end_line((const int (*)[4])sum0, (const int (*)[4])sum1, width - 1);
+    }
+}
+
+/* Squared error of the pixels outside of the 4x4 blocks */
+static uint64_t sse_area(const uint8_t *main, int main_stride,
+                         const uint8_t *ref, int ref_stride,
+                         int x_start, int x_end, int y_start, int y_end, int depth)
+{
+    uint64_t sse = 0;
+    int x, y;
+
+    main += y_start * main_stride;
+    ref  += y_start * ref_stride;
+    for (y = y_start; y < y_end; y++) {
+        if (depth > 8) {
+            const uint16_t *main16 = (const uint16_t *)main;
+            const uint16_t *ref16  = (const uint16_t *)ref;
+            for (x = x_start; x < x_end; x++)
+                sse += (int64_t)(main16[x] - ref16[x]) * (main16[x] - ref16[x]);
+        } else {
+            for (x = x_start; x < x_end; x++)
+                sse += (main[x] - ref[x]) * (main[x] - ref[x]);
         }
+        main += main_stride;
+        ref  += ref_stride;
+    }
+    return sse;
+}
 
-        ssim += dsp->ssim_end_line((const int (*)[4])sum0, (const int (*)[4])sum1, width - 1);
+typedef struct ThreadData {
+    AVFrame *main, *ref;
+} ThreadData;
+
+static int ssim_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    SSIMContext *s = ctx->priv;
+    ThreadData *td = arg;
+    int i;
+
+    for (i = 0; i < s->nb_components; i++) {
+        const int w = s->planewidth[i], h = s->planeheight[i];
+        const int z_start = (h >> 2) *  jobnr      / nb_jobs;
+        const int z_end   = (h >> 2) * (jobnr + 1) / nb_jobs;
+        uint8_t *main = td->main->data[i], *ref = td->ref->data[i];
+        const int main_stride = td->main->linesize[i];
+        const int ref_stride  = td->ref->linesize[i];
+        uint64_t *sse = s->psnr ? &s->sse[jobnr][i] : NULL;
+
+        if (sse)
+            *sse = 0;
+        if (z_start < z_end)
+            s->ssim_plane(&s->dsp, main, main_stride, ref, ref_stride,
+                          w, z_start, z_end, s->temp[jobnr], s->max,
+                          s->line_ssim[i], sse);
+        if (sse) {
+            *sse += sse_area(main, main_stride, ref, ref_stride,
+                             w & ~3, w, 4 * z_start, 4 * z_end, s->depth);
+            if (jobnr == nb_jobs - 1)
+                *sse += sse_area(main, main_stride, ref, ref_stride,
+                                 0, w, h & ~3, h, s->depth);
+        }
     }
 
-    return ssim / ((height - 1) * (width - 1));
+    return 0;
+}
+
+static inline double get_psnr(double mse, uint64_t nb_frames, int max)
+{
+    return 10.0 * log10((double)max * max / (mse / nb_frames));
 }
 
 static double ssim_db(double ssim, double weight)
@@ -288,8 +392,10 @@ static int do_ssim(FFFrameSync *fs)
     SSIMContext *s = ctx->priv;
     AVFrame *master, *ref;
     AVDictionary **metadata;
+    ThreadData td;
     float c[4], ssimv = 0.0;
-    int ret, i;
+    double comp_mse[4], mse = 0;
+    int ret, i, j, nb_jobs;
 
     ret = ff_framesync_dualinput_get(fs, &master, &ref);
     if (ret < 0)
@@ -300,13 +406,30 @@ static int do_ssim(FFFrameSync *fs)
 
     s->nb_frames++;
 
+    td.main = master;
+    td.ref  = ref;
+    nb_jobs = FFMAX(1, FFMIN(s->planeheight[1] >> 2, s->nb_threads));
+    ctx->internal->execute(ctx, ssim_slice, &td, NULL, nb_jobs);
+
     for (i = 0; i < s->nb_components; i++) {
-        c[i] = s->ssim_plane(&s->dsp, master->data[i], master->linesize[i],
-                             ref->data[i], ref->linesize[i],
-                             s->planewidth[i], s->planeheight[i], s->temp,
-                             s->max);
+        const int width = s->planewidth[i] >> 2, height = s->planeheight[i] >> 2;
+        float ssim = 0.0;
+
+        /* sum the lines in order, the result does not depend on the slices */
+        for (j = 1; j < height; j++)
+            ssim += s->line_ssim[i][j];
+        c[i] = ssim / ((height - 1) * (width - 1));
         ssimv += s->coefs[i] * c[i];
         s->ssim[i] += c[i];
+
+        if (s->psnr) {
+            uint64_t sse = 0;
+            for (j = 0; j < nb_jobs; j++)
+                sse += s->sse[j][i];
+            comp_mse[i] = sse / (double)(s->planewidth[i] * s->planeheight[i]);
+            mse += comp_mse[i] * s->coefs[i];
+            s->mse_comp[i] += comp_mse[i];
+        }
     }
     for (i = 0; i < s->nb_components; i++) {
         int cidx = s->is_rgb ? s->rgba_map[i] : i;
@@ -317,6 +440,20 @@ static int do_ssim(FFFrameSync *fs)
     set_meta(metadata, "lavfi.ssim.All", 0, ssimv);
     set_meta(metadata, "lavfi.ssim.dB", 0, ssim_db(ssimv, 1.0));
 
+    if (s->psnr) {
+        s->min_mse = FFMIN(s->min_mse, mse);
+        s->max_mse = FFMAX(s->max_mse, mse);
+        s->mse_total += mse;
+
+        for (i = 0; i < s->nb_components; i++) {
+            int cidx = s->is_rgb ? s->rgba_map[i] : i;
+            set_meta(metadata, "lavfi.psnr.mse.", av_tolower(s->comps[i]), comp_mse[cidx]);
+            set_meta(metadata, "lavfi.psnr.psnr.", av_tolower(s->comps[i]), get_psnr(comp_mse[cidx], 1, s->max));
+        }
+        set_meta(metadata, "lavfi.psnr.mse_avg", 0, mse);
+        set_meta(metadata, "lavfi.psnr.psnr_avg", 0, get_psnr(mse, 1, s->max));
+    }
+
     if (s->stats_file) {
         fprintf(s->stats_file, "n:%"PRId64" ", s->nb_frames);
 
@@ -325,7 +462,17 @@ static int do_ssim(FFFrameSync *fs)
             fprintf(s->stats_file, "%c:%f ", s->comps[i], c[cidx]);
         }
 
-        fprintf(s->stats_file, "All:%f (%f)\n", ssimv, ssim_db(ssimv, 1.0));
+        fprintf(s->stats_file, "All:%f (%f)", ssimv, ssim_db(ssimv, 1.0));
+
+        if (s->psnr) {
+            for (i = 0; i < s->nb_components; i++) {
+                int cidx = s->is_rgb ? s->rgba_map[i] : i;
+                fprintf(s->stats_file, " psnr_%c:%0.2f", av_tolower(s->comps[i]),
+                        get_psnr(comp_mse[cidx], 1, s->max));
+            }
+            fprintf(s->stats_file, " psnr_avg:%0.2f", get_psnr(mse, 1, s->max));
+        }
+        fprintf(s->stats_file, "\n");
     }
 
     return ff_filter_frame(ctx->outputs[0], master);
@@ -335,6 +482,9 @@ static av_cold int init(AVFilterContext *ctx)
 {
     SSIMContext *s = ctx->priv;
 
+    s->min_mse = +INFINITY;
+    s->max_mse = -INFINITY;
+
     if (s->stats_file_str) {
         if (!strcmp(s->stats_file_str, "-")) {
             s->stats_file = stdout;
@@ -410,12 +560,26 @@ static int config_input_ref(AVFilterLink *inlink)
     for (i = 0; i < s->nb_components; i++)
         s->coefs[i] = (double) s->planeheight[i] * s->planewidth[i] / sum;
 
-    s->temp = av_mallocz_array(2 * SUM_LEN(inlink->w), (desc->comp[0].depth > 8) ? sizeof(int64_t[4]) : sizeof(int[4]));
-    if (!s->temp)
+    s->depth = desc->comp[0].depth;
+    s->max = (1 << s->depth) - 1;
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+
+    s->temp = av_mallocz_array(s->nb_threads, sizeof(*s->temp));
+    s->sse  = av_mallocz_array(s->nb_threads, sizeof(*s->sse));
+    if (!s->temp || !s->sse)
         return AVERROR(ENOMEM);
-    s->max = (1 << desc->comp[0].depth) - 1;
+    for (i = 0; i < s->nb_threads; i++) {
+        s->temp[i] = av_mallocz_array(2 * SUM_LEN(inlink->w), (s->depth > 8) ? sizeof(int64_t[4]) : sizeof(int[4]));
+        if (!s->temp[i])
+            return AVERROR(ENOMEM);
+    }
+    for (i = 0; i < s->nb_components; i++) {
+        s->line_ssim[i] = av_malloc_array((s->planeheight[i] >> 2) + 1, sizeof(*s->line_ssim[i]));
+        if (!s->line_ssim[i])
+            return AVERROR(ENOMEM);
+    }
 
-    s->ssim_plane = desc->comp[0].depth > 8 ? ssim_plane_16bit : ssim_plane;
+    s->ssim_plane = s->depth > 8 ? ssim_plane_16bit : ssim_plane;
     s->dsp.ssim_4x4_line = ssim_4x4xn_8bit;
     s->dsp.ssim_end_line = ssim_endn_8bit;
     if (ARCH_X86)
@@ -455,10 +619,10 @@ static int activate(AVFilterContext *ctx)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     SSIMContext *s = ctx->priv;
+    int i;
 
     if (s->nb_frames > 0) {
         char buf[256];
-        int i;
         buf[0] = 0;
         for (i = 0; i < s->nb_components; i++) {
             int c = s->is_rgb ? s->rgba_map[i] : i;
@@ -467,6 +631,19 @@ static av_cold void uninit(AVFilterContext *ctx)
         }
         av_log(ctx, AV_LOG_INFO, "SSIM%s All:%f (%f)\n", buf,
                s->ssim_total / s->nb_frames, ssim_db(s->ssim_total, s->nb_frames));
+
+        if (s->psnr) {
+            buf[0] = 0;
+            for (i = 0; i < s->nb_components; i++) {
+                int c = s->is_rgb ? s->rgba_map[i] : i;
+                av_strlcatf(buf, sizeof(buf), " %c:%f", av_tolower(s->comps[i]),
+                            get_psnr(s->mse_comp[c], s->nb_frames, s->max));
+            }
+            av_log(ctx, AV_LOG_INFO, "PSNR%s average:%f min:%f max:%f\n", buf,
+                   get_psnr(s->mse_total, s->nb_frames, s->max),
+                   get_psnr(s->max_mse, 1, s->max),
+                   get_psnr(s->min_mse, 1, s->max));
+        }
     }
 
     ff_framesync_uninit(&s->fs);
@@ -474,7 +651,13 @@ static av_cold void uninit(AVFilterContext *ctx)
     if (s->stats_file && s->stats_file != stdout)
         fclose(s->stats_file);
 
+    if (s->temp)
+        for (i = 0; i < s->nb_threads; i++)
+            av_freep(&s->temp[i]);
     av_freep(&s->temp);
+    av_freep(&s->sse);
+    for (i = 0; i < 4; i++)
+        av_freep(&s->line_ssim[i]);
 }
 
 static const AVFilterPad ssim_inputs[] = {
@@ -510,4 +693,5 @@ AVFilter ff_vf_ssim = {
     .priv_class    = &ssim_class,
     .inputs        = ssim_inputs,
     .outputs       = ssim_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
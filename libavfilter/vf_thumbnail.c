@@ -44,6 +44,9 @@ typedef struct ThumbContext {
     int n_frames;               ///< number of frames for analysis
     struct thumb_frame *frames; ///< the n_frames frames
     AVRational tb;              ///< copy of the input timebase to ease access
+
+    int nb_threads;
+    int *thread_histogram;      ///< histograms computed by each job
 } ThumbContext;
 
 #define OFFSET(x) offsetof(ThumbContext, x)
@@ -128,6 +131,32 @@ static AVFrame *get_best_frame(AVFilterContext *ctx)
     return picref;
 }
 
+static int do_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThumbContext *s = ctx->priv;
+    AVFrame *frame = arg;
+    int *hist = s->thread_histogram + HIST_SIZE * jobnr;
+    const int h = frame->height;
+    const int w = frame->width;
+    const int slice_start = (h * jobnr) / nb_jobs;
+    const int slice_end = (h * (jobnr+1)) / nb_jobs;
+    const uint8_t *p = frame->data[0] + slice_start * frame->linesize[0];
+    int i, j;
+
+    memset(hist, 0, sizeof(*hist) * HIST_SIZE);
+
+    for (j = slice_start; j < slice_end; j++) {
+        for (i = 0; i < w; i++) {
+            hist[0*256 + p[i*3    ]]++;
+            hist[1*256 + p[i*3 + 1]]++;
+            hist[2*256 + p[i*3 + 2]]++;
+        }
+        p += frame->linesize[0];
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
 {
     int i, j;
@@ -135,19 +164,17 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
     ThumbContext *s   = ctx->priv;
     AVFilterLink *outlink = ctx->outputs[0];
     int *hist = s->frames[s->n].histogram;
-    const uint8_t *p = frame->data[0];
+    const int nb_jobs = av_clip(inlink->h, 1, s->nb_threads);
 
     // keep a reference of each frame
     s->frames[s->n].buf = frame;
 
     // update current frame RGB histogram
-    for (j = 0; j < inlink->h; j++) {
-        for (i = 0; i < inlink->w; i++) {
-            hist[0*256 + p[i*3    ]]++;
-            hist[1*256 + p[i*3 + 1]]++;
-            hist[2*256 + p[i*3 + 2]]++;
-        }
-        p += frame->linesize[0];
+    ctx->internal->execute(ctx, do_slice, frame, NULL, nb_jobs);
+    for (j = 0; j < nb_jobs; j++) {
+        const int *thread_histogram = s->thread_histogram + HIST_SIZE * j;
+        for (i = 0; i < HIST_SIZE; i++)
+            hist[i] += thread_histogram[i];
     }
 
     // no selection until the buffer of N frames is filled up
@@ -165,6 +192,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     for (i = 0; i < s->n_frames && s->frames[i].buf; i++)
         av_frame_free(&s->frames[i].buf);
     av_freep(&s->frames);
+    av_freep(&s->thread_histogram);
 }
 
 static int request_frame(AVFilterLink *link)
@@ -189,6 +217,12 @@ static int config_props(AVFilterLink *inlink)
     AVFilterContext *ctx = inlink->dst;
     ThumbContext *s = ctx->priv;
 
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    av_freep(&s->thread_histogram);
+    s->thread_histogram = av_calloc(s->nb_threads, HIST_SIZE * sizeof(*s->thread_histogram));
+    if (!s->thread_histogram)
+        return AVERROR(ENOMEM);
+
     s->tb = inlink->time_base;
     return 0;
 }
@@ -234,4 +268,5 @@ AVFilter ff_vf_thumbnail = {
     .inputs        = thumbnail_inputs,
     .outputs       = thumbnail_outputs,
     .priv_class    = &thumbnail_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -38,17 +38,7 @@
 #include "formats.h"
 #include "internal.h"
 #include "video.h"
-
-enum TonemapAlgorithm {
-    TONEMAP_NONE,
-    TONEMAP_LINEAR,
-    TONEMAP_GAMMA,
-    TONEMAP_CLIP,
-    TONEMAP_REINHARD,
-    TONEMAP_HABLE,
-    TONEMAP_MOBIUS,
-    TONEMAP_MAX,
-};
+#include "vf_tonemap.h"
 
 static const struct LumaCoefficients luma_coefficients[AVCOL_SPC_NB] = {
     [AVCOL_SPC_FCC]        = { 0.30,   0.59,   0.11   },
@@ -69,6 +59,8 @@ typedef struct TonemapContext {
     double peak;
 
     const struct LumaCoefficients *coeffs;
+
+    TonemapDSPContext dsp;
 } TonemapContext;
 
 static const enum AVPixelFormat pix_fmts[] = {
@@ -104,6 +96,8 @@ static av_cold int init(AVFilterContext *ctx)
     if (isnan(s->param))
         s->param = 1.0f;
 
+    ff_tonemap_init(&s->dsp);
+
     return 0;
 }
 
@@ -113,88 +107,178 @@ static float hable(float in)
     return (in * (in * a + b * c) + d * e) / (in * (in * a + b) + d * f) - e / f;
 }
 
-static float mobius(float in, float j, double peak)
-{
-    float a, b;
-
-    if (in <= j)
-        return in;
-
-    a = -j * j * (peak - 1.0f) / (j * j - 2.0f * j + peak);
-    b = (j * j - 2.0f * j * peak + peak) / FFMAX(peak - 1.0f, 1e-6);
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    double peak;
+} ThreadData;
 
-    return (b * b + 2.0f * b * j + j * j) / (b - a) * (in + a) / (in + b);
+static void init_curve(TonemapContext *s, TonemapCurve *c, double peak)
+{
+    float j = s->param;
+
+    c->coeffs[0]  = s->coeffs->cr;
+    c->coeffs[1]  = s->coeffs->cg;
+    c->coeffs[2]  = s->coeffs->cb;
+    c->desat      = s->desat;
+    c->peak       = peak;
+    c->param      = s->param;
+    c->linear     = s->param / peak;
+    c->gamma      = 1.0f / s->param;
+    c->gamma_low  = pow(0.05f / peak, c->gamma);
+    c->reinhard   = (peak + s->param) / peak;
+    c->hable_peak = hable(peak);
+
+    c->mobius_j     = j;
+    c->mobius_a     = -j * j * (peak - 1.0f) / (j * j - 2.0f * j + peak);
+    c->mobius_b     = (j * j - 2.0f * j * peak + peak) / FFMAX(peak - 1.0f, 1e-6);
+    c->mobius_scale = (c->mobius_b * c->mobius_b + 2.0f * c->mobius_b * j + j * j) /
+                      (c->mobius_b - c->mobius_a);
 }
 
 #define MIX(x,y,a) (x) * (1 - (a)) + (y) * (a)
-static void tonemap(TonemapContext *s, AVFrame *out, const AVFrame *in,
-                    const AVPixFmtDescriptor *desc, int x, int y, double peak)
+/* all in single precision and in the operation order of x86/vf_tonemap.asm,
+ * so that both give the same output */
+static av_always_inline void tonemap_row(float *r_out, float *g_out, float *b_out,
+                                         const float *r_in, const float *g_in,
+                                         const float *b_in, int width,
+                                         const TonemapCurve *c,
+                                         enum TonemapAlgorithm algo, int desat)
 {
-    const float *r_in = (const float *)(in->data[0] + x * desc->comp[0].step + y * in->linesize[0]);
-    const float *b_in = (const float *)(in->data[1] + x * desc->comp[1].step + y * in->linesize[1]);
-    const float *g_in = (const float *)(in->data[2] + x * desc->comp[2].step + y * in->linesize[2]);
-    float *r_out = (float *)(out->data[0] + x * desc->comp[0].step + y * out->linesize[0]);
-    float *b_out = (float *)(out->data[1] + x * desc->comp[1].step + y * out->linesize[1]);
-    float *g_out = (float *)(out->data[2] + x * desc->comp[2].step + y * out->linesize[2]);
-    float sig, sig_orig;
-
-    /* load values */
-    *r_out = *r_in;
-    *b_out = *b_in;
-    *g_out = *g_in;
-
-    /* desaturate to prevent unnatural colors */
-    if (s->desat > 0) {
-        float luma = s->coeffs->cr * *r_in + s->coeffs->cg * *g_in + s->coeffs->cb * *b_in;
-        float overbright = FFMAX(luma - s->desat, 1e-6) / FFMAX(luma, 1e-6);
-        *r_out = MIX(*r_in, luma, overbright);
-        *g_out = MIX(*g_in, luma, overbright);
-        *b_out = MIX(*b_in, luma, overbright);
+    const float cr = c->coeffs[0], cg = c->coeffs[1], cb = c->coeffs[2];
+    int x;
+
+    for (x = 0; x < width; x++) {
+        float r = r_in[x], g = g_in[x], b = b_in[x];
+        float sig, sig_orig;
+
+        /* desaturate to prevent unnatural colors */
+        if (desat) {
+            float luma = cr * r + cg * g + cb * b;
+            float overbright = FFMAX(luma - c->desat, 1e-6f) / FFMAX(luma, 1e-6f);
+            r = MIX(r, luma, overbright);
+            g = MIX(g, luma, overbright);
+            b = MIX(b, luma, overbright);
+        }
+
+        /* pick the brightest component, reducing the value range as necessary
+         * to keep the entire signal in range and preventing discoloration due to
+         * out-of-bounds clipping */
+        sig = FFMAX(FFMAX3(r, g, b), 1e-6f);
+        sig_orig = sig;
+
+        switch(algo) {
+        default:
+        case TONEMAP_NONE:
+            // do nothing
+            break;
+        case TONEMAP_LINEAR:
+            sig = sig * c->linear;
+            break;
+        case TONEMAP_GAMMA:
+            sig = sig > 0.05f ? pow(sig / c->peak, c->gamma)
+                              : sig * c->gamma_low / 0.05f;
+            break;
+        case TONEMAP_CLIP:
+            sig = av_clipf(sig * c->param, 0, 1.0f);
+            break;
+        case TONEMAP_HABLE:
+            sig = hable(sig) / c->hable_peak;
+            break;
+        case TONEMAP_REINHARD:
+            sig = sig / (sig + c->param) * c->reinhard;
+            break;
+        case TONEMAP_MOBIUS:
+            if (sig > c->mobius_j)
+                sig = c->mobius_scale * (sig + c->mobius_a) / (sig + c->mobius_b);
+            break;
+        }
+
+        /* apply the computed scale factor to the color,
+         * linearly to prevent discoloration */
+        r_out[x] = r * (sig / sig_orig);
+        g_out[x] = g * (sig / sig_orig);
+        b_out[x] = b * (sig / sig_orig);
     }
+}
 
-    /* pick the brightest component, reducing the value range as necessary
-     * to keep the entire signal in range and preventing discoloration due to
-     * out-of-bounds clipping */
-    sig = FFMAX(FFMAX3(*r_out, *g_out, *b_out), 1e-6);
-    sig_orig = sig;
+#define TONEMAP_ROW_FUNCS(name, algo)                                       \
+static void tonemap_row_##name##_c(float *r_out, float *g_out, float *b_out,\
+                                   const float *r_in, const float *g_in,    \
+                                   const float *b_in, int width,            \
+                                   const TonemapCurve *c)                   \
+{                                                                           \
+    tonemap_row(r_out, g_out, b_out, r_in, g_in, b_in, width, c, algo, 0);  \
+}                                                                           \
+                                                                            \
+static void tonemap_row_##name##_desat_c(float *r_out, float *g_out,        \
+                                         float *b_out, const float *r_in,   \
+                                         const float *g_in,                 \
+                                         const float *b_in, int width,      \
+                                         const TonemapCurve *c)             \
+{                                                                           \
+    tonemap_row(r_out, g_out, b_out, r_in, g_in, b_in, width, c, algo, 1);  \
+}
 
-    switch(s->tonemap) {
-    default:
-    case TONEMAP_NONE:
-        // do nothing
-        break;
-    case TONEMAP_LINEAR:
-        sig = sig * s->param / peak;
-        break;
-    case TONEMAP_GAMMA:
-        sig = sig > 0.05f ? pow(sig / peak, 1.0f / s->param)
-                          : sig * pow(0.05f / peak, 1.0f / s->param) / 0.05f;
-        break;
-    case TONEMAP_CLIP:
-        sig = av_clipf(sig * s->param, 0, 1.0f);
-        break;
-    case TONEMAP_HABLE:
-        sig = hable(sig) / hable(peak);
-        break;
-    case TONEMAP_REINHARD:
-        sig = sig / (sig + s->param) * (peak + s->param) / peak;
-        break;
-    case TONEMAP_MOBIUS:
-        sig = mobius(sig, s->param, peak);
-        break;
+TONEMAP_ROW_FUNCS(none,     TONEMAP_NONE)
+TONEMAP_ROW_FUNCS(linear,   TONEMAP_LINEAR)
+TONEMAP_ROW_FUNCS(gamma,    TONEMAP_GAMMA)
+TONEMAP_ROW_FUNCS(clip,     TONEMAP_CLIP)
+TONEMAP_ROW_FUNCS(reinhard, TONEMAP_REINHARD)
+TONEMAP_ROW_FUNCS(hable,    TONEMAP_HABLE)
+TONEMAP_ROW_FUNCS(mobius,   TONEMAP_MOBIUS)
+
+#define SET_ROW_FUNCS(algo, name)                                           \
+    dsp->tonemap_row[algo][0] = tonemap_row_##name##_c;                     \
+    dsp->tonemap_row[algo][1] = tonemap_row_##name##_desat_c
+
+void ff_tonemap_init(TonemapDSPContext *dsp)
+{
+    SET_ROW_FUNCS(TONEMAP_NONE,     none);
+    SET_ROW_FUNCS(TONEMAP_LINEAR,   linear);
+    SET_ROW_FUNCS(TONEMAP_GAMMA,    gamma);
+    SET_ROW_FUNCS(TONEMAP_CLIP,     clip);
+    SET_ROW_FUNCS(TONEMAP_REINHARD, reinhard);
+    SET_ROW_FUNCS(TONEMAP_HABLE,    hable);
+    SET_ROW_FUNCS(TONEMAP_MOBIUS,   mobius);
+
+    if (ARCH_X86)
+        ff_tonemap_init_x86(dsp);
+}
+
+static int tonemap_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    TonemapContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in, *out = td->out;
+    const int width = out->width;
+    const int slice_start = (out->height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (out->height * (jobnr + 1)) / nb_jobs;
+    tonemap_row_fn tonemap_row = s->dsp.tonemap_row[s->tonemap][s->desat > 0];
+    TonemapCurve c;
+    int y;
+
+    init_curve(s, &c, td->peak);
+
+    for (y = slice_start; y < slice_end; y++) {
+        const float *r_in = (const float *)(in->data[0] + y * in->linesize[0]);
+        const float *b_in = (const float *)(in->data[1] + y * in->linesize[1]);
+        const float *g_in = (const float *)(in->data[2] + y * in->linesize[2]);
+        float *r_out = (float *)(out->data[0] + y * out->linesize[0]);
+        float *b_out = (float *)(out->data[1] + y * out->linesize[1]);
+        float *g_out = (float *)(out->data[2] + y * out->linesize[2]);
+
+        tonemap_row(r_out, g_out, b_out, r_in, g_in, b_in, width, &c);
     }
 
-    /* apply the computed scale factor to the color,
-     * linearly to prevent discoloration */
-    *r_out *= sig / sig_orig;
-    *g_out *= sig / sig_orig;
-    *b_out *= sig / sig_orig;
+    return 0;
 }
 
 static int filter_frame(AVFilterLink *link, AVFrame *in)
 {
-    TonemapContext *s = link->dst->priv;
-    AVFilterLink *outlink = link->dst->outputs[0];
+    AVFilterContext *ctx = link->dst;
+    TonemapContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    ThreadData td;
     AVFrame *out;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(link->format);
     const AVPixFmtDescriptor *odesc = av_pix_fmt_desc_get(outlink->format);
@@ -245,9 +329,11 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     }
 
     /* do the tone map */
-    for (y = 0; y < out->height; y++)
-        for (x = 0; x < out->width; x++)
-            tonemap(s, out, in, desc, x, y, peak);
+    td.in   = in;
+    td.out  = out;
+    td.peak = peak;
+    ctx->internal->execute(ctx, tonemap_slice, &td, NULL,
+                           FFMIN(out->height, ff_filter_get_nb_threads(ctx)));
 
     /* copy/generate alpha if needed */
     if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
@@ -321,4 +407,5 @@ AVFilter ff_vf_tonemap = {
     .priv_class      = &tonemap_class,
     .inputs          = tonemap_inputs,
     .outputs         = tonemap_outputs,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,66 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_TONEMAP_H
+#define AVFILTER_TONEMAP_H
+
+enum TonemapAlgorithm {
+    TONEMAP_NONE,
+    TONEMAP_LINEAR,
+    TONEMAP_GAMMA,
+    TONEMAP_CLIP,
+    TONEMAP_REINHARD,
+    TONEMAP_HABLE,
+    TONEMAP_MOBIUS,
+    TONEMAP_MAX,
+};
+
+/**
+ * The parts of the curves which only depend on the parameters and the peak.
+ * The layout is mirrored in x86/vf_tonemap.asm.
+ */
+typedef struct TonemapCurve {
+    float coeffs[3];        ///< luma coefficients of r, g and b
+    float desat;            ///< desaturation strength
+    float peak;
+    float param;
+    float linear;           ///< param / peak
+    float gamma;            ///< 1 / param
+    float gamma_low;        ///< slope of the gamma curve below 0.05
+    float reinhard;         ///< (peak + param) / peak
+    float hable_peak;
+    float mobius_j, mobius_a, mobius_b, mobius_scale;
+} TonemapCurve;
+
+typedef void (*tonemap_row_fn)(float *r_out, float *g_out, float *b_out,
+                               const float *r_in, const float *g_in,
+                               const float *b_in, int width,
+                               const TonemapCurve *c);
+
+typedef struct TonemapDSPContext {
+    /**
+     * Tone map a row of width pixels, indexed by the algorithm and by
+     * whether desaturation is enabled.
+     */
+    tonemap_row_fn tonemap_row[TONEMAP_MAX][2];
+} TonemapDSPContext;
+
+void ff_tonemap_init(TonemapDSPContext *dsp);
+void ff_tonemap_init_x86(TonemapDSPContext *dsp);
+
+#endif /* AVFILTER_TONEMAP_H */
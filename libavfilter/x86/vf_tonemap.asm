@@ -0,0 +1,210 @@
+;*****************************************************************************
+;* x86-optimized functions for tonemap filter
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;*****************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+struc TonemapCurve
+    .coeffs:       resd 3
+    .desat:        resd 1
+    .peak:         resd 1
+    .param:        resd 1
+    .linear:       resd 1
+    .gamma:        resd 1
+    .gamma_low:    resd 1
+    .reinhard:     resd 1
+    .hable_peak:   resd 1
+    .mobius_j:     resd 1
+    .mobius_a:     resd 1
+    .mobius_b:     resd 1
+    .mobius_scale: resd 1
+endstruc
+
+SECTION_RODATA 32
+
+pd_0to7:     dd 0, 1, 2, 3, 4, 5, 6, 7
+pf_1:        times 8 dd 1.0
+pf_1e_6:     times 8 dd 0x358637BD ; 1e-6f
+; the constants of hable(), with the products and the quotient rounded to
+; float as the C code evaluates them
+pf_hable_a:  times 8 dd 0x3E19999A ; 0.15f
+pf_hable_b:  times 8 dd 0.5
+pf_hable_bc: times 8 dd 0x3D4CCCCD ; 0.50f * 0.10f
+pf_hable_de: times 8 dd 0x3B83126F ; 0.20f * 0.02f
+pf_hable_df: times 8 dd 0x3D75C290 ; 0.20f * 0.30f
+pf_hable_ef: times 8 dd 0x3D888888 ; 0.02f / 0.30f
+
+SECTION .text
+
+; the operations are those of tonemap_row() in vf_tonemap.c, in the same
+; order, so that the output is identical
+; in: m0-m2 r, g, b, m8-m15 curve constants; out: m0-m2; clobbers m3-m6
+%macro TONEMAP 2 ; algorithm, desat
+%if %2
+    mulps         m3, m8, m0
+    mulps         m4, m9, m1
+    addps         m3, m4
+    mulps         m4, m10, m2
+    addps         m3, m4               ; luma
+    subps         m4, m3, m11
+    maxps         m4, [pf_1e_6]
+    maxps         m5, m3, [pf_1e_6]
+    divps         m4, m5               ; overbright
+    mulps         m3, m4
+    mova          m5, [pf_1]
+    subps         m5, m4
+    mulps         m0, m5
+    mulps         m1, m5
+    mulps         m2, m5
+    addps         m0, m3
+    addps         m1, m3
+    addps         m2, m3
+%endif
+    maxps         m3, m0, m1
+    maxps         m3, m2
+    maxps         m3, [pf_1e_6]        ; sig_orig
+%ifidn %1, none
+    mova          m4, m3
+%elifidn %1, linear
+    mulps         m4, m3, m12
+%elifidn %1, clip
+    mulps         m4, m3, m12
+    minps         m4, m14
+    maxps         m4, m13
+%elifidn %1, reinhard
+    addps         m4, m3, m12
+    divps         m4, m3, m4
+    mulps         m4, m13
+%elifidn %1, hable
+    mulps         m5, m3, [pf_hable_a]
+    addps         m6, m5, [pf_hable_bc]
+    addps         m5, [pf_hable_b]
+    mulps         m6, m3
+    mulps         m5, m3
+    addps         m6, [pf_hable_de]
+    addps         m5, [pf_hable_df]
+    divps         m6, m5
+    subps         m6, [pf_hable_ef]
+    divps         m4, m6, m12
+%elifidn %1, mobius
+    addps         m4, m3, m13
+    mulps         m4, m15
+    addps         m5, m3, m14
+    divps         m4, m5
+    cmpps         m5, m12, m3, 1       ; j < sig
+    vblendvps     m4, m3, m4, m5
+%endif
+    divps         m4, m3               ; sig / sig_orig
+    mulps         m0, m4
+    mulps         m1, m4
+    mulps         m2, m4
+%endmacro
+
+; void ff_tonemap_row_<algorithm>[_desat](float *r_out, float *g_out,
+;                                         float *b_out, const float *r_in,
+;                                         const float *g_in, const float *b_in,
+;                                         int width, const TonemapCurve *c)
+%macro TONEMAP_ROW 2 ; algorithm, desat
+%if %2
+cglobal tonemap_row_%1_desat, 8, 8, 16, rout, gout, bout, rin, gin, bin, w, c
+%else
+cglobal tonemap_row_%1, 8, 8, 16, rout, gout, bout, rin, gin, bin, w, c
+%endif
+%if %2
+    vbroadcastss  m8, [cq + TonemapCurve.coeffs]
+    vbroadcastss  m9, [cq + TonemapCurve.coeffs + 4]
+    vbroadcastss m10, [cq + TonemapCurve.coeffs + 8]
+    vbroadcastss m11, [cq + TonemapCurve.desat]
+%endif
+%ifidn %1, linear
+    vbroadcastss m12, [cq + TonemapCurve.linear]
+%elifidn %1, clip
+    vbroadcastss m12, [cq + TonemapCurve.param]
+    xorps        m13, m13
+    mova         m14, [pf_1]
+%elifidn %1, reinhard
+    vbroadcastss m12, [cq + TonemapCurve.param]
+    vbroadcastss m13, [cq + TonemapCurve.reinhard]
+%elifidn %1, hable
+    vbroadcastss m12, [cq + TonemapCurve.hable_peak]
+%elifidn %1, mobius
+    vbroadcastss m12, [cq + TonemapCurve.mobius_j]
+    vbroadcastss m13, [cq + TonemapCurve.mobius_a]
+    vbroadcastss m14, [cq + TonemapCurve.mobius_b]
+    vbroadcastss m15, [cq + TonemapCurve.mobius_scale]
+%endif
+    movsxdifnidn  wq, wd
+    shl           wq, 2
+    add        routq, wq
+    add        goutq, wq
+    add        boutq, wq
+    add         rinq, wq
+    add         ginq, wq
+    add         binq, wq
+    neg           wq
+    add           wq, mmsize
+    jg .tail
+
+.loop:
+    movu          m0, [rinq + wq - mmsize]
+    movu          m1, [ginq + wq - mmsize]
+    movu          m2, [binq + wq - mmsize]
+    TONEMAP       %1, %2
+    movu  [routq + wq - mmsize], m0
+    movu  [goutq + wq - mmsize], m1
+    movu  [boutq + wq - mmsize], m2
+    add           wq, mmsize
+    jle .loop
+
+.tail:
+    sub           wq, mmsize
+    jz .end
+    ; mask of the width % 8 remaining pixels
+    mov           cq, wq
+    neg           cq
+    shr           cq, 2
+    movd         xm7, cd
+    vpbroadcastd  m7, xm7
+    pcmpgtd       m7, [pd_0to7]
+    vmaskmovps    m0, m7, [rinq + wq]
+    vmaskmovps    m1, m7, [ginq + wq]
+    vmaskmovps    m2, m7, [binq + wq]
+    TONEMAP       %1, %2
+    vmaskmovps [routq + wq], m7, m0
+    vmaskmovps [goutq + wq], m7, m1
+    vmaskmovps [boutq + wq], m7, m2
+.end:
+    RET
+%endmacro
+
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+TONEMAP_ROW none,     0
+TONEMAP_ROW none,     1
+TONEMAP_ROW linear,   0
+TONEMAP_ROW linear,   1
+TONEMAP_ROW clip,     0
+TONEMAP_ROW clip,     1
+TONEMAP_ROW reinhard, 0
+TONEMAP_ROW reinhard, 1
+TONEMAP_ROW hable,    0
+TONEMAP_ROW hable,    1
+TONEMAP_ROW mobius,   0
+TONEMAP_ROW mobius,   1
+%endif
@@ -0,0 +1,59 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/vf_tonemap.h"
+
+#define TONEMAP_ROW_FUNCS(name, opt)                                        \
+void ff_tonemap_row_##name##_##opt(float *r_out, float *g_out, float *b_out,\
+                                   const float *r_in, const float *g_in,    \
+                                   const float *b_in, int width,            \
+                                   const TonemapCurve *c);                  \
+void ff_tonemap_row_##name##_desat_##opt(float *r_out, float *g_out,        \
+                                         float *b_out, const float *r_in,   \
+                                         const float *g_in,                 \
+                                         const float *b_in, int width,      \
+                                         const TonemapCurve *c);
+
+TONEMAP_ROW_FUNCS(none,     avx2)
+TONEMAP_ROW_FUNCS(linear,   avx2)
+TONEMAP_ROW_FUNCS(clip,     avx2)
+TONEMAP_ROW_FUNCS(reinhard, avx2)
+TONEMAP_ROW_FUNCS(hable,    avx2)
+TONEMAP_ROW_FUNCS(mobius,   avx2)
+
+#define SET_ROW_FUNCS(algo, name, opt)                                      \
+    dsp->tonemap_row[algo][0] = ff_tonemap_row_##name##_##opt;              \
+    dsp->tonemap_row[algo][1] = ff_tonemap_row_##name##_desat_##opt
+
+av_cold void ff_tonemap_init_x86(TonemapDSPContext *dsp)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    /* gamma calls pow() for every pixel and stays in C */
+    if (ARCH_X86_64 && EXTERNAL_AVX2_FAST(cpu_flags)) {
+        SET_ROW_FUNCS(TONEMAP_NONE,     none,     avx2);
+        SET_ROW_FUNCS(TONEMAP_LINEAR,   linear,   avx2);
+        SET_ROW_FUNCS(TONEMAP_CLIP,     clip,     avx2);
+        SET_ROW_FUNCS(TONEMAP_REINHARD, reinhard, avx2);
+        SET_ROW_FUNCS(TONEMAP_HABLE,    hable,    avx2);
+        SET_ROW_FUNCS(TONEMAP_MOBIUS,   mobius,   avx2);
+    }
+}
@@ -23,6 +23,7 @@
 #include "buffer_internal.h"
 #include "common.h"
 #include "mem.h"
+#include "objcache_internal.h"
 #include "thread.h"
 
 AVBufferRef *av_buffer_create(uint8_t *data, int size,
@@ -32,7 +33,7 @@ AVBufferRef *av_buffer_create(uint8_t *data, int size,
     AVBufferRef *ref = NULL;
     AVBuffer    *buf = NULL;
 
-    buf = av_mallocz(sizeof(*buf));
+    buf = avpriv_objcache_alloc(FF_OBJCACHE_BUFFER, sizeof(*buf));
     if (!buf)
         return NULL;
 
@@ -46,9 +47,9 @@ AVBufferRef *av_buffer_create(uint8_t *data, int size,
     if (flags & AV_BUFFER_FLAG_READONLY)
         buf->flags |= BUFFER_FLAG_READONLY;
 
-    ref = av_mallocz(sizeof(*ref));
+    ref = avpriv_objcache_alloc(FF_OBJCACHE_BUFFERREF, sizeof(*ref));
     if (!ref) {
-        av_freep(&buf);
+        avpriv_objcache_free(FF_OBJCACHE_BUFFER, buf);
         return NULL;
     }
 
@@ -92,7 +93,7 @@ AVBufferRef *av_buffer_allocz(int size)
 
 AVBufferRef *av_buffer_ref(AVBufferRef *buf)
 {
-    AVBufferRef *ret = av_mallocz(sizeof(*ret));
+    AVBufferRef *ret = avpriv_objcache_alloc(FF_OBJCACHE_BUFFERREF, sizeof(*ret));
 
     if (!ret)
         return NULL;
@@ -112,13 +113,16 @@ static void buffer_replace(AVBufferRef **dst, AVBufferRef **src)
 
     if (src) {
         **dst = **src;
-        av_freep(src);
-    } else
-        av_freep(dst);
+        avpriv_objcache_free(FF_OBJCACHE_BUFFERREF, *src);
+        *src = NULL;
+    } else {
+        avpriv_objcache_free(FF_OBJCACHE_BUFFERREF, *dst);
+        *dst = NULL;
+    }
 
     if (atomic_fetch_add_explicit(&b->refcount, -1, memory_order_acq_rel) == 1) {
         b->free(b->opaque, b->data);
-        av_freep(&b);
+        avpriv_objcache_free(FF_OBJCACHE_BUFFER, b);
     }
 }
 
@@ -224,6 +228,7 @@ AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
         return NULL;
 
     ff_mutex_init(&pool->mutex, NULL);
+    atomic_init(&pool->free_list, 0);
 
     pool->size      = size;
     pool->opaque    = opaque;
@@ -242,6 +247,7 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
         return NULL;
 
     ff_mutex_init(&pool->mutex, NULL);
+    atomic_init(&pool->free_list, 0);
 
     pool->size     = size;
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
@@ -251,19 +257,58 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
     return pool;
 }
 
+static BufferPoolEntry *get_entry(AVBufferPool *pool, uintptr_t index)
+{
+    int k = av_log2(index);
+    return &pool->chunks[k][index - ((uintptr_t)1 << k)];
+}
+
+static BufferPoolEntry *pool_pop(AVBufferPool *pool)
+{
+    uintptr_t head = atomic_load_explicit(&pool->free_list, memory_order_acquire);
+    BufferPoolEntry *buf;
+    uintptr_t next;
+
+    do {
+        if (!(head & POOL_INDEX_MASK))
+            return NULL;
+        /* buf may be taken and returned concurrently, which bumps the tag
+         * and makes the exchange fail, but it is never freed */
+        buf  = get_entry(pool, head & POOL_INDEX_MASK);
+        next = atomic_load_explicit(&buf->next, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_list, &head,
+                 ((head & ~POOL_INDEX_MASK) + POOL_INDEX_MASK + 1) | next,
+                 memory_order_acquire, memory_order_acquire));
+
+    return buf;
+}
+
+static void pool_push(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    uintptr_t head = atomic_load_explicit(&pool->free_list, memory_order_relaxed);
+
+    do {
+        atomic_store_explicit(&buf->next, head & POOL_INDEX_MASK, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_list, &head,
+                 (head & ~POOL_INDEX_MASK) | buf->index,
+                 memory_order_release, memory_order_relaxed));
+}
+
 /*
  * This function gets called when the pool has been uninited and
  * all the buffers returned to it.
  */
 static void buffer_pool_free(AVBufferPool *pool)
 {
-    while (pool->pool) {
-        BufferPoolEntry *buf = pool->pool;
-        pool->pool = buf->next;
+    uintptr_t i;
+    int k;
 
+    for (i = 1; i <= pool->nb_entries; i++) {
+        BufferPoolEntry *buf = get_entry(pool, i);
         buf->free(buf->opaque, buf->data);
-        av_freep(&buf);
     }
+    for (k = 0; k < FF_ARRAY_ELEMS(pool->chunks); k++)
+        av_freep(&pool->chunks[k]);
     ff_mutex_destroy(&pool->mutex);
 
     if (pool->pool_free)
@@ -293,37 +338,42 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     if(CONFIG_MEMORY_POISONING)
         memset(buf->data, FF_MEMORY_POISON, pool->size);
 
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+    pool_push(pool, buf);
 
     if (atomic_fetch_add_explicit(&pool->refcount, -1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
 }
 
 /* allocate a new buffer and override its free() callback so that
- * it is returned to the pool on free */
+ * it is returned to the pool on free, must be called with the mutex held */
 static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
 {
+    const uintptr_t index = pool->nb_entries + 1;
+    const int k = av_log2(index);
     BufferPoolEntry *buf;
     AVBufferRef     *ret;
 
+    if (index > POOL_INDEX_MASK)
+        return NULL;
+    if (!pool->chunks[k]) {
+        pool->chunks[k] = av_mallocz_array((size_t)1 << k, sizeof(*pool->chunks[k]));
+        if (!pool->chunks[k])
+            return NULL;
+    }
+
     ret = pool->alloc2 ? pool->alloc2(pool->opaque, pool->size) :
                          pool->alloc(pool->size);
     if (!ret)
         return NULL;
 
-    buf = av_mallocz(sizeof(*buf));
-    if (!buf) {
-        av_buffer_unref(&ret);
-        return NULL;
-    }
-
+    buf = get_entry(pool, index);
     buf->data   = ret->buffer->data;
     buf->opaque = ret->buffer->opaque;
     buf->free   = ret->buffer->free;
     buf->pool   = pool;
+    buf->index  = index;
+    atomic_init(&buf->next, 0);
+    pool->nb_entries = index;
 
     ret->buffer->opaque = buf;
     ret->buffer->free   = pool_release_buffer;
@@ -336,19 +386,21 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     AVBufferRef *ret;
     BufferPoolEntry *buf;
 
-    ff_mutex_lock(&pool->mutex);
-    buf = pool->pool;
+    buf = pool_pop(pool);
+    if (!buf) {
+        ff_mutex_lock(&pool->mutex);
+        /* a buffer may have been returned in the meantime */
+        buf = pool_pop(pool);
+        if (!buf)
+            ret = pool_alloc_buffer(pool);
+        ff_mutex_unlock(&pool->mutex);
+    }
     if (buf) {
         ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
                                buf, 0);
-        if (ret) {
-            pool->pool = buf->next;
-            buf->next = NULL;
-        }
-    } else {
-        ret = pool_alloc_buffer(pool);
+        if (!ret)
+            pool_push(pool, buf);
     }
-    ff_mutex_unlock(&pool->mutex);
 
     if (ret)
         atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
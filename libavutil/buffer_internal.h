@@ -59,6 +59,14 @@ struct AVBuffer {
     int flags;
 };
 
+/*
+ * The available entries of a pool form a lock-free stack. Its head packs the
+ * index + 1 of the top entry (0 if empty) in the low POOL_INDEX_BITS bits and
+ * a tag, bumped on every pop to avoid the ABA problem, in the high bits.
+ */
+#define POOL_INDEX_BITS (sizeof(uintptr_t) * 4)
+#define POOL_INDEX_MASK (((uintptr_t)1 << POOL_INDEX_BITS) - 1)
+
 typedef struct BufferPoolEntry {
     uint8_t *data;
 
@@ -70,12 +78,26 @@ typedef struct BufferPoolEntry {
     void (*free)(void *opaque, uint8_t *data);
 
     AVBufferPool *pool;
-    struct BufferPoolEntry *next;
+    uintptr_t index;            ///< index + 1 of this entry
+    atomic_uintptr_t next;      ///< index + 1 of the next available entry
 } BufferPoolEntry;
 
 struct AVBufferPool {
+    /*
+     * Serializes the allocation of new buffers, the available ones are
+     * taken from and returned to free_list without locking.
+     */
     AVMutex mutex;
-    BufferPoolEntry *pool;
+    atomic_uintptr_t free_list;
+
+    /*
+     * The entries are allocated in chunks which are never moved, chunk k
+     * holds the entries with index + 1 in [1 << k, 2 << k), so they can be
+     * looked up without locking. nb_entries is only accessed with the mutex
+     * held or once all buffers have been returned.
+     */
+    BufferPoolEntry *chunks[POOL_INDEX_BITS];
+    uintptr_t nb_entries;
 
     /*
      * This is used to track when the pool is to be freed.
@@ -116,6 +116,32 @@ int av_parse_cpu_caps(unsigned *flags, const char *s);
  */
 int av_cpu_count(void);
 
+/**
+ * Set the number of worker threads of the process wide thread pool.
+ *
+ * While the pool is enabled, the slice threading of codecs and filters
+ * created afterwards runs on the pool workers instead of starting threads of
+ * its own, and the automatic thread counts of codecs follow the pool size
+ * instead of the number of CPUs. The pool is disabled by default.
+ *
+ * Slice threading with a main function, which may wait for its own jobs,
+ * keeps threads of its own, limited to the pool size.
+ *
+ * This function may be called at any time; every later execution of existing
+ * users of the pool uses the new number of workers, up to the thread count
+ * they were created with.
+ *
+ * @param nb_threads number of worker threads, 0 to disable the pool
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int av_thread_pool_set_size(int nb_threads);
+
+/**
+ * @return the number of worker threads set with av_thread_pool_set_size(),
+ *         0 if the pool is disabled
+ */
+int av_thread_pool_get_size(void);
+
 /**
  * Get the maximum data alignment that may be required by FFmpeg.
  *
@@ -27,9 +27,22 @@
 #include "time_internal.h"
 #include "bprint.h"
 
+/* dictionaries with at least this many entries are indexed by a hash table */
+#define INDEX_MIN_COUNT 8
+
+typedef struct DictIndex {
+    unsigned hash;
+    int next;       ///< next entry in the same bucket, -1 for none
+} DictIndex;
+
 struct AVDictionary {
     int count;
     AVDictionaryEntry *elems;
+    int nb_allocated;
+
+    DictIndex *index;   ///< nb_allocated elements, NULL if not indexed
+    int *buckets;       ///< first entry of each bucket, -1 for none
+    int nb_buckets;     ///< power of 2 not smaller than count
 };
 
 int av_dict_count(const AVDictionary *m)
@@ -37,10 +50,37 @@ int av_dict_count(const AVDictionary *m)
     return m ? m->count : 0;
 }
 
+static unsigned hash_key(const char *key)
+{
+    unsigned h = 2166136261U;
+
+    while (*key)
+        h = (h ^ av_toupper(*key++)) * 16777619U;
+    return h;
+}
+
+/* 1 if key matches s according to flags, 0 otherwise */
+static int match_key(const char *s, const char *key, int flags)
+{
+    int j;
+
+    if (flags & AV_DICT_MATCH_CASE)
+        for (j = 0; s[j] == key[j] && key[j]; j++)
+            ;
+    else
+        for (j = 0; av_toupper(s[j]) == av_toupper(key[j]) && key[j]; j++)
+            ;
+    if (key[j])
+        return 0;
+    if (s[j] && !(flags & AV_DICT_IGNORE_SUFFIX))
+        return 0;
+    return 1;
+}
+
 AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key,
                                const AVDictionaryEntry *prev, int flags)
 {
-    unsigned int i, j;
+    unsigned int i;
 
     if (!m)
         return NULL;
@@ -50,23 +90,137 @@ AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key,
     else
         i = 0;
 
-    for (; i < m->count; i++) {
-        const char *s = m->elems[i].key;
-        if (flags & AV_DICT_MATCH_CASE)
-            for (j = 0; s[j] == key[j] && key[j]; j++)
-                ;
-        else
-            for (j = 0; av_toupper(s[j]) == av_toupper(key[j]) && key[j]; j++)
-                ;
-        if (key[j])
-            continue;
-        if (s[j] && !(flags & AV_DICT_IGNORE_SUFFIX))
-            continue;
-        return &m->elems[i];
+    if (m->index && !(flags & AV_DICT_IGNORE_SUFFIX)) {
+        const unsigned h = hash_key(key);
+        int j, best = -1;
+
+        /* the entries of a bucket are not ordered, return the first match */
+        for (j = m->buckets[h & (m->nb_buckets - 1)]; j >= 0; j = m->index[j].next)
+            if (j >= i && (best < 0 || j < best) &&
+                m->index[j].hash == h && match_key(m->elems[j].key, key, flags))
+                best = j;
+        return best < 0 ? NULL : &m->elems[best];
     }
+
+    for (; i < m->count; i++)
+        if (match_key(m->elems[i].key, key, flags))
+            return &m->elems[i];
     return NULL;
 }
 
+static void index_link(AVDictionary *m, int i)
+{
+    int *b = &m->buckets[m->index[i].hash & (m->nb_buckets - 1)];
+
+    m->index[i].next = *b;
+    *b = i;
+}
+
+static void index_unlink(AVDictionary *m, int i)
+{
+    int *p = &m->buckets[m->index[i].hash & (m->nb_buckets - 1)];
+
+    while (*p != i)
+        p = &m->index[*p].next;
+    *p = m->index[i].next;
+}
+
+static void index_free(AVDictionary *m)
+{
+    av_freep(&m->index);
+    av_freep(&m->buckets);
+    m->nb_buckets = 0;
+}
+
+static int index_rebuild(AVDictionary *m, int nb_buckets)
+{
+    int i, *buckets = av_malloc_array(nb_buckets, sizeof(*buckets));
+
+    if (!buckets)
+        return AVERROR(ENOMEM);
+    av_free(m->buckets);
+    m->buckets    = buckets;
+    m->nb_buckets = nb_buckets;
+    for (i = 0; i < nb_buckets; i++)
+        buckets[i] = -1;
+    for (i = 0; i < m->count; i++)
+        index_link(m, i);
+    return 0;
+}
+
+static void index_create(AVDictionary *m)
+{
+    int i;
+
+    if (!(m->index = av_malloc_array(m->nb_allocated, sizeof(*m->index))))
+        return;
+    for (i = 0; i < m->count; i++)
+        m->index[i].hash = hash_key(m->elems[i].key);
+    if (index_rebuild(m, 2 * INDEX_MIN_COUNT) < 0)
+        index_free(m);
+}
+
+/* make room for one more entry; failing to keep the index up to date only
+ * makes lookups slower, so it is dropped instead */
+static int grow(AVDictionary *m)
+{
+    if (m->count == m->nb_allocated) {
+        int nb_allocated = FFMAX(4, 2 * m->nb_allocated);
+        void *tmp;
+
+        if (m->nb_allocated > INT_MAX / 4)
+            return AVERROR(ENOMEM);
+        tmp = av_realloc_array(m->elems, nb_allocated, sizeof(*m->elems));
+        if (!tmp)
+            return AVERROR(ENOMEM);
+        m->elems = tmp;
+        if (m->index) {
+            tmp = av_realloc_array(m->index, nb_allocated, sizeof(*m->index));
+            if (tmp)
+                m->index = tmp;
+            else
+                index_free(m);
+        }
+        m->nb_allocated = nb_allocated;
+    }
+    if (m->index && m->count >= m->nb_buckets &&
+        index_rebuild(m, 2 * m->nb_buckets) < 0)
+        index_free(m);
+    return 0;
+}
+
+static void append(AVDictionary *m, char *key, char *value)
+{
+    AVDictionaryEntry *e = &m->elems[m->count];
+
+    e->key   = key;
+    e->value = value;
+    if (m->index) {
+        m->index[m->count].hash = hash_key(key);
+        index_link(m, m->count);
+    }
+    m->count++;
+    if (!m->index && m->count >= INDEX_MIN_COUNT)
+        index_create(m);
+}
+
+/* remove an entry, moving the last one in its place */
+static void remove_entry(AVDictionary *m, AVDictionaryEntry *tag)
+{
+    const int i = tag - m->elems, last = m->count - 1;
+
+    if (m->index) {
+        index_unlink(m, i);
+        if (i != last) {
+            index_unlink(m, last);
+            m->index[i].hash = m->index[last].hash;
+            index_link(m, i);
+        }
+    }
+    *tag = m->elems[last];
+    m->count--;
+}
+
 int av_dict_set(AVDictionary **pm, const char *key, const char *value,
                 int flags)
 {
@@ -101,17 +255,12 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
         else
             av_free(tag->value);
         av_free(tag->key);
-        *tag = m->elems[--m->count];
+        remove_entry(m, tag);
     } else if (copy_value) {
-        AVDictionaryEntry *tmp = av_realloc(m->elems,
-                                            (m->count + 1) * sizeof(*m->elems));
-        if (!tmp)
+        if (grow(m) < 0)
             goto err_out;
-        m->elems = tmp;
     }
     if (copy_value) {
-        m->elems[m->count].key = copy_key;
-        m->elems[m->count].value = copy_value;
         if (oldval && flags & AV_DICT_APPEND) {
             size_t len = strlen(oldval) + strlen(copy_value) + 1;
             char *newval = av_mallocz(len);
@@ -120,25 +269,22 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
             av_strlcat(newval, oldval, len);
             av_freep(&oldval);
             av_strlcat(newval, copy_value, len);
-            m->elems[m->count].value = newval;
             av_freep(&copy_value);
+            copy_value = newval;
         }
-        m->count++;
+        append(m, copy_key, copy_value);
     } else {
         av_freep(&copy_key);
     }
-    if (!m->count) {
-        av_freep(&m->elems);
-        av_freep(pm);
-    }
+    if (!m->count)
+        av_dict_free(pm);
 
     return 0;
 
 err_out:
-    if (m && !m->count) {
-        av_freep(&m->elems);
-        av_freep(pm);
-    }
+    av_free(oldval);
+    if (m && !m->count)
+        av_dict_free(pm);
     av_free(copy_key);
     av_free(copy_value);
     return AVERROR(ENOMEM);
@@ -210,6 +356,7 @@ void av_dict_free(AVDictionary **pm)
             av_freep(&m->elems[m->count].value);
         }
         av_freep(&m->elems);
+        index_free(m);
     }
     av_freep(pm);
 }
@@ -173,6 +173,7 @@ struct AVExpr {
     } a;
     struct AVExpr *param[3];
     double *var;
+    struct ExprCode *code;  ///< bytecode of the whole expression, root only
 };
 
 static double etime(double v)
@@ -329,6 +330,447 @@ static double eval_expr(Parser *p, AVExpr *e)
     return NAN;
 }
 
+/**
+ * The tree is compiled into a flat list of instructions working on a file
+ * of registers, each node writing its result to a register of its own.
+ * Instructions compute the same operations in the same order as
+ * eval_expr(), so that results are bitwise identical; nodes whose evaluation
+ * order is not fixed by eval_expr() or which loop over their children with
+ * modified variables are run through eval_expr() by a single instruction.
+ * Constants and the used variables are loaded into the first registers
+ * before running the instructions.
+ */
+#define MAX_REGS 256
+
+enum {
+    OP_CONST, OP_SCALE, OP_MOV, OP_TREE,
+    OP_FUNC0, OP_FUNC1, OP_FUNC2,
+    OP_SQUISH, OP_GAUSS, OP_LD, OP_ISNAN, OP_ISINF,
+    OP_FLOOR, OP_CEIL, OP_TRUNC, OP_ROUND, OP_SQRT, OP_NOT,
+    OP_CLIP, OP_LERP,
+    OP_MOD, OP_GCD, OP_MAX, OP_MIN, OP_EQ, OP_GT, OP_GTE, OP_LT, OP_LTE,
+    OP_POW, OP_MUL, OP_DIV, OP_ADD, OP_ST, OP_HYPOT, OP_ATAN2,
+    OP_BITAND, OP_BITOR,
+    OP_JZ, OP_JNZ, OP_JMP,
+};
+
+typedef struct ExprInsn {
+    int op;
+    int dst, a, b, c;       ///< registers, c is the target of jumps
+    double value;
+    union {
+        double (*func0)(double);
+        double (*func1)(void *, double);
+        double (*func2)(void *, double, double);
+        AVExpr *tree;
+    } u;
+} ExprInsn;
+
+typedef struct ExprCode {
+    ExprInsn *insns;
+    int nb_insns;
+    int nb_consts;
+    double consts[MAX_REGS];    ///< initial values of the first registers
+    int nb_vars;                ///< variables loaded after the constants
+    int result;                 ///< register holding the result
+} ExprCode;
+
+typedef struct Compiler {
+    ExprInsn *code;
+    int nb_insns;
+    int nb_regs;
+    uint8_t kind[MAX_REGS];     ///< REG_*
+    double value[MAX_REGS];     ///< value of the constant registers
+    int var_reg[MAX_REGS];      ///< register + 1 of each variable, 0 if unused
+    int nb_vars;
+} Compiler;
+
+enum { REG_TEMP, REG_CONST, REG_VAR };
+
+static double eval_code(Parser *p, const ExprCode *c)
+{
+    double r[MAX_REGS];
+    const ExprInsn *code = c->insns;
+    int pc;
+
+    memcpy(r, c->consts, c->nb_consts * sizeof(*r));
+    if (c->nb_vars)
+        memcpy(r + c->nb_consts, p->const_values, c->nb_vars * sizeof(*r));
+    for (pc = 0; pc < c->nb_insns; pc++) {
+        const ExprInsn *in = &code[pc];
+        double *dst = &r[in->dst];
+
+#define d  r[in->a]
+#define d2 r[in->b]
+        switch (in->op) {
+        case OP_CONST:  *dst = in->value;                                     break;
+        case OP_SCALE:  *dst = in->value * d;                                 break;
+        case OP_MOV:    *dst = d;                                             break;
+        case OP_TREE:   *dst = eval_expr(p, in->u.tree);                      break;
+        case OP_FUNC0:  *dst = in->u.func0(d);                                break;
+        case OP_FUNC1:  *dst = in->u.func1(p->opaque, d);                     break;
+        case OP_FUNC2:  *dst = in->u.func2(p->opaque, d, d2);                 break;
+        case OP_SQUISH: *dst = 1/(1+exp(4*d));                                break;
+        case OP_GAUSS:  *dst = exp(-d*d/2)/sqrt(2*M_PI);                      break;
+        case OP_LD:     *dst = p->var[av_clip(d, 0, VARS-1)];                 break;
+        case OP_ISNAN:  *dst = !!isnan(d);                                    break;
+        case OP_ISINF:  *dst = !!isinf(d);                                    break;
+        case OP_FLOOR:  *dst = floor(d);                                      break;
+        case OP_CEIL:   *dst = ceil (d);                                      break;
+        case OP_TRUNC:  *dst = trunc(d);                                      break;
+        case OP_ROUND:  *dst = round(d);                                      break;
+        case OP_SQRT:   *dst = sqrt (d);                                      break;
+        case OP_NOT:    *dst = (d == 0);                                      break;
+        case OP_CLIP: {
+            double min = d2, max = r[in->c];
+            if (isnan(min) || isnan(max) || isnan(d) || min > max)
+                *dst = NAN;
+            else
+                *dst = in->value * av_clipd(d, min, max);
+            break;
+        }
+        case OP_LERP:   *dst = d + (d2 - d) * r[in->c];                       break;
+        case OP_MOD:    *dst = d - floor((!CONFIG_FTRAPV || d2) ? d / d2 : d * INFINITY) * d2; break;
+        case OP_GCD:    *dst = av_gcd(d,d2);                                  break;
+        case OP_MAX:    *dst = d >  d2 ?   d : d2;                            break;
+        case OP_MIN:    *dst = d <  d2 ?   d : d2;                            break;
+        case OP_EQ:     *dst = d == d2 ? 1.0 : 0.0;                           break;
+        case OP_GT:     *dst = d >  d2 ? 1.0 : 0.0;                           break;
+        case OP_GTE:    *dst = d >= d2 ? 1.0 : 0.0;                           break;
+        case OP_LT:     *dst = d <  d2 ? 1.0 : 0.0;                           break;
+        case OP_LTE:    *dst = d <= d2 ? 1.0 : 0.0;                           break;
+        case OP_POW:    *dst = pow(d, d2);                                    break;
+        case OP_MUL:    *dst = d * d2;                                        break;
+        case OP_DIV:    *dst = (!CONFIG_FTRAPV || d2 ) ? (d / d2) : d * INFINITY; break;
+        case OP_ADD:    *dst = d + d2;                                        break;
+        case OP_ST:     *dst = p->var[av_clip(d, 0, VARS-1)]= d2;             break;
+        case OP_HYPOT:  *dst = hypot(d, d2);                                  break;
+        case OP_ATAN2:  *dst = atan2(d, d2);                                  break;
+        case OP_BITAND: *dst = isnan(d) || isnan(d2) ? NAN : in->value * ((long int)d & (long int)d2); break;
+        case OP_BITOR:  *dst = isnan(d) || isnan(d2) ? NAN : in->value * ((long int)d | (long int)d2); break;
+        case OP_JZ:     if (d == 0) pc = in->c - 1;                           break;
+        case OP_JNZ:    if (d != 0) pc = in->c - 1;                           break;
+        case OP_JMP:    pc = in->c - 1;                                       break;
+        }
+#undef d
+#undef d2
+    }
+    return r[c->result];
+}
+
+/* 1 if evaluating e may change state seen by other nodes or by itself */
+static int has_side_effects(const AVExpr *e)
+{
+    int i;
+
+    if (!e)
+        return 0;
+    switch (e->type) {
+    case e_func1: case e_func2: case e_st: case e_random: case e_print:
+    case e_while: case e_taylor: case e_root:
+        return 1;
+    default:
+        break;
+    }
+    for (i = 0; i < 3; i++)
+        if (has_side_effects(e->param[i]))
+            return 1;
+    return 0;
+}
+
+/* 1 if e always evaluates to the same value */
+static int is_constant(const AVExpr *e)
+{
+    int i;
+
+    if (!e)
+        return 1;
+    switch (e->type) {
+    case e_value:
+        return 1;
+    case e_const: case e_ld: case e_func1: case e_func2: case e_st:
+    case e_random: case e_print: case e_while: case e_taylor: case e_root:
+        return 0;
+    case e_func0:
+        if (e->a.func0 == etime)
+            return 0;
+        break;
+    default:
+        break;
+    }
+    for (i = 0; i < 3; i++)
+        if (!is_constant(e->param[i]))
+            return 0;
+    return 1;
+}
+
+static ExprInsn *emit(Compiler *c, int op, int a, int b, int dst)
+{
+    ExprInsn *in;
+
+    if (c->nb_insns >= INT_MAX / 2 ||
+        av_reallocp_array(&c->code, c->nb_insns + 1, sizeof(*c->code)) < 0)
+        return NULL;
+    in = &c->code[c->nb_insns++];
+    memset(in, 0, sizeof(*in));
+    in->op    = op;
+    in->a     = a;
+    in->b     = b;
+    in->dst   = dst;
+    in->value = 1;
+    return in;
+}
+
+static int new_reg(Compiler *c)
+{
+    return c->nb_regs < MAX_REGS ? c->nb_regs++ : AVERROR(ENOSPC);
+}
+
+/* the register of a variable, allocated on first use */
+static int var_reg(Compiler *c, int index)
+{
+    if (index >= MAX_REGS)
+        return AVERROR(ENOSPC);
+    if (!c->var_reg[index]) {
+        int reg = new_reg(c);
+        if (reg < 0)
+            return reg;
+        c->kind[reg]        = REG_VAR;
+        c->var_reg[index]   = reg + 1;
+        c->nb_vars          = FFMAX(c->nb_vars, index + 1);
+    }
+    return c->var_reg[index] - 1;
+}
+
+/* emit value * register a into dst */
+static int emit_scale(Compiler *c, double value, int a, int dst)
+{
+    ExprInsn *in;
+
+    if (a < 0)
+        return a;
+    if (!(in = emit(c, value == 1 ? OP_MOV : OP_SCALE, a, 0, dst)))
+        return AVERROR(ENOMEM);
+    in->value = value;
+    return dst;
+}
+
+#define EMIT(op, a, b, dst) do {                \
+        if (!(in = emit(c, op, a, b, dst)))     \
+            return AVERROR(ENOMEM);             \
+    } while (0)
+
+#define COMPILE(reg, e) do {                    \
+        if ((reg = compile(c, e)) < 0)          \
+            return reg;                         \
+    } while (0)
+
+/* compile e, returns the register holding its value or a negative error */
+static int compile(Compiler *c, AVExpr *e)
+{
+    static const uint8_t unary[] = {
+        [e_func0] = OP_FUNC0, [e_func1] = OP_FUNC1, [e_squish] = OP_SQUISH,
+        [e_gauss] = OP_GAUSS, [e_ld] = OP_LD, [e_isnan] = OP_ISNAN,
+        [e_isinf] = OP_ISINF, [e_floor] = OP_FLOOR, [e_ceil] = OP_CEIL,
+        [e_trunc] = OP_TRUNC, [e_round] = OP_ROUND, [e_sqrt] = OP_SQRT,
+        [e_not] = OP_NOT,
+    };
+    static const uint8_t binary[] = {
+        [e_func2] = OP_FUNC2, [e_mod] = OP_MOD, [e_gcd] = OP_GCD,
+        [e_max] = OP_MAX, [e_min] = OP_MIN, [e_eq] = OP_EQ, [e_gt] = OP_GT,
+        [e_gte] = OP_GTE, [e_lt] = OP_LT, [e_lte] = OP_LTE, [e_pow] = OP_POW,
+        [e_mul] = OP_MUL, [e_div] = OP_DIV, [e_add] = OP_ADD, [e_st] = OP_ST,
+        [e_hypot] = OP_HYPOT, [e_atan2] = OP_ATAN2, [e_bitand] = OP_BITAND,
+        [e_bitor] = OP_BITOR,
+    };
+    ExprInsn *in;
+    int dst, r0, r1, r2, jump, jump_end;
+
+    if (e->type == e_const && e->value == 1)
+        return var_reg(c, e->a.const_index);
+
+    if ((dst = new_reg(c)) < 0)
+        return dst;
+
+    if (is_constant(e)) {
+        Parser p = { 0 };
+        c->kind[dst]  = REG_CONST;
+        c->value[dst] = eval_expr(&p, e);
+        return dst;
+    }
+
+    switch (e->type) {
+    case e_const:
+        return emit_scale(c, e->value, var_reg(c, e->a.const_index), dst);
+
+    case e_func0: case e_func1: case e_squish: case e_gauss: case e_ld:
+    case e_isnan: case e_isinf: case e_floor: case e_ceil: case e_trunc:
+    case e_round: case e_sqrt: case e_not:
+        COMPILE(r0, e->param[0]);
+        EMIT(unary[e->type], r0, 0, dst);
+        if (e->type == e_func0)
+            in->u.func0 = e->a.func0;
+        else if (e->type == e_func1)
+            in->u.func1 = e->a.func1;
+        if (e->type == e_squish || e->type == e_gauss || e->value == 1)
+            return dst;
+        return emit_scale(c, e->value, dst, dst);
+
+    case e_if:
+    case e_ifnot:
+        COMPILE(r0, e->param[0]);
+        EMIT(e->type == e_if ? OP_JZ : OP_JNZ, r0, 0, 0);
+        jump = c->nb_insns - 1;
+        COMPILE(r1, e->param[1]);
+        if (emit_scale(c, e->value, r1, dst) < 0)
+            return AVERROR(ENOMEM);
+        EMIT(OP_JMP, 0, 0, 0);
+        jump_end = c->nb_insns - 1;
+        c->code[jump].c = c->nb_insns;
+        if (e->param[2]) {
+            COMPILE(r2, e->param[2]);
+            if (emit_scale(c, e->value, r2, dst) < 0)
+                return AVERROR(ENOMEM);
+        } else {
+            EMIT(OP_CONST, 0, 0, dst);
+            in->value = e->value * 0;
+        }
+        c->code[jump_end].c = c->nb_insns;
+        return dst;
+
+    case e_between:
+        COMPILE(r0, e->param[0]);
+        COMPILE(r1, e->param[1]);
+        EMIT(OP_GTE, r0, r1, dst);
+        EMIT(OP_JZ, dst, 0, 0);
+        jump = c->nb_insns - 1;
+        COMPILE(r2, e->param[2]);
+        EMIT(OP_LTE, r0, r2, dst);
+        c->code[jump].c = c->nb_insns;
+        return e->value == 1 ? dst : emit_scale(c, e->value, dst, dst);
+
+    case e_while:
+        EMIT(OP_CONST, 0, 0, dst);
+        in->value = NAN;
+        jump_end = c->nb_insns;
+        COMPILE(r0, e->param[0]);
+        EMIT(OP_JZ, r0, 0, 0);
+        jump = c->nb_insns - 1;
+        COMPILE(r1, e->param[1]);
+        EMIT(OP_MOV, r1, 0, dst);
+        EMIT(OP_JMP, 0, 0, 0);
+        in->c = jump_end;
+        c->code[jump].c = c->nb_insns;
+        return dst;
+
+    case e_clip:
+    case e_lerp:
+        /* clip evaluates its first argument twice */
+        if (e->type == e_clip && has_side_effects(e->param[0]))
+            break;
+        COMPILE(r0, e->param[0]);
+        COMPILE(r1, e->param[1]);
+        COMPILE(r2, e->param[2]);
+        EMIT(e->type == e_clip ? OP_CLIP : OP_LERP, r0, r1, dst);
+        in->c     = r2;
+        in->value = e->value;
+        return dst;
+
+    case e_mod: case e_gcd: case e_max: case e_min: case e_eq: case e_gt:
+    case e_gte: case e_lt: case e_lte: case e_pow: case e_mul: case e_div:
+    case e_add: case e_st: case e_hypot: case e_atan2: case e_bitand:
+    case e_bitor: case e_func2:
+        /* the order of evaluation of function arguments is unspecified */
+        if (e->type == e_func2 &&
+            (has_side_effects(e->param[0]) || has_side_effects(e->param[1])))
+            break;
+        COMPILE(r0, e->param[0]);
+        COMPILE(r1, e->param[1]);
+        EMIT(binary[e->type], r0, r1, dst);
+        if (e->type == e_func2)
+            in->u.func2 = e->a.func2;
+        in->value = e->value;
+        if (e->type == e_bitand || e->type == e_bitor || e->value == 1)
+            return dst;
+        return emit_scale(c, e->value, dst, dst);
+
+    case e_last:
+        if (has_side_effects(e->param[0]))
+            COMPILE(r0, e->param[0]);
+        COMPILE(r1, e->param[1]);
+        return emit_scale(c, e->value, r1, dst);
+
+    default:
+        break;
+    }
+
+    EMIT(OP_TREE, 0, 0, dst);
+    in->u.tree = e;
+    return dst;
+}
+
+static int compile_expr(AVExpr *e)
+{
+    Compiler *c = av_mallocz(sizeof(*c));
+    ExprCode *code = av_mallocz(sizeof(*code));
+    int map[MAX_REGS];
+    int i, ret, root;
+
+    if (!c || !code) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = root = compile(c, e)) < 0)
+        goto end;
+    /* walking a tree of one or two nodes is as fast as running the code */
+    if (c->nb_insns < 2) {
+        ret = 0;
+        goto end;
+    }
+
+    /* move the constants to the first registers, followed by the
+     * variables in the order of their index */
+    for (i = 0; i < c->nb_regs; i++)
+        if (c->kind[i] == REG_CONST) {
+            code->consts[code->nb_consts] = c->value[i];
+            map[i] = code->nb_consts++;
+        }
+    for (i = 0; i < c->nb_vars; i++)
+        if (c->var_reg[i])
+            map[c->var_reg[i] - 1] = code->nb_consts + i;
+    ret = code->nb_consts + c->nb_vars;
+    for (i = 0; i < c->nb_regs; i++)
+        if (c->kind[i] == REG_TEMP)
+            map[i] = ret++;
+    if (ret > MAX_REGS) {
+        ret = AVERROR(ENOSPC);
+        goto end;
+    }
+    code->nb_vars = c->nb_vars;
+    for (i = 0; i < c->nb_insns; i++) {
+        ExprInsn *in = &c->code[i];
+        in->dst = map[in->dst];
+        in->a   = map[in->a];
+        in->b   = map[in->b];
+        if (in->op == OP_CLIP || in->op == OP_LERP)
+            in->c = map[in->c];
+    }
+
+    code->insns    = c->code;
+    code->nb_insns = c->nb_insns;
+    code->result   = map[root];
+    c->code        = NULL;
+    e->code        = code;
+    code           = NULL;
+    ret            = 0;
+end:
+    if (c)
+        av_free(c->code);
+    av_free(c);
+    av_free(code);
+    return ret;
+}
+
 static int parse_expr(AVExpr **e, Parser *p);
 
 void av_expr_free(AVExpr *e)
@@ -338,6 +780,9 @@ void av_expr_free(AVExpr *e)
     av_expr_free(e->param[1]);
     av_expr_free(e->param[2]);
     av_freep(&e->var);
+    if (e->code)
+        av_freep(&e->code->insns);
+    av_freep(&e->code);
     av_freep(&e);
 }
 
@@ -723,6 +1168,8 @@ int av_expr_parse(AVExpr **expr, const char *s,
         ret = AVERROR(ENOMEM);
         goto end;
     }
+    /* without bytecode, the expression is evaluated from the tree */
+    compile_expr(e);
     *expr = e;
     e = NULL;
 end:
@@ -738,7 +1185,7 @@ double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
 
     p.const_values = const_values;
     p.opaque     = opaque;
-    return eval_expr(&p, e);
+    return e->code ? eval_code(&p, e->code) : eval_expr(&p, e);
 }
 
 int av_expr_parse_and_eval(double *d, const char *s,
@@ -24,6 +24,7 @@
 #include "frame.h"
 #include "imgutils.h"
 #include "mem.h"
+#include "objcache_internal.h"
 #include "samplefmt.h"
 
 #if FF_API_FRAME_GET_SET
@@ -188,7 +189,7 @@ static void wipe_side_data(AVFrame *frame)
 
 AVFrame *av_frame_alloc(void)
 {
-    AVFrame *frame = av_mallocz(sizeof(*frame));
+    AVFrame *frame = avpriv_objcache_alloc(FF_OBJCACHE_FRAME, sizeof(*frame));
 
     if (!frame)
         return NULL;
@@ -205,7 +206,8 @@ void av_frame_free(AVFrame **frame)
         return;
 
     av_frame_unref(*frame);
-    av_freep(frame);
+    avpriv_objcache_free(FF_OBJCACHE_FRAME, *frame);
+    *frame = NULL;
 }
 
 static int get_video_buffer(AVFrame *frame, int align)
@@ -0,0 +1,181 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Per thread caches of the small structs allocated for every frame and
+ * packet, so that their allocation does not go through the heap allocator.
+ */
+
+#include "config.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "attributes.h"
+#include "common.h"
+#include "mem.h"
+#include "objcache.h"
+#include "objcache_internal.h"
+#include "thread.h"
+
+#define MAX_CAPACITY     256
+#define DEFAULT_CAPACITY  32
+/* number of cache lookups after which the per thread counters are merged */
+#define STATS_PERIOD    1024
+
+/* the thread specific data key must be deleted when the library is
+ * unloaded, which needs a library destructor */
+#if AV_GCC_VERSION_AT_LEAST(2,7)
+#define CACHE_ENABLED (HAVE_PTHREADS && !CONFIG_MEMORY_POISONING)
+#else
+#define CACHE_ENABLED 0
+#endif
+
+static atomic_int capacity = ATOMIC_VAR_INIT(CACHE_ENABLED ? DEFAULT_CAPACITY : 0);
+static atomic_uint_least64_t total_hits;
+static atomic_uint_least64_t total_misses;
+
+#if CACHE_ENABLED
+typedef struct ObjectCache {
+    void *objs[FF_OBJCACHE_NB][MAX_CAPACITY];
+    int nb_objs[FF_OBJCACHE_NB];
+    unsigned hits, misses;
+} ObjectCache;
+
+static pthread_key_t cache_key;
+static AVOnce cache_key_once = AV_ONCE_INIT;
+static atomic_int cache_key_ok;
+
+static void merge_stats(ObjectCache *c)
+{
+    atomic_fetch_add_explicit(&total_hits,   c->hits,   memory_order_relaxed);
+    atomic_fetch_add_explicit(&total_misses, c->misses, memory_order_relaxed);
+    c->hits = c->misses = 0;
+}
+
+/* called on thread exit */
+static void cache_free(void *opaque)
+{
+    ObjectCache *c = opaque;
+    int type, i;
+
+    for (type = 0; type < FF_OBJCACHE_NB; type++)
+        for (i = 0; i < c->nb_objs[type]; i++)
+            av_free(c->objs[type][i]);
+    merge_stats(c);
+    av_free(c);
+}
+
+static void cache_key_init(void)
+{
+    atomic_store(&cache_key_ok, !pthread_key_create(&cache_key, cache_free));
+}
+
+/**
+ * Delete the key when the library is unloaded, so that threads exiting
+ * afterwards do not call cache_free(), which would be unmapped after
+ * dlclose(). The caches of the threads still running are leaked then.
+ */
+static void __attribute__((destructor)) cache_key_uninit(void)
+{
+    if (atomic_exchange(&cache_key_ok, 0))
+        pthread_key_delete(cache_key);
+}
+
+static ObjectCache *get_cache(void)
+{
+    ObjectCache *c;
+
+    if (ff_thread_once(&cache_key_once, cache_key_init) ||
+        !atomic_load_explicit(&cache_key_ok, memory_order_relaxed))
+        return NULL;
+
+    c = pthread_getspecific(cache_key);
+    if (!c) {
+        c = av_mallocz(sizeof(*c));
+        if (c && pthread_setspecific(cache_key, c))
+            av_freep(&c);
+    }
+    return c;
+}
+#endif /* CACHE_ENABLED */
+
+void *avpriv_objcache_alloc(enum FFObjectCacheType type, size_t size)
+{
+#if CACHE_ENABLED
+    ObjectCache *c = atomic_load_explicit(&capacity, memory_order_relaxed) ?
+                     get_cache() : NULL;
+
+    if (c) {
+        void *obj = NULL;
+
+        if (c->nb_objs[type]) {
+            obj = c->objs[type][--c->nb_objs[type]];
+            memset(obj, 0, size);
+            c->hits++;
+        } else {
+            c->misses++;
+        }
+        if (c->hits + c->misses >= STATS_PERIOD)
+            merge_stats(c);
+        if (obj)
+            return obj;
+    }
+#endif
+    return av_mallocz(size);
+}
+
+void avpriv_objcache_free(enum FFObjectCacheType type, void *obj)
+{
+#if CACHE_ENABLED
+    int cap = atomic_load_explicit(&capacity, memory_order_relaxed);
+    ObjectCache *c;
+
+    if (obj && cap && (c = get_cache()) && c->nb_objs[type] < cap) {
+        c->objs[type][c->nb_objs[type]++] = obj;
+        return;
+    }
+#endif
+    av_free(obj);
+}
+
+int av_object_cache_set_capacity(int cap)
+{
+    if (!CACHE_ENABLED)
+        return 0;
+    return atomic_exchange_explicit(&capacity, av_clip(cap, 0, MAX_CAPACITY),
+                                    memory_order_relaxed);
+}
+
+void av_object_cache_get_stats(uint64_t *hits, uint64_t *misses)
+{
+#if CACHE_ENABLED
+    if (!ff_thread_once(&cache_key_once, cache_key_init) &&
+        atomic_load_explicit(&cache_key_ok, memory_order_relaxed)) {
+        ObjectCache *c = pthread_getspecific(cache_key);
+        if (c)
+            merge_stats(c);
+    }
+#endif
+    if (hits)
+        *hits   = atomic_load_explicit(&total_hits,   memory_order_relaxed);
+    if (misses)
+        *misses = atomic_load_explicit(&total_misses, memory_order_relaxed);
+}
@@ -0,0 +1,75 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * @ingroup lavu_mem
+ * Per thread object caches
+ */
+
+#ifndef AVUTIL_OBJCACHE_H
+#define AVUTIL_OBJCACHE_H
+
+#include <stdint.h>
+
+/**
+ * @addtogroup lavu_mem
+ * @{
+ */
+
+/**
+ * Set the number of structs of each kind kept in the per thread object
+ * caches.
+ *
+ * The AVFrame, AVPacket, AVBufferRef and AVBuffer structs freed by a thread
+ * are kept in a cache of that thread and reused by its next allocations of
+ * the same kind, instead of going through the heap allocator. The caches
+ * are only available with POSIX threads and are disabled when memory
+ * poisoning is enabled. The default capacity is 32 structs of each kind.
+ * The caches of threads still running when libavutil is unloaded are not
+ * freed.
+ *
+ * This function is thread-safe. Structs already cached above a lowered
+ * capacity are still reused, but no more are added.
+ *
+ * @param capacity the maximum number of cached structs of each kind per
+ *                 thread, 0 disables the caches
+ * @return the previous capacity
+ */
+int av_object_cache_set_capacity(int capacity);
+
+/**
+ * Get the object cache statistics accumulated since the start of the process.
+ *
+ * The counters of other threads are merged periodically and when they exit,
+ * so the values may lag behind slightly.
+ *
+ * This function is thread-safe.
+ *
+ * @param hits   if not NULL, set to the number of allocations served from
+ *               a cache
+ * @param misses if not NULL, set to the number of allocations that went to
+ *               the heap allocator
+ */
+void av_object_cache_get_stats(uint64_t *hits, uint64_t *misses);
+
+/**
+ * @}
+ */
+
+#endif /* AVUTIL_OBJCACHE_H */
@@ -0,0 +1,50 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_OBJCACHE_INTERNAL_H
+#define AVUTIL_OBJCACHE_INTERNAL_H
+
+#include <stddef.h>
+
+/**
+ * Kinds of structs kept in the per thread object caches, all structs of a
+ * kind must have the same size.
+ */
+enum FFObjectCacheType {
+    FF_OBJCACHE_BUFFER,
+    FF_OBJCACHE_BUFFERREF,
+    FF_OBJCACHE_FRAME,
+    FF_OBJCACHE_PACKET,
+    FF_OBJCACHE_NB
+};
+
+/**
+ * Allocate a zeroed struct, reusing one from the cache of the calling
+ * thread if possible.
+ *
+ * @return the struct, or NULL on allocation failure
+ */
+void *avpriv_objcache_alloc(enum FFObjectCacheType type, size_t size);
+
+/**
+ * Free a struct allocated with avpriv_objcache_alloc() or av_malloc(),
+ * keeping it in the cache of the calling thread if it is not full.
+ */
+void avpriv_objcache_free(enum FFObjectCacheType type, void *obj);
+
+#endif /* AVUTIL_OBJCACHE_INTERNAL_H */
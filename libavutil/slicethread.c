@@ -18,12 +18,15 @@
 
 #include <stdatomic.h>
 #include "slicethread.h"
+#include "cpu.h"
 #include "mem.h"
 #include "thread.h"
 #include "avassert.h"
 
 #if HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS2THREADS
 
+#define MAX_POOL_THREADS 1024
+
 typedef struct WorkerContext {
     AVSliceThread   *ctx;
     pthread_mutex_t mutex;
@@ -48,8 +51,50 @@ struct AVSliceThread {
     void            *priv;
     void            (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads);
     void            (*main_func)(void *priv);
+
+    /* the fields below are used with the shared pool and protected by its mutex */
+    int             shared;
+    int             queued;         ///< 1 if in the queue of clients waiting for workers
+    AVSliceThread   *next;          ///< next client in the queue
+    int             nb_joined;      ///< participants of the current execute so far
+    int             nb_running;     ///< pool workers running jobs of the current execute
+
+    /* jobs not started yet of each participant, first job in the low and
+     * end in the high 32 bits, taken from the front by their owner and
+     * stolen from the back by the others */
+    atomic_uint_least64_t *ranges;
 };
 
+typedef struct PoolWorker {
+    pthread_t       thread;
+    int             quit;
+} PoolWorker;
+
+/*
+ * Process wide pool of worker threads shared by all slice thread contexts
+ * without main function created while it is enabled. A client queues itself
+ * on execute, idle workers join the queued client with the fewest workers.
+ * The jobs are split into one range per participant; a participant whose
+ * range is empty steals half of the largest remaining one.
+ */
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    PoolWorker      *workers[MAX_POOL_THREADS];
+    int             nb_workers;
+    int             size;           ///< requested number of workers, 0 if disabled
+    int             nb_clients;
+    AVSliceThread   *queue;
+} pool;
+
+static AVOnce pool_once = AV_ONCE_INIT;
+
+static void pool_init(void)
+{
+    pthread_mutex_init(&pool.mutex, NULL);
+    pthread_cond_init(&pool.cond, NULL);
+}
+
 static int run_jobs(AVSliceThread *ctx)
 {
     unsigned nb_jobs    = ctx->nb_jobs;
@@ -91,15 +136,322 @@ static void *attribute_align_arg thread_worker(void *v)
     }
 }
 
+static void pool_dequeue(AVSliceThread *ctx)
+{
+    AVSliceThread **p = &pool.queue;
+
+    while (*p != ctx)
+        p = &(*p)->next;
+    *p = ctx->next;
+    ctx->next   = NULL;
+    ctx->queued = 0;
+}
+
+static void pool_enqueue(AVSliceThread *ctx)
+{
+    AVSliceThread **p = &pool.queue;
+
+    while (*p)
+        p = &(*p)->next;
+    *p = ctx;
+    ctx->queued = 1;
+}
+
+/* the queued client with the fewest workers, the oldest one on ties */
+static AVSliceThread *pool_pick(void)
+{
+    AVSliceThread *ctx, *best = NULL;
+
+    for (ctx = pool.queue; ctx; ctx = ctx->next)
+        if (!best || ctx->nb_running < best->nb_running)
+            best = ctx;
+    return best;
+}
+
+/* take a participant slot of a queued client, dequeueing it once all are
+ * taken; requeue moves it to the back of the queue otherwise */
+static int pool_claim_slot(AVSliceThread *ctx, int requeue)
+{
+    int threadnr = ctx->nb_joined++;
+
+    if (requeue || ctx->nb_joined == ctx->nb_active_threads) {
+        pool_dequeue(ctx);
+        if (ctx->nb_joined < ctx->nb_active_threads)
+            pool_enqueue(ctx);
+    }
+    return threadnr;
+}
+
+#define RANGE(begin, end) ((uint64_t)(end) << 32 | (begin))
+#define RANGE_BEGIN(r)    ((unsigned)((r) & 0xFFFFFFFF))
+#define RANGE_END(r)      ((unsigned)((r) >> 32))
+
+/* take the first job of the own range, -1 if it is empty */
+static int take_job(AVSliceThread *ctx, int threadnr)
+{
+    atomic_uint_least64_t *range = &ctx->ranges[threadnr];
+    uint_least64_t r = atomic_load_explicit(range, memory_order_relaxed);
+
+    while (RANGE_BEGIN(r) < RANGE_END(r))
+        if (atomic_compare_exchange_weak_explicit(range, &r,
+                                                  RANGE(RANGE_BEGIN(r) + 1, RANGE_END(r)),
+                                                  memory_order_relaxed, memory_order_relaxed))
+            return RANGE_BEGIN(r);
+    return -1;
+}
+
+/* move the second half of the largest range of the other participants to
+ * the own one, which is empty, and take its first job; -1 if no job is left */
+static int steal_job(AVSliceThread *ctx, int threadnr)
+{
+    while (1) {
+        uint_least64_t r, best_r = 0;
+        unsigned left, best_left = 0, mid;
+        int i, victim = -1;
+
+        for (i = 0; i < ctx->nb_active_threads; i++) {
+            if (i == threadnr)
+                continue;
+            r    = atomic_load_explicit(&ctx->ranges[i], memory_order_relaxed);
+            left = RANGE_END(r) - RANGE_BEGIN(r);
+            if (RANGE_BEGIN(r) < RANGE_END(r) && left > best_left) {
+                best_left = left;
+                best_r    = r;
+                victim    = i;
+            }
+        }
+        if (victim < 0)
+            return -1;
+
+        mid = RANGE_END(best_r) - (best_left + 1) / 2;
+        if (atomic_compare_exchange_strong_explicit(&ctx->ranges[victim], &best_r,
+                                                    RANGE(RANGE_BEGIN(best_r), mid),
+                                                    memory_order_relaxed, memory_order_relaxed)) {
+            atomic_store_explicit(&ctx->ranges[threadnr],
+                                  RANGE(mid + 1, RANGE_END(best_r)), memory_order_relaxed);
+            return mid;
+        }
+    }
+}
+
+static void run_shared_jobs(AVSliceThread *ctx, int threadnr)
+{
+    int job;
+
+    while ((job = take_job(ctx, threadnr)) >= 0 ||
+           (job = steal_job(ctx, threadnr)) >= 0)
+        ctx->worker_func(ctx->priv, job, threadnr, ctx->nb_jobs, ctx->nb_active_threads);
+}
+
+static void *attribute_align_arg pool_worker(void *v)
+{
+    PoolWorker *w = v;
+
+    pthread_mutex_lock(&pool.mutex);
+    while (!w->quit) {
+        AVSliceThread *ctx = pool_pick();
+        int threadnr;
+
+        if (!ctx) {
+            pthread_cond_wait(&pool.cond, &pool.mutex);
+            continue;
+        }
+
+        /* move to the back so that ties go round robin */
+        threadnr = pool_claim_slot(ctx, 1);
+        ctx->nb_running++;
+        pthread_mutex_unlock(&pool.mutex);
+
+        run_shared_jobs(ctx, threadnr);
+
+        pthread_mutex_lock(&pool.mutex);
+        if (!--ctx->nb_running)
+            pthread_cond_signal(&ctx->done_cond);
+    }
+    pthread_mutex_unlock(&pool.mutex);
+
+    return NULL;
+}
+
+/* start or stop workers to match the pool size, keeping at least one while
+ * clients are attached; returns the workers to be joined after unlocking */
+static int pool_update(PoolWorker **quit)
+{
+    const int target = FFMAX(pool.size, !!pool.nb_clients);
+    int nb_quit = 0;
+
+    while (pool.nb_workers < target) {
+        PoolWorker *w = av_mallocz(sizeof(*w));
+        if (!w || pthread_create(&w->thread, NULL, pool_worker, w)) {
+            av_free(w);
+            break;
+        }
+        pool.workers[pool.nb_workers++] = w;
+    }
+    while (pool.nb_workers > target) {
+        PoolWorker *w = pool.workers[--pool.nb_workers];
+        w->quit = 1;
+        quit[nb_quit++] = w;
+    }
+    if (nb_quit)
+        pthread_cond_broadcast(&pool.cond);
+
+    return nb_quit;
+}
+
+static void pool_join(PoolWorker **quit, int nb_quit)
+{
+    int i;
+
+    for (i = 0; i < nb_quit; i++) {
+        pthread_join(quit[i]->thread, NULL);
+        av_free(quit[i]);
+    }
+}
+
+int av_thread_pool_set_size(int nb_threads)
+{
+    PoolWorker *quit[MAX_POOL_THREADS];
+    int nb_quit;
+
+    if (nb_threads < 0)
+        return AVERROR(EINVAL);
+    if (ff_thread_once(&pool_once, pool_init))
+        return AVERROR_UNKNOWN;
+
+    pthread_mutex_lock(&pool.mutex);
+    pool.size = FFMIN(nb_threads, MAX_POOL_THREADS);
+    nb_quit = pool_update(quit);
+    nb_threads = pool.nb_workers;
+    pthread_mutex_unlock(&pool.mutex);
+
+    pool_join(quit, nb_quit);
+
+    return pool.size && nb_threads < pool.size ? AVERROR(EAGAIN) : 0;
+}
+
+int av_thread_pool_get_size(void)
+{
+    int size;
+
+    if (ff_thread_once(&pool_once, pool_init))
+        return 0;
+
+    pthread_mutex_lock(&pool.mutex);
+    size = pool.size;
+    pthread_mutex_unlock(&pool.mutex);
+
+    return size;
+}
+
+static void pool_detach(AVSliceThread *ctx)
+{
+    PoolWorker *quit[1];
+    int nb_quit;
+
+    pthread_mutex_lock(&pool.mutex);
+    pool.nb_clients--;
+    nb_quit = pool_update(quit);
+    pthread_mutex_unlock(&pool.mutex);
+
+    pool_join(quit, nb_quit);
+    if (ctx->shared)
+        pthread_cond_destroy(&ctx->done_cond);
+    av_freep(&ctx->ranges);
+}
+
+/* attach to the shared pool if enabled, returns the number of threads or 0;
+ * an execution uses as many threads as the pool has workers at that time,
+ * plus the caller, up to the returned number */
+static int pool_attach(AVSliceThread *ctx, int nb_threads)
+{
+    PoolWorker *quit[1];
+    int max_threads;
+
+    if (ff_thread_once(&pool_once, pool_init))
+        return 0;
+
+    pthread_mutex_lock(&pool.mutex);
+    if (!pool.size) {
+        pthread_mutex_unlock(&pool.mutex);
+        return 0;
+    }
+    pool.nb_clients++;
+    pool_update(quit);
+    if (!pool.nb_workers) {
+        pool.nb_clients--;
+        pthread_mutex_unlock(&pool.mutex);
+        return 0;
+    }
+    /* leave room for the pool to grow up to the number of CPUs */
+    max_threads = nb_threads ? nb_threads : FFMAX(pool.size, av_cpu_count()) + 1;
+    pthread_mutex_unlock(&pool.mutex);
+
+    if (!(ctx->ranges = av_malloc_array(max_threads, sizeof(*ctx->ranges)))) {
+        pool_detach(ctx);
+        return 0;
+    }
+    ctx->shared = 1;
+    pthread_cond_init(&ctx->done_cond, NULL);
+
+    return max_threads;
+}
+
+static void pool_execute(AVSliceThread *ctx, int nb_jobs)
+{
+    int i;
+
+    pthread_mutex_lock(&pool.mutex);
+    ctx->nb_jobs           = nb_jobs;
+    ctx->nb_active_threads = FFMIN3(nb_jobs, ctx->nb_threads, pool.nb_workers + 1);
+    for (i = 0; i < ctx->nb_active_threads; i++)
+        atomic_store_explicit(&ctx->ranges[i],
+                              RANGE((int64_t)nb_jobs *  i      / ctx->nb_active_threads,
+                                    (int64_t)nb_jobs * (i + 1) / ctx->nb_active_threads),
+                              memory_order_relaxed);
+    /* the caller is participant 0 */
+    ctx->nb_joined = 1;
+    if (ctx->nb_joined < ctx->nb_active_threads) {
+        pool_enqueue(ctx);
+        pthread_cond_broadcast(&pool.cond);
+    }
+    pthread_mutex_unlock(&pool.mutex);
+
+    run_shared_jobs(ctx, 0);
+
+    pthread_mutex_lock(&pool.mutex);
+    if (ctx->queued)
+        pool_dequeue(ctx);
+    while (ctx->nb_running)
+        pthread_cond_wait(&ctx->done_cond, &pool.mutex);
+    pthread_mutex_unlock(&pool.mutex);
+}
+
 int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
                               void (*main_func)(void *priv),
                               int nb_threads)
 {
     AVSliceThread *ctx;
-    int nb_workers, i;
+    int nb_workers, i, ret;
 
     av_assert0(nb_threads >= 0);
+
+    *pctx = ctx = av_mallocz(sizeof(*ctx));
+    if (!ctx)
+        return AVERROR(ENOMEM);
+
+    ctx->priv        = priv;
+    ctx->worker_func = worker_func;
+    ctx->main_func   = main_func;
+
+    /* the main function may wait for the jobs, which therefore get workers
+     * of their own, as many as the pool has at most */
+    if (!main_func && (ret = pool_attach(ctx, nb_threads))) {
+        ctx->nb_threads = ret;
+        return ret;
+    }
+
     if (!nb_threads) {
         int nb_cpus = av_cpu_count();
         if (nb_cpus > 1)
@@ -107,23 +459,18 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
         else
             nb_threads = 1;
     }
+    if (main_func && (ret = av_thread_pool_get_size()))
+        nb_threads = FFMIN(nb_threads, ret);
 
     nb_workers = nb_threads;
     if (!main_func)
         nb_workers--;
 
-    *pctx = ctx = av_mallocz(sizeof(*ctx));
-    if (!ctx)
-        return AVERROR(ENOMEM);
-
     if (nb_workers && !(ctx->workers = av_calloc(nb_workers, sizeof(*ctx->workers)))) {
         av_freep(pctx);
         return AVERROR(ENOMEM);
     }
 
-    ctx->priv        = priv;
-    ctx->worker_func = worker_func;
-    ctx->main_func   = main_func;
     ctx->nb_threads  = nb_threads;
     ctx->nb_active_threads = 0;
     ctx->nb_jobs     = 0;
@@ -166,6 +513,12 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
     int nb_workers, i, is_last = 0;
 
     av_assert0(nb_jobs > 0);
+
+    if (ctx->shared) {
+        pool_execute(ctx, nb_jobs);
+        return;
+    }
+
     ctx->nb_jobs           = nb_jobs;
     ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
     atomic_store_explicit(&ctx->first_job, 0, memory_order_relaxed);
@@ -205,6 +558,12 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
         return;
 
     ctx = *pctx;
+    if (ctx->shared) {
+        pool_detach(ctx);
+        av_freep(pctx);
+        return;
+    }
+
     nb_workers = ctx->nb_threads;
     if (!ctx->main_func)
         nb_workers--;
@@ -252,4 +611,14 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
     av_assert0(!pctx || !*pctx);
 }
 
+int av_thread_pool_set_size(int nb_threads)
+{
+    return nb_threads ? AVERROR(ENOSYS) : 0;
+}
+
+int av_thread_pool_get_size(void)
+{
+    return 0;
+}
+
 #endif /* HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS32THREADS */
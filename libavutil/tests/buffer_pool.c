@@ -0,0 +1,133 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program hammers one buffer pool from several threads and checks
+ * that no buffer is handed out twice at the same time. With "bench" it
+ * reports the cost of a get/unref pair under contention instead.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/common.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define MAX_THREADS 64
+#define BUF_SIZE    64
+#define HELD        4   /* buffers held at once by every thread */
+
+typedef struct ThreadArg {
+    AVBufferPool *pool;
+    int id;
+    int iterations;
+    int check;
+    int errors;
+} ThreadArg;
+
+static void *thread_main(void *opaque)
+{
+    ThreadArg *arg = opaque;
+    AVBufferRef *bufs[HELD] = { NULL };
+    int i, j;
+
+    for (i = 0; i < arg->iterations; i++) {
+        for (j = 0; j < HELD; j++) {
+            bufs[j] = av_buffer_pool_get(arg->pool);
+            if (!bufs[j]) {
+                arg->errors++;
+                continue;
+            }
+            if (arg->check)
+                memset(bufs[j]->data, arg->id * HELD + j, BUF_SIZE);
+        }
+        for (j = 0; j < HELD; j++) {
+            if (!bufs[j])
+                continue;
+            if (arg->check) {
+                int k;
+                for (k = 0; k < BUF_SIZE; k++)
+                    if (bufs[j]->data[k] != (uint8_t)(arg->id * HELD + j)) {
+                        arg->errors++;
+                        break;
+                    }
+            }
+            av_buffer_unref(&bufs[j]);
+        }
+    }
+    return NULL;
+}
+
+static int run(int nb_threads, int iterations, int check, int64_t *time)
+{
+    AVBufferPool *pool = av_buffer_pool_init(BUF_SIZE, NULL);
+    pthread_t threads[MAX_THREADS];
+    ThreadArg args[MAX_THREADS];
+    int i, ret, errors = 0;
+    int64_t t;
+
+    if (!pool)
+        return -1;
+
+    t = av_gettime_relative();
+    for (i = 0; i < nb_threads; i++) {
+        args[i] = (ThreadArg){ pool, i, iterations, check, 0 };
+        if ((ret = pthread_create(&threads[i], NULL, thread_main, &args[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            nb_threads = i;
+            errors++;
+            break;
+        }
+    }
+    for (i = 0; i < nb_threads; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].errors;
+    }
+    *time = av_gettime_relative() - t;
+
+    av_buffer_pool_uninit(&pool);
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    int64_t time;
+    int errors;
+
+    if (argc > 1 && !strcmp(argv[1], "bench")) {
+        const int iterations = 200000;
+        int nb_threads;
+
+        for (nb_threads = 1; nb_threads <= (argc > 2 ? av_clip(atoi(argv[2]), 1, MAX_THREADS) : 8);
+             nb_threads *= 2) {
+            if (run(nb_threads, iterations, 0, &time))
+                return 1;
+            printf("%2d threads: %6.1f ns per get/unref\n", nb_threads,
+                   time * 1000.0 / ((int64_t)iterations * HELD * nb_threads));
+        }
+        return 0;
+    }
+
+    errors = run(8, 20000, 1, &time);
+    if (errors)
+        fprintf(stderr, "%d errors\n", errors);
+    return !!errors;
+}
@@ -51,9 +51,10 @@ static void test_separators(const AVDictionary *m, const char pair, const char v
 
 int main(void)
 {
-    AVDictionary *dict = NULL;
+    AVDictionary *dict = NULL, *copy = NULL;
     AVDictionaryEntry *e;
     char *buffer = NULL;
+    int i;
 
     printf("Testing av_dict_get_string() and av_dict_parse_string()\n");
     av_dict_get_string(dict, &buffer, '=', ',');
@@ -132,5 +133,36 @@ int main(void)
     printf("%s\n", e->value);
     av_dict_free(&dict);
 
+    printf("\nTesting indexed dictionaries\n");
+    for (i = 0; i < 24; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "Key%d", i);
+        av_dict_set_int(&dict, key, i, 0);
+    }
+    av_dict_set(&dict, "key3", "three", 0);
+    av_dict_set(&dict, "KEY5", NULL, 0);
+    av_dict_set(&dict, "key7", "!", AV_DICT_APPEND);
+    av_dict_set(&dict, "key7", "?", AV_DICT_DONT_OVERWRITE);
+    av_dict_set(&dict, "KEY9", "upper", AV_DICT_MATCH_CASE);
+    av_dict_set(&dict, "dup", "1", AV_DICT_MULTIKEY);
+    av_dict_set(&dict, "dup", "2", AV_DICT_MULTIKEY);
+    print_dict(dict);
+    printf("%s %s\n", av_dict_get(dict, "KEY9", NULL, 0)->value,
+           av_dict_get(dict, "KEY9", NULL, AV_DICT_MATCH_CASE)->value);
+    e = NULL;
+    while ((e = av_dict_get(dict, "DUP", e, 0)))
+        printf("%s %s\n", e->key, e->value);
+
+    printf("\nTesting av_dict_copy() of an indexed dictionary\n");
+    av_dict_copy(&copy, dict, 0);
+    av_dict_set(&copy, "key3", NULL, 0);
+    av_dict_set(&copy, "new", "entry", 0);
+    print_dict(copy);
+    print_dict(dict);
+    av_dict_free(&dict);
+    printf("%s %s\n", av_dict_get(copy, "key10", NULL, 0)->value,
+           av_dict_get(copy, "new", NULL, 0)->value);
+    av_dict_free(&copy);
+
     return 0;
 }
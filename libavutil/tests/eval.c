@@ -138,8 +138,24 @@ int main(int argc, char **argv)
         "clip(0, 2, 1)",
         "clip(0/0, 1, 2)",
         "clip(0, 0/0, 1)",
+        "2*3+4*5-6/3",
+        "-(2-5)*PI+E",
+        "(PI+E)*(PI-E)/(PI*E)",
+        "sin(PI/6)*2+cos(0)-exp(0)",
+        "1+1+1+1+1+1+1+1+1+1+1+1+1+1+1+1",
+        "st(0, 3)*ld(0)+ld(0)",
+        "ld(0)+st(0, 7)+ld(0)",
+        "st(1, 2); st(2, ld(1)*ld(1)); ld(2)*10+ld(1)",
+        "st(0, 0); while(lt(ld(0), 10), st(0, ld(0)+1)); ld(0)*2+1",
+        "st(0, 10); st(1, 0); while(ld(0), st(1, ld(1)+ld(0)*ld(0)); st(0, ld(0)-1)); ld(1)",
+        "clip(st(0, 5), ld(0)-1, ld(0)+1)",
+        "max(st(0, 1), ld(0)+1)+min(ld(0), 3)",
+        "if(st(0, 4), ld(0)*ld(0), -1)+ifnot(0, ld(0))",
         NULL
     };
+    static const char *const var_names[] = { "X", "Y", NULL };
+    double var_values[2];
+    AVExpr *e;
     int ret;
 
     for (expr = exprs; *expr; expr++) {
@@ -168,6 +184,21 @@ int main(int argc, char **argv)
     if (ret < 0)
         printf("av_expr_parse_and_eval failed\n");
 
+    /* the stored values are kept from one evaluation to the next */
+    printf("\nEvaluating 'st(0, ld(0)+X); ld(0)*Y+X*X' repeatedly\n");
+    ret = av_expr_parse(&e, "st(0, ld(0)+X); ld(0)*Y+X*X", var_names,
+                        NULL, NULL, NULL, NULL, 0, NULL);
+    if (ret < 0) {
+        printf("av_expr_parse failed\n");
+    } else {
+        for (i = 1; i <= 5; i++) {
+            var_values[0] = i;
+            var_values[1] = 0.5;
+            printf("X=%d -> %f\n", i, av_expr_eval(e, var_values, NULL));
+        }
+        av_expr_free(e);
+    }
+
     if (argc > 1 && !strcmp(argv[1], "-t")) {
         for (i = 0; i < 1050; i++) {
             START_TIMER;
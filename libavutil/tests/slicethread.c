@@ -0,0 +1,190 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program runs several slice thread contexts from different
+ * threads, with private threads and on the shared pool while it is resized,
+ * and checks that every job runs exactly once with a valid thread number,
+ * that a main function can wait for the jobs and that executions follow the
+ * current pool size.
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/cpu.h"
+#include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define NB_CLIENTS    4
+#define MAX_JOBS     64
+#define ITERATIONS  500
+
+typedef struct Client {
+    AVSliceThread *slicethread;
+    int id;
+    int nb_threads;
+    int use_main;
+    int nb_jobs;
+    atomic_int runs[MAX_JOBS];
+    atomic_int done_jobs;
+    atomic_int main_runs;
+    atomic_int last_nb_threads;
+    int errors;
+} Client;
+
+static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    Client *c = priv;
+
+    if (jobnr >= nb_jobs || threadnr < 0 || threadnr >= nb_threads ||
+        nb_threads > c->nb_threads)
+        c->errors++;
+    atomic_fetch_add(&c->runs[jobnr], 1);
+    atomic_store(&c->last_nb_threads, nb_threads);
+    atomic_fetch_add(&c->done_jobs, 1);
+}
+
+/* like a decoder waiting for the progress of its rows */
+static void main_func(void *priv)
+{
+    Client *c = priv;
+
+    while (atomic_load(&c->done_jobs) < c->nb_jobs)
+        av_usleep(10);
+    atomic_fetch_add(&c->main_runs, 1);
+}
+
+static void *client_main(void *opaque)
+{
+    Client *c = opaque;
+    int i, j;
+
+    for (i = 0; i < ITERATIONS; i++) {
+        const int nb_jobs = 1 + (i * 7 + c->id) % MAX_JOBS;
+        const int execute_main = c->use_main && (i & 1);
+
+        for (j = 0; j < MAX_JOBS; j++)
+            atomic_store(&c->runs[j], 0);
+        atomic_store(&c->done_jobs, 0);
+        atomic_store(&c->main_runs, 0);
+        c->nb_jobs = nb_jobs;
+
+        avpriv_slicethread_execute(c->slicethread, nb_jobs, execute_main);
+
+        for (j = 0; j < MAX_JOBS; j++)
+            if (atomic_load(&c->runs[j]) != (j < nb_jobs))
+                c->errors++;
+        if (atomic_load(&c->main_runs) != execute_main)
+            c->errors++;
+    }
+    return NULL;
+}
+
+static int run(int pool_size)
+{
+    pthread_t threads[NB_CLIENTS];
+    Client clients[NB_CLIENTS];
+    int i, ret, errors = 0;
+
+    if (av_thread_pool_set_size(pool_size) < 0)
+        return 1;
+
+    memset(clients, 0, sizeof(clients));
+    for (i = 0; i < NB_CLIENTS; i++) {
+        Client *c = &clients[i];
+        c->id       = i;
+        c->use_main = i & 1;
+        ret = avpriv_slicethread_create(&c->slicethread, c, worker_func,
+                                        c->use_main ? main_func : NULL, i + 1);
+        if (ret < 0) {
+            fprintf(stderr, "avpriv_slicethread_create failed\n");
+            return 1;
+        }
+        c->nb_threads = ret;
+    }
+
+    for (i = 0; i < NB_CLIENTS; i++)
+        if ((ret = pthread_create(&threads[i], NULL, client_main, &clients[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            return 1;
+        }
+    /* resize the pool while it is in use */
+    if (pool_size)
+        av_thread_pool_set_size(pool_size + 2);
+    for (i = 0; i < NB_CLIENTS; i++) {
+        pthread_join(threads[i], NULL);
+        errors += clients[i].errors;
+        avpriv_slicethread_free(&clients[i].slicethread);
+    }
+
+    if (errors)
+        fprintf(stderr, "pool size %d: %d errors\n", pool_size, errors);
+    return !!errors;
+}
+
+static int check_nb_threads(Client *c, int expected)
+{
+    c->nb_jobs = 8;
+    avpriv_slicethread_execute(c->slicethread, c->nb_jobs, 0);
+    if (atomic_load(&c->last_nb_threads) != expected) {
+        fprintf(stderr, "%d threads instead of %d\n",
+                atomic_load(&c->last_nb_threads), expected);
+        return 1;
+    }
+    return 0;
+}
+
+static int run_resize(void)
+{
+    Client c;
+    int ret = 0;
+
+    memset(&c, 0, sizeof(c));
+    if (av_thread_pool_set_size(1) < 0)
+        return 1;
+    c.nb_threads = avpriv_slicethread_create(&c.slicethread, &c, worker_func, NULL, 4);
+    if (c.nb_threads != 4) {
+        avpriv_slicethread_free(&c.slicethread);
+        return 1;
+    }
+    ret |= check_nb_threads(&c, 2);
+    ret |= av_thread_pool_set_size(3) < 0;
+    ret |= check_nb_threads(&c, 4);
+    ret |= av_thread_pool_set_size(2) < 0;
+    ret |= check_nb_threads(&c, 3);
+    ret |= c.errors;
+    avpriv_slicethread_free(&c.slicethread);
+
+    return ret;
+}
+
+int main(void)
+{
+    int ret = 0;
+
+    ret |= run(0);
+    ret |= run(1);
+    ret |= run(3);
+    ret |= run_resize();
+    ret |= av_thread_pool_set_size(0) < 0;
+
+    return ret;
+}
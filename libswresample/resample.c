@@ -487,15 +487,26 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
         int delta_n = (delta_frac + c->dst_incr - 1) / c->dst_incr;
         int (*resample_func)(struct ResampleContext *c, void *dst,
                              const void *src, int n, int update_ctx);
+        int (*resample_multi)(struct ResampleContext *c, uint8_t **dst,
+                              uint8_t * const *src, int ch_count, int n);
 
         dst_size = FFMAX(FFMIN(dst_size, delta_n), 0);
         if (dst_size > 0) {
             /* resample_linear and resample_common should have same behavior
              * when frac and dst_incr_mod are zero */
-            resample_func = (c->linear && (c->frac || c->dst_incr_mod)) ?
-                            c->dsp.resample_linear : c->dsp.resample_common;
-            for (i = 0; i < dst->ch_count; i++)
-                *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            if (c->linear && (c->frac || c->dst_incr_mod)) {
+                resample_func  = c->dsp.resample_linear;
+                resample_multi = c->dsp.resample_linear_multi;
+            } else {
+                resample_func  = c->dsp.resample_common;
+                resample_multi = c->dsp.resample_common_multi;
+            }
+            if (resample_multi && dst->ch_count > 1) {
+                *consumed = resample_multi(c, dst->ch, src->ch, dst->ch_count, dst_size);
+            } else {
+                for (i = 0; i < dst->ch_count; i++)
+                    *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            }
         }
     }
 
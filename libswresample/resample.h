@@ -57,6 +57,12 @@ typedef struct ResampleContext {
                                const void *src, int n, int update_ctx);
         int (*resample_linear)(struct ResampleContext *c, void *dst,
                                const void *src, int n, int update_ctx);
+        /* same as resample_common/linear for all channels at once, sharing
+         * the filter loads between channels; always update the context */
+        int (*resample_common_multi)(struct ResampleContext *c, uint8_t **dst,
+                                     uint8_t * const *src, int ch_count, int n);
+        int (*resample_linear_multi)(struct ResampleContext *c, uint8_t **dst,
+                                     uint8_t * const *src, int ch_count, int n);
     } dsp;
 } ResampleContext;
 
@@ -45,30 +45,53 @@
 
 void swri_resample_dsp_init(ResampleContext *c)
 {
+    void *common_c, *common_multi_c, *linear_c, *linear_multi_c;
+
     switch(c->format){
     case AV_SAMPLE_FMT_S16P:
         c->dsp.resample_one = resample_one_int16;
         c->dsp.resample_common = resample_common_int16;
         c->dsp.resample_linear = resample_linear_int16;
+        c->dsp.resample_common_multi = resample_common_multi_int16;
+        c->dsp.resample_linear_multi = resample_linear_multi_int16;
         break;
     case AV_SAMPLE_FMT_S32P:
         c->dsp.resample_one = resample_one_int32;
         c->dsp.resample_common = resample_common_int32;
         c->dsp.resample_linear = resample_linear_int32;
+        c->dsp.resample_common_multi = resample_common_multi_int32;
+        c->dsp.resample_linear_multi = resample_linear_multi_int32;
         break;
     case AV_SAMPLE_FMT_FLTP:
         c->dsp.resample_one = resample_one_float;
         c->dsp.resample_common = resample_common_float;
         c->dsp.resample_linear = resample_linear_float;
+        c->dsp.resample_common_multi = resample_common_multi_float;
+        c->dsp.resample_linear_multi = resample_linear_multi_float;
         break;
     case AV_SAMPLE_FMT_DBLP:
         c->dsp.resample_one = resample_one_double;
         c->dsp.resample_common = resample_common_double;
         c->dsp.resample_linear = resample_linear_double;
+        c->dsp.resample_common_multi = resample_common_multi_double;
+        c->dsp.resample_linear_multi = resample_linear_multi_double;
         break;
     }
 
+    common_c       = c->dsp.resample_common;
+    common_multi_c = c->dsp.resample_common_multi;
+    linear_c       = c->dsp.resample_linear;
+    linear_multi_c = c->dsp.resample_linear_multi;
+
     if (ARCH_X86) swri_resample_dsp_x86_init(c);
     else if (ARCH_ARM) swri_resample_dsp_arm_init(c);
     else if (ARCH_AARCH64) swri_resample_dsp_aarch64_init(c);
+
+    /* SIMD per channel kernels are faster than the C multichannel one */
+    if (c->dsp.resample_common != common_c &&
+        c->dsp.resample_common_multi == common_multi_c)
+        c->dsp.resample_common_multi = NULL;
+    if (c->dsp.resample_linear != linear_c &&
+        c->dsp.resample_linear_multi == linear_multi_c)
+        c->dsp.resample_linear_multi = NULL;
 }
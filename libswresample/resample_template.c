@@ -140,6 +140,61 @@ static int RENAME(resample_common)(ResampleContext *c,
     return sample_index;
 }
 
+static int RENAME(resample_common_multi)(ResampleContext *c,
+                                         uint8_t **dest, uint8_t * const *source,
+                                         int ch_count, int n)
+{
+    int dst_index, ch;
+    int index= c->index;
+    int frac= c->frac;
+    int sample_index = 0;
+
+    while (index >= c->phase_count) {
+        sample_index++;
+        index -= c->phase_count;
+    }
+
+    for (dst_index = 0; dst_index < n; dst_index++) {
+        FELEM *filter = ((FELEM *) c->filter_bank) + c->filter_alloc * index;
+
+        for (ch = 0; ch < ch_count; ch++) {
+            const DELEM *src = (const DELEM *)source[ch] + sample_index;
+            DELEM *dst = (DELEM *)dest[ch];
+            FELEM2 val = FOFFSET;
+            FELEM2 val2= 0;
+            int i;
+            for (i = 0; i + 1 < c->filter_length; i+=2) {
+                val  += src[i    ] * (FELEM2)filter[i    ];
+                val2 += src[i + 1] * (FELEM2)filter[i + 1];
+            }
+            if (i < c->filter_length)
+                val  += src[i    ] * (FELEM2)filter[i    ];
+#ifdef FELEML
+            OUT(dst[dst_index], val + (FELEML)val2);
+#else
+            OUT(dst[dst_index], val + val2);
+#endif
+        }
+
+        frac  += c->dst_incr_mod;
+        index += c->dst_incr_div;
+        if (frac >= c->src_incr) {
+            frac -= c->src_incr;
+            index++;
+        }
+
+        while (index >= c->phase_count) {
+            sample_index++;
+            index -= c->phase_count;
+        }
+    }
+
+    c->frac= frac;
+    c->index= index;
+
+    return sample_index;
+}
+
 static int RENAME(resample_linear)(ResampleContext *c,
                                    void *dest, const void *source,
                                    int n, int update_ctx)
@@ -200,6 +255,66 @@ static int RENAME(resample_linear)(ResampleContext *c,
     return sample_index;
 }
 
+static int RENAME(resample_linear_multi)(ResampleContext *c,
+                                         uint8_t **dest, uint8_t * const *source,
+                                         int ch_count, int n)
+{
+    int dst_index, ch;
+    int index= c->index;
+    int frac= c->frac;
+    int sample_index = 0;
+#if FILTER_SHIFT == 0
+    double inv_src_incr = 1.0 / c->src_incr;
+#endif
+
+    while (index >= c->phase_count) {
+        sample_index++;
+        index -= c->phase_count;
+    }
+
+    for (dst_index = 0; dst_index < n; dst_index++) {
+        FELEM *filter = ((FELEM *) c->filter_bank) + c->filter_alloc * index;
+
+        for (ch = 0; ch < ch_count; ch++) {
+            const DELEM *src = (const DELEM *)source[ch] + sample_index;
+            DELEM *dst = (DELEM *)dest[ch];
+            FELEM2 val = FOFFSET, v2 = FOFFSET;
+            int i;
+            for (i = 0; i < c->filter_length; i++) {
+                val += src[i] * (FELEM2)filter[i];
+                v2  += src[i] * (FELEM2)filter[i + c->filter_alloc];
+            }
+#ifdef FELEML
+            val += (v2 - val) * (FELEML) frac / c->src_incr;
+#else
+#    if FILTER_SHIFT == 0
+            val += (v2 - val) * inv_src_incr * frac;
+#    else
+            val += (v2 - val) / c->src_incr * frac;
+#    endif
+#endif
+            OUT(dst[dst_index], val);
+        }
+
+        frac += c->dst_incr_mod;
+        index += c->dst_incr_div;
+        if (frac >= c->src_incr) {
+            frac -= c->src_incr;
+            index++;
+        }
+
+        while (index >= c->phase_count) {
+            sample_index++;
+            index -= c->phase_count;
+        }
+    }
+
+    c->frac= frac;
+    c->index= index;
+
+    return sample_index;
+}
+
 #undef RENAME
 #undef FILTER_SHIFT
 #undef DELEM
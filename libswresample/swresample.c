@@ -24,6 +24,8 @@
 #include "libavutil/avassert.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/internal.h"
+#include "libavutil/slicethread.h"
+#include "resample.h"
 
 #include <float.h>
 
@@ -129,6 +131,9 @@ static void clear_context(SwrContext *s){
     swri_audio_convert_free(&s->out_convert);
     swri_audio_convert_free(&s->full_convert);
     swri_rematrix_free(s);
+    avpriv_slicethread_free(&s->slicethread);
+    av_freep(&s->resample_jobs);
+    s->nb_threads = 1;
 
     s->delayed_samples_fixup = 0;
     s->flushed = 0;
@@ -149,6 +154,109 @@ av_cold void swr_close(SwrContext *s){
     clear_context(s);
 }
 
+static void dither_channels(SwrContext *s, AudioData *dst, const AudioData *src,
+                            int count, int ch_start, int ch_end)
+{
+    const int noise_off = s->dither.noise.bps * s->dither.noise_pos;
+    int ch;
+
+    if (s->dither.method < SWR_DITHER_NS) {
+        if (s->mix_2_1_simd) {
+            int len1 = count & ~15;
+            int off  = len1 * src->bps;
+
+            if (len1)
+                for (ch = ch_start; ch < ch_end; ch++)
+                    s->mix_2_1_simd(dst->ch[ch], src->ch[ch], s->dither.noise.ch[ch] + noise_off, s->native_simd_one, 0, 0, len1);
+            if (count != len1)
+                for (ch = ch_start; ch < ch_end; ch++)
+                    s->mix_2_1_f(dst->ch[ch] + off, src->ch[ch] + off, s->dither.noise.ch[ch] + noise_off + off, s->native_one, 0, 0, count - len1);
+        } else {
+            for (ch = ch_start; ch < ch_end; ch++)
+                s->mix_2_1_f(dst->ch[ch], src->ch[ch], s->dither.noise.ch[ch] + noise_off, s->native_one, 0, 0, count);
+        }
+    } else {
+        switch (s->int_sample_fmt) {
+        case AV_SAMPLE_FMT_S16P: swri_noise_shaping_int16 (s, dst, src, &s->dither.noise, count, ch_start, ch_end); break;
+        case AV_SAMPLE_FMT_S32P: swri_noise_shaping_int32 (s, dst, src, &s->dither.noise, count, ch_start, ch_end); break;
+        case AV_SAMPLE_FMT_FLTP: swri_noise_shaping_float (s, dst, src, &s->dither.noise, count, ch_start, ch_end); break;
+        case AV_SAMPLE_FMT_DBLP: swri_noise_shaping_double(s, dst, src, &s->dither.noise, count, ch_start, ch_end); break;
+        }
+    }
+}
+
+static void channel_subset(AudioData *out, const AudioData *in, int ch_start, int ch_end)
+{
+    int ch;
+
+    *out = *in;
+    for (ch = ch_start; ch < ch_end; ch++)
+        out->ch[ch - ch_start] = in->ch[ch];
+    out->ch_count = ch_end - ch_start;
+}
+
+static void thread_worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    SwrContext *s = priv;
+    const int ch_count = s->job.src->ch_count;
+    const int ch_start = ch_count *  jobnr      / nb_jobs;
+    const int ch_end   = ch_count * (jobnr + 1) / nb_jobs;
+
+    if (s->job.resample) {
+        AudioData dst, src;
+        int ret, consumed;
+
+        channel_subset(&dst, s->job.dst, ch_start, ch_end);
+        channel_subset(&src, s->job.src, ch_start, ch_end);
+        ret = s->resampler->multiple_resample(&s->resample_jobs[jobnr], &dst, s->job.dst_count,
+                                              &src, s->job.src_count, &consumed);
+        if (!jobnr) {
+            s->job.ret      = ret;
+            s->job.consumed = consumed;
+        }
+    } else {
+        dither_channels(s, s->job.dst, s->job.src, s->job.dst_count, ch_start, ch_end);
+    }
+}
+
+static void execute_jobs(SwrContext *s, int resample, AudioData *dst, int dst_count,
+                         const AudioData *src, int src_count)
+{
+    s->job.resample  = resample;
+    s->job.dst       = dst;
+    s->job.dst_count = dst_count;
+    s->job.src       = src;
+    s->job.src_count = src_count;
+    avpriv_slicethread_execute(s->slicethread, FFMIN(s->nb_threads, src->ch_count), 0);
+}
+
+static av_cold int init_threads(SwrContext *s)
+{
+    int ret;
+
+    if (s->user_nb_threads == 1)
+        return 0;
+
+    ret = avpriv_slicethread_create(&s->slicethread, s, thread_worker, NULL, s->user_nb_threads);
+    if (ret == AVERROR(ENOSYS)) {
+        av_log(s, AV_LOG_WARNING, "Threading is not supported, using a single thread\n");
+        return 0;
+    }
+    if (ret < 0)
+        return ret;
+    s->nb_threads = ret;
+
+    /* the jobs advance private copies of the filter state in lockstep */
+    if (s->resample && s->resampler == &swri_resampler) {
+        s->resample_jobs = av_malloc_array(s->nb_threads, sizeof(*s->resample_jobs));
+        if (!s->resample_jobs)
+            return AVERROR(ENOMEM);
+    }
+
+    av_log(s, AV_LOG_DEBUG, "Using %d threads\n", s->nb_threads);
+    return 0;
+}
+
 av_cold int swr_init(struct SwrContext *s){
     int ret;
     char l1[1024], l2[1024];
@@ -333,6 +441,9 @@ av_assert0(s->out.ch_count);
         return 0;
     }
 
+    if ((ret = init_threads(s)) < 0)
+        goto fail;
+
     s->in_convert = swri_audio_convert_alloc(s->int_sample_fmt,
                                              s-> in_sample_fmt, s->used_ch_count, s->channel_map, 0);
     s->out_convert= swri_audio_convert_alloc(s->out_sample_fmt,
@@ -472,6 +583,23 @@ static void buf_set(AudioData *out, AudioData *in, int count){
     }
 }
 
+static int multiple_resample(SwrContext *s, AudioData *dst, int dst_size,
+                             AudioData *src, int src_size, int *consumed)
+{
+    int i, nb_jobs = FFMIN(s->nb_threads, src->ch_count);
+
+    if (!s->resample_jobs || nb_jobs < 2)
+        return s->resampler->multiple_resample(s->resample, dst, dst_size, src, src_size, consumed);
+
+    for (i = 0; i < nb_jobs; i++)
+        s->resample_jobs[i] = *s->resample;
+    execute_jobs(s, 1, dst, dst_size, src, src_size);
+    *s->resample = s->resample_jobs[0];
+    *consumed    = s->job.consumed;
+
+    return s->job.ret;
+}
+
 /**
  *
  * @return number of samples output per channel
@@ -506,7 +634,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
         int ret, size, consumed;
         if(!s->resample_in_constraint && s->in_buffer_count){
             buf_set(&tmp, &s->in_buffer, s->in_buffer_index);
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &tmp, s->in_buffer_count, &consumed);
+            ret= multiple_resample(s, &out, out_count, &tmp, s->in_buffer_count, &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -526,7 +654,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
 
         if((s->flushed || in_count > padless) && !s->in_buffer_count){
             s->in_buffer_index=0;
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &in, FFMAX(in_count-padless, 0), &consumed);
+            ret= multiple_resample(s, &out, out_count, &in, FFMAX(in_count-padless, 0), &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -668,28 +796,13 @@ static int swr_convert_internal(struct SwrContext *s, AudioData *out, int out_co
             if(s->dither.noise_pos + out_count > s->dither.noise.count)
                 s->dither.noise_pos = 0;
 
-            if (s->dither.method < SWR_DITHER_NS){
-                if (s->mix_2_1_simd) {
-                    int len1= out_count&~15;
-                    int off = len1 * preout->bps;
-
-                    if(len1)
-                        for(ch=0; ch<preout->ch_count; ch++)
-                            s->mix_2_1_simd(conv_src->ch[ch], preout->ch[ch], s->dither.noise.ch[ch] + s->dither.noise.bps * s->dither.noise_pos, s->native_simd_one, 0, 0, len1);
-                    if(out_count != len1)
-                        for(ch=0; ch<preout->ch_count; ch++)
-                            s->mix_2_1_f(conv_src->ch[ch] + off, preout->ch[ch] + off, s->dither.noise.ch[ch] + s->dither.noise.bps * s->dither.noise_pos + off, s->native_one, 0, 0, out_count - len1);
-                } else {
-                    for(ch=0; ch<preout->ch_count; ch++)
-                        s->mix_2_1_f(conv_src->ch[ch], preout->ch[ch], s->dither.noise.ch[ch] + s->dither.noise.bps * s->dither.noise_pos, s->native_one, 0, 0, out_count);
-                }
-            } else {
-                switch(s->int_sample_fmt) {
-                case AV_SAMPLE_FMT_S16P :swri_noise_shaping_int16(s, conv_src, preout, &s->dither.noise, out_count); break;
-                case AV_SAMPLE_FMT_S32P :swri_noise_shaping_int32(s, conv_src, preout, &s->dither.noise, out_count); break;
-                case AV_SAMPLE_FMT_FLTP :swri_noise_shaping_float(s, conv_src, preout, &s->dither.noise, out_count); break;
-                case AV_SAMPLE_FMT_DBLP :swri_noise_shaping_double(s,conv_src, preout, &s->dither.noise, out_count); break;
-                }
+            if (s->slicethread && preout->ch_count > 1)
+                execute_jobs(s, 0, conv_src, out_count, preout, out_count);
+            else
+                dither_channels(s, conv_src, preout, out_count, 0, preout->ch_count);
+            if (s->dither.method >= SWR_DITHER_NS) {
+                const int taps = s->dither.ns_taps;
+                s->dither.ns_pos = (s->dither.ns_pos - out_count % taps + taps) % taps;
             }
             s->dither.noise_pos += out_count;
         }
@@ -184,16 +184,35 @@ struct SwrContext {
 
     mix_any_func_type *mix_any_f;
 
+    int user_nb_threads;                            ///< User set number of threads, 0 for automatic
+    int nb_threads;                                 ///< number of threads the channels are split over, 1 if not threaded
+    struct AVSliceThread *slicethread;              ///< resample and dither worker threads
+    struct ResampleContext *resample_jobs;          ///< per job copies of the resampling context (swr engine only)
+    struct {
+        int resample;                               ///< 1 for the resample stage, 0 for the dither stage
+        AudioData *dst;
+        const AudioData *src;
+        int dst_count;
+        int src_count;
+        int ret;                                    ///< output sample count of job 0 (resample stage)
+        int consumed;                               ///< input sample count of job 0 (resample stage)
+    } job;                                          ///< arguments of the stage run by the worker threads
+
     /* TODO: callbacks for ASM optimizations */
 };
 
 av_warn_unused_result
 int swri_realloc_audio(AudioData *a, int count);
 
-void swri_noise_shaping_int16 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
-void swri_noise_shaping_int32 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
-void swri_noise_shaping_float (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
-void swri_noise_shaping_double(SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
+/* processes channels [ch_start, ch_end), the caller advances dither.ns_pos */
+void swri_noise_shaping_int16 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count,
+                               int ch_start, int ch_end);
+void swri_noise_shaping_int32 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count,
+                               int ch_start, int ch_end);
+void swri_noise_shaping_float (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count,
+                               int ch_start, int ch_end);
+void swri_noise_shaping_double(SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count,
+                               int ch_start, int ch_end);
 
 av_warn_unused_result
 int swri_rematrix_init(SwrContext *s);
@@ -23,6 +23,8 @@
 #include "libavutil/channel_layout.h"
 #include "libavutil/common.h"
 #include "libavutil/opt.h"
+#include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
 
 #include "libswresample/swresample.h"
 
@@ -222,6 +224,68 @@ static void audiogen(void *data, enum AVSampleFormat sample_fmt,
     }
 }
 
+#define BENCH_SECONDS 4
+#define BENCH_FRAME   1024
+
+/**
+ * Resample BENCH_SECONDS of ch_count channel audio from 44100 to 48000 Hz
+ * with a large filter bank, as used for broadcast masters, and print the
+ * speed relative to realtime.
+ */
+static int bench(int ch_count, enum AVSampleFormat fmt, int threads)
+{
+    const int in_rate = 44100, out_rate = 48000;
+    const int out_max = av_rescale_rnd(BENCH_FRAME, out_rate, in_rate, AV_ROUND_UP) + 64;
+    uint8_t **in = NULL, **out = NULL;
+    struct SwrContext *swr = swr_alloc();
+    int64_t t;
+    int i, ch, ret;
+
+    if (!swr)
+        return AVERROR(ENOMEM);
+    av_opt_set_int(swr, "ich", ch_count, 0);
+    av_opt_set_int(swr, "och", ch_count, 0);
+    av_opt_set_int(swr, "isr", in_rate, 0);
+    av_opt_set_int(swr, "osr", out_rate, 0);
+    av_opt_set_sample_fmt(swr, "isf", fmt, 0);
+    av_opt_set_sample_fmt(swr, "osf", fmt, 0);
+    av_opt_set_sample_fmt(swr, "internal_sample_fmt", fmt, 0);
+    av_opt_set_int(swr, "filter_size", 64, 0);
+    av_opt_set_int(swr, "phase_shift", 14, 0);
+    av_opt_set_int(swr, "exact_rational", 0, 0);
+    av_opt_set_int(swr, "linear_interp", 0, 0);
+    av_opt_set_int(swr, "threads", threads, 0);
+    if ((ret = swr_init(swr)) < 0 ||
+        (ret = av_samples_alloc_array_and_samples(&in, NULL, ch_count, BENCH_FRAME, fmt, 0)) < 0 ||
+        (ret = av_samples_alloc_array_and_samples(&out, NULL, ch_count, out_max, fmt, 0)) < 0)
+        goto end;
+
+    for (ch = 0; ch < ch_count; ch++)
+        for (i = 0; i < BENCH_FRAME; i++)
+            set(in, ch, i, ch_count, fmt, sin(i * (ch + 1) * 0.01) * 0.5);
+
+    t = av_gettime_relative();
+    for (i = 0; i < BENCH_SECONDS * in_rate / BENCH_FRAME; i++) {
+        if ((ret = swr_convert(swr, out, out_max, (const uint8_t **)in, BENCH_FRAME)) < 0)
+            goto end;
+    }
+    t = av_gettime_relative() - t;
+
+    fprintf(stderr, "BENCH: %2d channels %-4s %d->%d, %d threads: %8.1f ms per second of audio, %6.1fx realtime\n",
+            ch_count, av_get_sample_fmt_name(fmt), in_rate, out_rate, threads,
+            t / 1000.0 / BENCH_SECONDS, BENCH_SECONDS * 1000000.0 / FFMAX(t, 1));
+    ret = 0;
+end:
+    if (in)
+        av_freep(&in[0]);
+    av_freep(&in);
+    if (out)
+        av_freep(&out[0]);
+    av_freep(&out);
+    swr_free(&swr);
+    return ret;
+}
+
 int main(int argc, char **argv){
     int in_sample_rate, out_sample_rate, ch ,i, flush_count;
     uint64_t in_ch_layout, out_ch_layout;
@@ -248,7 +312,26 @@ int main(int argc, char **argv){
     if (argc > 1) {
         if (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
             av_log(NULL, AV_LOG_INFO, "Usage: swresample-test [<num_tests>[ <test>]]  \n"
-                   "num_tests           Default is %d\n", num_tests);
+                   "       swresample-test bench [<channels>[ <threads>]]\n"
+                   "num_tests           Default is %d\n"
+                   "bench               Benchmark 16 and 32 channel resampling, or <channels>,\n"
+                   "                    on 1 or <threads> threads\n", num_tests);
+            return 0;
+        }
+        if (!strcmp(argv[1], "bench")) {
+            static const enum AVSampleFormat bench_fmts[] = { AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_S16P };
+            int channels[2] = { 16, 32 }, nb_channels = 2, threads = 1, j;
+
+            if (argc > 2) {
+                channels[0] = av_clip(strtol(argv[2], NULL, 0), 1, 64);
+                nb_channels = 1;
+            }
+            if (argc > 3)
+                threads = av_clip(strtol(argv[3], NULL, 0), 0, 64);
+            for (i = 0; i < nb_channels; i++)
+                for (j = 0; j < FF_ARRAY_ELEMS(bench_fmts); j++)
+                    if (bench(channels[i], bench_fmts[j], threads) < 0)
+                        return 1;
             return 0;
         }
         num_tests = strtol(argv[1], NULL, 0);
@@ -617,3 +617,66 @@ RESAMPLE_FNS double, 8, 3, d, pdbl_1
 INIT_YMM fma3
 RESAMPLE_FNS double, 8, 3, d, pdbl_1
 %endif
+
+%if ARCH_X86_64
+; void resample_dot4_float(float *sum, const float *filter,
+;                          const float * const *src, int len)
+; dot products of one filter phase with the samples of 4 channels, len must
+; be a multiple of mmsize / 4
+%macro RESAMPLE_DOT4_FLOAT 0
+cglobal resample_dot4_float, 4, 8, 6, sum, filter, src, len, src0, src1, src2, src3
+    mov                  src0q, [srcq + 0 * gprsize]
+    mov                  src1q, [srcq + 1 * gprsize]
+    mov                  src2q, [srcq + 2 * gprsize]
+    mov                  src3q, [srcq + 3 * gprsize]
+    movsxdifnidn          lenq, lend
+    shl                   lenq, 2
+    add                filterq, lenq
+    add                  src0q, lenq
+    add                  src1q, lenq
+    add                  src2q, lenq
+    add                  src3q, lenq
+    neg                   lenq
+
+    xorps                    m0, m0
+    xorps                    m1, m1
+    xorps                    m2, m2
+    xorps                    m3, m3
+.loop:
+    movups                   m4, [filterq + lenq]
+    fmaddps                  m0, m4, [src0q + lenq], m0
+    fmaddps                  m1, m4, [src1q + lenq], m1
+    fmaddps                  m2, m4, [src2q + lenq], m2
+    fmaddps                  m3, m4, [src3q + lenq], m3
+    add                   lenq, mmsize
+    jl .loop
+
+    ; add up the lanes of each channel
+    vextractf128            xm4, m0, 1
+    vextractf128            xm5, m1, 1
+    addps                   xm0, xm4
+    addps                   xm1, xm5
+    vextractf128            xm4, m2, 1
+    vextractf128            xm5, m3, 1
+    addps                   xm2, xm4
+    addps                   xm3, xm5
+
+    ; transpose the 4x4 partial sums and add them up
+    unpcklps                xm4, xm0, xm1 ; a0 b0 a1 b1
+    unpckhps                xm0, xm1      ; a2 b2 a3 b3
+    unpcklps                xm5, xm2, xm3 ; c0 d0 c1 d1
+    unpckhps                xm2, xm3      ; c2 d2 c3 d3
+    addps                   xm0, xm4
+    addps                   xm2, xm5
+    unpcklpd                xm1, xm0, xm2
+    unpckhpd                xm0, xm2
+    addps                   xm0, xm1
+    movups               [sumq], xm0
+    RET
+%endmacro
+
+%if HAVE_FMA3_EXTERNAL
+INIT_YMM fma3
+RESAMPLE_DOT4_FLOAT
+%endif
+%endif
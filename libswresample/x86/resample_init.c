@@ -45,6 +45,108 @@ RESAMPLE_FUNCS(double, sse2);
 RESAMPLE_FUNCS(double, avx);
 RESAMPLE_FUNCS(double, fma3);
 
+#if ARCH_X86_64 && HAVE_FMA3_EXTERNAL
+void ff_resample_dot4_float_fma3(float *sum, const float *filter,
+                                 const float * const *src, int len);
+
+/* dot products of one filter phase with up to 4 channels, the asm function
+ * handles the taps up to a multiple of 8 */
+static av_always_inline void dot_fma3(const float *filter, const float *src[4],
+                                      int nb, int len, float sum[4])
+{
+    const int len8 = len & ~7;
+    int k, i;
+
+    if (len8)
+        ff_resample_dot4_float_fma3(sum, filter, src, len8);
+    else
+        sum[0] = sum[1] = sum[2] = sum[3] = 0;
+    for (k = 0; k < nb; k++)
+        for (i = len8; i < len; i++)
+            sum[k] += src[k][i] * filter[i];
+}
+
+/* the source pointers of a group of up to 4 channels, the last group is
+ * filled up with its first channel */
+static av_always_inline int get_group(const float *src[4], uint8_t * const *source,
+                                      int ch, int ch_count, int sample_index)
+{
+    int k, nb = FFMIN(ch_count - ch, 4);
+
+    for (k = 0; k < 4; k++)
+        src[k] = (const float *)source[ch + FFMIN(k, nb - 1)] + sample_index;
+    return nb;
+}
+
+static av_always_inline int resample_multi_float_fma3(ResampleContext *c,
+                                                      uint8_t **dest,
+                                                      uint8_t * const *source,
+                                                      int ch_count, int n, int linear)
+{
+    int dst_index, ch;
+    int index = c->index;
+    int frac  = c->frac;
+    int sample_index = 0;
+    double inv_src_incr = 1.0 / c->src_incr;
+
+    while (index >= c->phase_count) {
+        sample_index++;
+        index -= c->phase_count;
+    }
+
+    for (dst_index = 0; dst_index < n; dst_index++) {
+        const float *filter = (const float *)c->filter_bank + c->filter_alloc * index;
+
+        for (ch = 0; ch < ch_count; ch += 4) {
+            const float *src[4];
+            float sum[4], sum2[4];
+            int k, nb = get_group(src, source, ch, ch_count, sample_index);
+
+            dot_fma3(filter, src, nb, c->filter_length, sum);
+            if (linear)
+                dot_fma3(filter + c->filter_alloc, src, nb, c->filter_length, sum2);
+            for (k = 0; k < nb; k++) {
+                float val = sum[k];
+                if (linear)
+                    val += (sum2[k] - val) * inv_src_incr * frac;
+                ((float *)dest[ch + k])[dst_index] = val;
+            }
+        }
+
+        frac  += c->dst_incr_mod;
+        index += c->dst_incr_div;
+        if (frac >= c->src_incr) {
+            frac -= c->src_incr;
+            index++;
+        }
+
+        while (index >= c->phase_count) {
+            sample_index++;
+            index -= c->phase_count;
+        }
+    }
+
+    c->frac  = frac;
+    c->index = index;
+
+    return sample_index;
+}
+
+static int resample_common_multi_float_fma3(ResampleContext *c,
+                                            uint8_t **dest, uint8_t * const *source,
+                                            int ch_count, int n)
+{
+    return resample_multi_float_fma3(c, dest, source, ch_count, n, 0);
+}
+
+static int resample_linear_multi_float_fma3(ResampleContext *c,
+                                            uint8_t **dest, uint8_t * const *source,
+                                            int ch_count, int n)
+{
+    return resample_multi_float_fma3(c, dest, source, ch_count, n, 1);
+}
+#endif /* ARCH_X86_64 && HAVE_FMA3_EXTERNAL */
+
 av_cold void swri_resample_dsp_x86_init(ResampleContext *c)
 {
     int av_unused mm_flags = av_get_cpu_flags();
@@ -81,6 +183,12 @@ av_cold void swri_resample_dsp_x86_init(ResampleContext *c)
             c->dsp.resample_linear = ff_resample_linear_float_fma4;
             c->dsp.resample_common = ff_resample_common_float_fma4;
         }
+#if ARCH_X86_64 && HAVE_FMA3_EXTERNAL
+        if (EXTERNAL_FMA3_FAST(mm_flags)) {
+            c->dsp.resample_common_multi = resample_common_multi_float_fma3;
+            c->dsp.resample_linear_multi = resample_linear_multi_float_fma3;
+        }
+#endif
         break;
     case AV_SAMPLE_FMT_DBLP:
         if (EXTERNAL_SSE2(mm_flags)) {
@@ -0,0 +1,239 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Fused area downscaler from 10-bit to 8-bit 4:2:0.
+ *
+ * For 2:1 and 3:2 ratios every sample of the area filter output is a
+ * weighted sum of a 2x2 block of source samples, with weights 1 1 for 2:1,
+ * and 2 1 / 1 2 for even / odd outputs for 3:2. The sum is mapped to the
+ * output sample by a table which also does the rounding, the bit depth
+ * reduction and the range conversion, so every row is read straight from the
+ * source frame and written straight to the destination frame, without
+ * going through the intermediate line buffers of the generic scaler.
+ */
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "swscale.h"
+#include "swscale_internal.h"
+
+typedef void (*fused_row_fn)(uint8_t *dst, const uint16_t *src0,
+                             const uint16_t *src1, int w,
+                             int wy0, int wy1, const uint8_t *lut);
+
+#define LOAD(src, i) (shift ? (src)[(i) * sstep] >> shift : \
+                              (src)[(i) * sstep] & 0x3FF)
+
+static av_always_inline void fused_row(uint8_t *dst, int dstep,
+                                       const uint16_t *src0,
+                                       const uint16_t *src1,
+                                       int sstep, int shift, int ratio, int w,
+                                       int wy0, int wy1, const uint8_t *lut)
+{
+    int i;
+
+    if (ratio == 2) {
+        for (i = 0; i < w; i++) {
+            int s0 = LOAD(src0, 2 * i) + LOAD(src0, 2 * i + 1);
+            int s1 = LOAD(src1, 2 * i) + LOAD(src1, 2 * i + 1);
+            dst[i * dstep] = lut[wy0 * s0 + wy1 * s1];
+        }
+    } else {
+        /* w is even for exact 3:2 ratios */
+        for (i = 0; i < w; i += 2) {
+            const int j = 3 * (i >> 1);
+            int a0 = LOAD(src0, j), b0 = LOAD(src0, j + 1), c0 = LOAD(src0, j + 2);
+            int a1 = LOAD(src1, j), b1 = LOAD(src1, j + 1), c1 = LOAD(src1, j + 2);
+            dst[ i      * dstep] = lut[wy0 * (2 * a0 + b0) + wy1 * (2 * a1 + b1)];
+            dst[(i + 1) * dstep] = lut[wy0 * (b0 + 2 * c0) + wy1 * (b1 + 2 * c1)];
+        }
+    }
+}
+
+#define FUSED_ROW(ratio, sstep, shift, dstep)                                  \
+static void fused_row_ ## ratio ## _ ## sstep ## _ ## shift ## _ ## dstep(     \
+    uint8_t *dst, const uint16_t *src0, const uint16_t *src1, int w,          \
+    int wy0, int wy1, const uint8_t *lut)                                     \
+{                                                                             \
+    fused_row(dst, dstep, src0, src1, sstep, shift, ratio, w, wy0, wy1, lut); \
+}
+
+#define FUSED_ROWS(ratio)      \
+FUSED_ROW(ratio, 1, 0, 1)      \
+FUSED_ROW(ratio, 1, 0, 2)      \
+FUSED_ROW(ratio, 1, 6, 1)      \
+FUSED_ROW(ratio, 2, 6, 1)      \
+FUSED_ROW(ratio, 2, 6, 2)
+
+FUSED_ROWS(2)
+FUSED_ROWS(3)
+
+static fused_row_fn get_row_fn(int ratio, int p010, int chroma, int nv12)
+{
+#define RATIO_FN(ratio)                                                   \
+    if (!p010)                                                            \
+        return nv12 && chroma ? fused_row_ ## ratio ## _1_0_2             \
+                              : fused_row_ ## ratio ## _1_0_1;            \
+    if (!chroma)                                                          \
+        return fused_row_ ## ratio ## _1_6_1;                             \
+    return nv12 ? fused_row_ ## ratio ## _2_6_2 : fused_row_ ## ratio ## _2_6_1;
+
+    if (ratio == 2) {
+        RATIO_FN(2)
+    } else {
+        RATIO_FN(3)
+    }
+}
+
+static void fused_plane(fused_row_fn row, uint8_t *dst, int dst_stride,
+                        const uint8_t *src, int src_stride,
+                        int w, int h, int yratio, const uint8_t *lut)
+{
+    int y;
+
+    for (y = 0; y < h; y++) {
+        int y0, wy0, wy1;
+
+        if (yratio == 2) {
+            y0  = 2 * y;
+            wy0 = wy1 = 1;
+        } else {
+            y0  = 3 * (y >> 1) + (y & 1);
+            wy0 = y & 1 ? 1 : 2;
+            wy1 = 3 - wy0;
+        }
+        row(dst + y * dst_stride,
+            (const uint16_t *)(src +  y0      * src_stride),
+            (const uint16_t *)(src + (y0 + 1) * src_stride),
+            w, wy0, wy1, lut);
+    }
+}
+
+static void build_lut(uint8_t *lut, int n, int chroma,
+                      int src_range, int dst_range)
+{
+    int s;
+
+    for (s = 0; s <= 1023 * n; s++) {
+        double v = s / (double)n, out;
+
+        if (src_range == dst_range)
+            out = v / 4;
+        else if (chroma)
+            out = dst_range ? (v - 512) * 255 / 896  + 128
+                            : (v - 512) * 224 / 1020 + 128;
+        else
+            out = dst_range ? (v - 64) * 255 / 876
+                            :  v       * 219 / 1020 + 16;
+        lut[s] = av_clip_uint8(lrint(out));
+    }
+}
+
+static int fused_swscale(SwsContext *c, const uint8_t *src[],
+                         int srcStride[], int srcSliceY, int srcSliceH,
+                         uint8_t *dst[], int dstStride[])
+{
+    const int p010 = c->srcFormat == AV_PIX_FMT_P010;
+    const int nv12 = c->dstFormat == AV_PIX_FMT_NV12;
+    fused_row_fn row;
+    int i;
+
+    if (c->fused_lut_range[0] != c->srcRange ||
+        c->fused_lut_range[1] != c->dstRange) {
+        const int n = c->fused_xratio * c->fused_yratio;
+        build_lut(c->fused_lut[0], n, 0, c->srcRange, c->dstRange);
+        build_lut(c->fused_lut[1], n, 1, c->srcRange, c->dstRange);
+        c->fused_lut_range[0] = c->srcRange;
+        c->fused_lut_range[1] = c->dstRange;
+    }
+
+    row = get_row_fn(c->fused_xratio, p010, 0, nv12);
+    fused_plane(row, dst[0], dstStride[0], src[0], srcStride[0],
+                c->dstW, c->dstH, c->fused_yratio, c->fused_lut[0]);
+
+    row = get_row_fn(c->fused_xratio, p010, 1, nv12);
+    for (i = 0; i < 2; i++) {
+        const uint8_t *s = p010 ? src[1] + 2 * i : src[1 + i];
+        uint8_t       *d = nv12 ? dst[1] + i     : dst[1 + i];
+        fused_plane(row, d, dstStride[nv12 ? 1 : 1 + i],
+                    s, srcStride[p010 ? 1 : 1 + i],
+                    c->chrDstW, c->chrDstH, c->fused_yratio, c->fused_lut[1]);
+    }
+
+    return c->dstH;
+}
+
+/* 2 for 2:1, 3 for 3:2, 0 otherwise */
+static int get_ratio(int src, int dst)
+{
+    if (src == 2 * dst)
+        return 2;
+    if (2 * src == 3 * dst)
+        return 3;
+    return 0;
+}
+
+/* the box filter keeps chroma centered between the luma samples */
+static int centered_chroma(int pos)
+{
+    return pos == -1 || pos <= -513 || pos == 128;
+}
+
+av_cold int ff_sws_init_fused(SwsContext *c)
+{
+    const int scaler = c->flags & (SWS_FAST_BILINEAR | SWS_BILINEAR | SWS_BICUBIC |
+                                   SWS_X | SWS_POINT | SWS_AREA | SWS_BICUBLIN |
+                                   SWS_GAUSS | SWS_SINC | SWS_LANCZOS | SWS_SPLINE);
+    int xratio = get_ratio(c->srcW, c->dstW);
+    int yratio = get_ratio(c->srcH, c->dstH);
+    int size;
+
+    if (c->srcFormat != AV_PIX_FMT_P010 && c->srcFormat != AV_PIX_FMT_YUV420P10 ||
+        c->dstFormat != AV_PIX_FMT_NV12 && c->dstFormat != AV_PIX_FMT_YUV420P)
+        return 0;
+    /* the output is rounded, not dithered like the generic path */
+    if (c->flags & (SWS_BITEXACT | SWS_ACCURATE_RND))
+        return 0;
+    if (scaler != SWS_AREA || c->vChrDrop || c->gamma_flag)
+        return 0;
+    if (!centered_chroma(c->src_h_chr_pos) || !centered_chroma(c->src_v_chr_pos) ||
+        !centered_chroma(c->dst_h_chr_pos) || !centered_chroma(c->dst_v_chr_pos))
+        return 0;
+    if (!xratio || !yratio ||
+        get_ratio(c->chrSrcW, c->chrDstW) != xratio ||
+        get_ratio(c->chrSrcH, c->chrDstH) != yratio)
+        return 0;
+
+    size = 1023 * xratio * yratio + 1;
+    c->fused_lut[0] = av_malloc(2 * size);
+    if (!c->fused_lut[0])
+        return AVERROR(ENOMEM);
+    c->fused_lut[1] = c->fused_lut[0] + size;
+    c->fused_lut_range[0] = c->fused_lut_range[1] = -1;
+    c->fused_xratio  = xratio;
+    c->fused_yratio  = yratio;
+    c->fused_swscale = fused_swscale;
+
+    if (c->flags & SWS_PRINT_INFO)
+        av_log(c, AV_LOG_INFO, "using fused %s -> %s area downscaler\n",
+               av_get_pix_fmt_name(c->srcFormat), av_get_pix_fmt_name(c->dstFormat));
+
+    return 0;
+}
@@ -142,6 +142,39 @@ extern void (*deinterleaveBytes)(const uint8_t *src, uint8_t *dst1, uint8_t *dst
                                  int width, int height, int srcStride,
                                  int dst1Stride, int dst2Stride);
 
+/**
+ * Split rows of interleaved native-endian 16-bit samples into two planes,
+ * shifting every sample right by shift, as needed for P010 and P016 chroma.
+ * width is the number of samples per output plane, strides are in bytes.
+ */
+extern void (*deinterleaveWords)(const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
+                                 int width, int height, int srcStride,
+                                 int dst1Stride, int dst2Stride, int shift);
+
+/**
+ * Copy a plane of native-endian 16-bit samples, shifting every sample
+ * right by shift. Strides are in bytes.
+ */
+extern void (*rshiftWords)(const uint8_t *src, uint8_t *dst, int width,
+                           int height, int srcStride, int dstStride, int shift);
+
+/**
+ * Interleave two planes of native-endian 16-bit samples into rows of
+ * sample pairs, shifting every sample left by shift, as needed for P010
+ * and P016 chroma. width is the number of samples per input plane,
+ * strides are in bytes.
+ */
+extern void (*interleaveWords)(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
+                               int width, int height, int src1Stride,
+                               int src2Stride, int dstStride, int shift);
+
+/**
+ * Copy a plane of native-endian 16-bit samples, shifting every sample
+ * left by shift. Strides are in bytes.
+ */
+extern void (*lshiftWords)(const uint8_t *src, uint8_t *dst, int width,
+                           int height, int srcStride, int dstStride, int shift);
+
 extern void (*vu9_to_vu12)(const uint8_t *src1, const uint8_t *src2,
                            uint8_t *dst1, uint8_t *dst2,
                            int width, int height,
@@ -289,6 +289,9 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     int hasLumHoles = 1;
     int hasChrHoles = 1;
 
+    if (c->fused_swscale && !srcSliceY && srcSliceH == c->srcH)
+        return c->fused_swscale(c, src, srcStride, srcSliceY, srcSliceH,
+                                dst, dstStride);
 
     if (isPacked(c->srcFormat)) {
         src[0] =
@@ -297,6 +297,34 @@ struct SwsContext *sws_getCachedContext(struct SwsContext *context,
                                         int flags, SwsFilter *srcFilter,
                                         SwsFilter *dstFilter, const double *param);
 
+/**
+ * Set the number of scaler filters kept in the filter cache.
+ *
+ * The filter coefficients computed for a context are stored in a cache
+ * shared by all contexts of the process and reused by contexts created
+ * later with the same scaling parameters. Filters built from a user
+ * supplied SwsFilter are not cached. The least recently used filters are
+ * dropped when the cache is full. The default capacity is 64 filters.
+ *
+ * This function is thread-safe.
+ *
+ * @param capacity the maximum number of cached filters, 0 disables and
+ *                 empties the cache
+ * @return the previous capacity, or a negative AVERROR code on failure
+ */
+int sws_setFilterCacheCapacity(int capacity);
+
+/**
+ * Get the filter cache statistics accumulated since the start of the process.
+ *
+ * This function is thread-safe.
+ *
+ * @param hits    if not NULL, set to the number of filters found in the cache
+ * @param misses  if not NULL, set to the number of filters that were computed
+ * @param entries if not NULL, set to the number of filters currently cached
+ */
+void sws_getFilterCacheStats(uint64_t *hits, uint64_t *misses, int *entries);
+
 /**
  * Convert an 8-bit paletted frame into a frame with a color depth of 32 bits.
  *
@@ -625,6 +625,13 @@ typedef struct SwsContext {
     SwsDither dither;
 
     SwsAlphaBlend alphablend;
+
+    /* fused area downscaler, see fused.c */
+    SwsFunc fused_swscale;        ///< Used instead of the generic scaler for whole frames if set.
+    int fused_xratio;             ///< Horizontal ratio, 2 for 2:1, 3 for 3:2.
+    int fused_yratio;             ///< Vertical   ratio, 2 for 2:1, 3 for 3:2.
+    int fused_lut_range[2];       ///< Source and destination range the tables were built for.
+    uint8_t *fused_lut[2];        ///< Luma and chroma output tables, indexed by the weighted sum.
 } SwsContext;
 //FIXME check init (where 0)
 
@@ -852,6 +859,12 @@ void ff_get_unscaled_swscale_ppc(SwsContext *c);
 void ff_get_unscaled_swscale_arm(SwsContext *c);
 void ff_get_unscaled_swscale_aarch64(SwsContext *c);
 
+/**
+ * Set c->fused_swscale if the conversion can be done by the fused area
+ * downscaler, which bypasses the generic scaler for whole frames.
+ */
+int ff_sws_init_fused(SwsContext *c);
+
 /**
  * Return function pointer to fastest main scaler path function depending
  * on architecture and available optimizations.
@@ -0,0 +1,172 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Check the unscaled converters between P010/P016 and planar 4:2:0 with
+ * whole frames and with a slice starting at an odd line, which sws_scale()
+ * passes on when it flips bottom-up slices of an odd height frame.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/imgutils.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+#define W 46
+#define H 9
+#define FILLER 0xA5
+
+static const enum AVPixelFormat pairs[][2] = {
+    { AV_PIX_FMT_P010,      AV_PIX_FMT_YUV420P10 },
+    { AV_PIX_FMT_P016,      AV_PIX_FMT_YUV420P16 },
+    { AV_PIX_FMT_YUV420P10, AV_PIX_FMT_P010      },
+    { AV_PIX_FMT_YUV420P12, AV_PIX_FMT_P010      },
+    { AV_PIX_FMT_YUV420P16, AV_PIX_FMT_P016      },
+    { AV_PIX_FMT_YUV420P10, AV_PIX_FMT_P016      },
+};
+
+/* value of the sample of component comp at x, y, stored as the format does */
+static unsigned sample(const AVPixFmtDescriptor *desc, uint8_t *data[4],
+                       const int linesize[4], int comp, int x, int y)
+{
+    const AVComponentDescriptor *c = &desc->comp[comp];
+    const int cx = comp ? x >> desc->log2_chroma_w : x;
+    const int cy = comp ? y >> desc->log2_chroma_h : y;
+    const uint16_t *p = (const uint16_t *)(data[c->plane] + cy * linesize[c->plane] +
+                                           cx * c->step + c->offset);
+    return *p;
+}
+
+/* the sample the converter writes for src value v of component comp */
+static unsigned convert(const AVPixFmtDescriptor *src, const AVPixFmtDescriptor *dst,
+                        int comp, unsigned v)
+{
+    const int shift = dst->comp[comp].depth + dst->comp[comp].shift -
+                      src->comp[comp].depth - src->comp[comp].shift;
+
+    return (uint16_t)(shift >= 0 ? v << shift : v >> -shift);
+}
+
+/* check the h lines from y0 of dst and that nothing else was written */
+static int check(const char *what, const AVPixFmtDescriptor *sdesc,
+                 const AVPixFmtDescriptor *ddesc,
+                 uint8_t *src[4], const int src_linesize[4],
+                 uint8_t *dst[4], const int dst_linesize[4], int y0, int h)
+{
+    int comp, x, y;
+
+    for (comp = 0; comp < 3; comp++) {
+        const AVComponentDescriptor *c = &ddesc->comp[comp];
+        const int sub = comp ? ddesc->log2_chroma_h : 0;
+        /* chroma width as written by the P01x packer */
+        const int w = comp ? W >> ddesc->log2_chroma_w : W;
+        const int cy0 = y0 >> sub, cy1 = cy0 + AV_CEIL_RSHIFT(h, sub);
+
+        for (y = 0; y < AV_CEIL_RSHIFT(H, sub); y++) {
+            for (x = 0; x < w; x++) {
+                const int lx = comp ? x << ddesc->log2_chroma_w : x;
+                const int ly = y << sub;
+                const uint8_t *p = dst[c->plane] + y * dst_linesize[c->plane] +
+                                   x * c->step + c->offset;
+                unsigned want, got = *(const uint16_t *)p;
+
+                if (y >= cy0 && y < cy1)
+                    want = convert(sdesc, ddesc, comp,
+                                   sample(sdesc, src, src_linesize, comp, lx, ly));
+                else
+                    want = FILLER << 8 | FILLER;
+                if (got != want) {
+                    fprintf(stderr, "%s -> %s, %s: component %d at %d,%d "
+                            "is 0x%04x instead of 0x%04x\n", sdesc->name,
+                            ddesc->name, what, comp, x, y, got, want);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static int test_pair(enum AVPixelFormat src_fmt, enum AVPixelFormat dst_fmt,
+                     AVLFG *rnd)
+{
+    const AVPixFmtDescriptor *sdesc = av_pix_fmt_desc_get(src_fmt);
+    const AVPixFmtDescriptor *ddesc = av_pix_fmt_desc_get(dst_fmt);
+    uint8_t *src[4], *dst[4];
+    int src_linesize[4], dst_linesize[4];
+    const uint8_t *slice[4] = { NULL };
+    SwsContext *c;
+    int src_size, dst_size, i, ret = 1;
+
+    if ((src_size = av_image_alloc(src, src_linesize, W, H, src_fmt, 32)) < 0)
+        return 1;
+    if ((dst_size = av_image_alloc(dst, dst_linesize, W, H, dst_fmt, 32)) < 0) {
+        av_freep(&src[0]);
+        return 1;
+    }
+    for (i = 0; i < src_size / 4; i++)
+        AV_WN32A(src[0] + 4 * i, av_lfg_get(rnd));
+
+    c = sws_getContext(W, H, src_fmt, W, H, dst_fmt, SWS_POINT, NULL, NULL, NULL);
+    if (!c)
+        goto end;
+
+    memset(dst[0], FILLER, dst_size);
+    if (sws_scale(c, (const uint8_t * const *)src, src_linesize, 0, H,
+                  dst, dst_linesize) != H ||
+        check("frame", sdesc, ddesc, src, src_linesize, dst, dst_linesize, 0, H))
+        goto end;
+
+    /* a slice of lines 3 and 4 goes to chroma line 1 only */
+    for (i = 0; i < 3; i++) {
+        const int plane = sdesc->comp[i].plane;
+        const int y = plane ? 3 >> sdesc->log2_chroma_h : 3;
+        slice[plane] = src[plane] + y * src_linesize[plane];
+    }
+    memset(dst[0], FILLER, dst_size);
+    if (c->swscale(c, slice, src_linesize, 3, 2, dst, dst_linesize) != 2 ||
+        check("slice at line 3", sdesc, ddesc, src, src_linesize, dst, dst_linesize, 3, 2))
+        goto end;
+
+    ret = 0;
+end:
+    if (ret)
+        fprintf(stderr, "%s -> %s failed\n", sdesc->name, ddesc->name);
+    sws_freeContext(c);
+    av_freep(&src[0]);
+    av_freep(&dst[0]);
+    return ret;
+}
+
+int main(void)
+{
+    AVLFG rnd;
+    int i, ret = 0;
+
+    av_lfg_init(&rnd, 1);
+    for (i = 0; i < FF_ARRAY_ELEMS(pairs); i++)
+        ret |= test_pair(pairs[i][0], pairs[i][1], &rnd);
+
+    return ret;
+}
@@ -41,6 +41,7 @@
 #include "libavutil/attributes.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avutil.h"
+#include "libavutil/buffer.h"
 #include "libavutil/bswap.h"
 #include "libavutil/cpu.h"
 #include "libavutil/imgutils.h"
@@ -49,6 +50,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "libavutil/aarch64/cpu.h"
 #include "libavutil/ppc/cpu.h"
 #include "libavutil/x86/asm.h"
@@ -719,6 +721,202 @@ fail:
     return ret;
 }
 
+#define FILTER_CACHE_DEFAULT_CAPACITY 64
+
+/* all the initFilter() parameters a filter without SwsVector depends on */
+typedef struct FilterCacheKey {
+    int xInc;
+    int srcW;
+    int dstW;
+    int filterAlign;
+    int one;
+    int flags;
+    int cpu_flags;
+    double param[2];
+    int srcPos;
+    int dstPos;
+} FilterCacheKey;
+
+typedef struct FilterCacheEntry {
+    FilterCacheKey key;
+    /* filterPos[dstW + 3] followed by filter[(dstW + 3) * filterSize] */
+    AVBufferRef *buf;
+    int filterSize;
+    uint64_t last_use;
+} FilterCacheEntry;
+
+static AVMutex filter_cache_mutex = AV_MUTEX_INITIALIZER;
+static FilterCacheEntry *filter_cache;
+static int filter_cache_entries;
+static int filter_cache_capacity = FILTER_CACHE_DEFAULT_CAPACITY;
+static uint64_t filter_cache_hits;
+static uint64_t filter_cache_misses;
+static uint64_t filter_cache_clock;
+
+/* must be called with filter_cache_mutex locked */
+static void filter_cache_shrink(int capacity)
+{
+    while (filter_cache_entries > capacity) {
+        int i, lru = 0;
+
+        for (i = 1; i < filter_cache_entries; i++)
+            if (filter_cache[i].last_use < filter_cache[lru].last_use)
+                lru = i;
+        av_buffer_unref(&filter_cache[lru].buf);
+        filter_cache[lru] = filter_cache[--filter_cache_entries];
+    }
+    if (!filter_cache_entries)
+        av_freep(&filter_cache);
+}
+
+int sws_setFilterCacheCapacity(int capacity)
+{
+    int old;
+
+    if (capacity < 0)
+        return AVERROR(EINVAL);
+
+    ff_mutex_lock(&filter_cache_mutex);
+    old = filter_cache_capacity;
+    filter_cache_capacity = capacity;
+    filter_cache_shrink(capacity);
+    ff_mutex_unlock(&filter_cache_mutex);
+
+    return old;
+}
+
+void sws_getFilterCacheStats(uint64_t *hits, uint64_t *misses, int *entries)
+{
+    ff_mutex_lock(&filter_cache_mutex);
+    if (hits)
+        *hits = filter_cache_hits;
+    if (misses)
+        *misses = filter_cache_misses;
+    if (entries)
+        *entries = filter_cache_entries;
+    ff_mutex_unlock(&filter_cache_mutex);
+}
+
+static int filter_cache_size(const FilterCacheKey *key, int filterSize)
+{
+    return (key->dstW + 3) * (sizeof(int32_t) + filterSize * sizeof(int16_t));
+}
+
+static void filter_cache_add(const FilterCacheKey *key, const int16_t *filter,
+                             const int32_t *filterPos, int filterSize)
+{
+    AVBufferRef *buf = av_buffer_alloc(filter_cache_size(key, filterSize));
+    FilterCacheEntry *entry;
+    int i;
+
+    if (!buf)
+        return;
+    memcpy(buf->data, filterPos, (key->dstW + 3) * sizeof(*filterPos));
+    memcpy(buf->data + (key->dstW + 3) * sizeof(*filterPos), filter,
+           (key->dstW + 3) * filterSize * sizeof(*filter));
+
+    ff_mutex_lock(&filter_cache_mutex);
+    /* another thread may have added the same filter in the meantime */
+    for (i = 0; i < filter_cache_entries; i++)
+        if (!memcmp(&filter_cache[i].key, key, sizeof(*key)))
+            break;
+    if (i == filter_cache_entries && filter_cache_capacity > 0) {
+        if (filter_cache_entries == filter_cache_capacity)
+            filter_cache_shrink(filter_cache_capacity - 1);
+        entry = av_realloc_array(filter_cache, filter_cache_entries + 1,
+                                 sizeof(*filter_cache));
+        if (!entry)
+            goto end;
+        filter_cache      = entry;
+        entry             = &filter_cache[filter_cache_entries++];
+        entry->key        = *key;
+        entry->buf        = buf;
+        entry->filterSize = filterSize;
+        entry->last_use   = ++filter_cache_clock;
+        buf               = NULL;
+    }
+end:
+    ff_mutex_unlock(&filter_cache_mutex);
+    av_buffer_unref(&buf);
+}
+
+/**
+ * Same as initFilter(), but look the filter up in the filter cache first
+ * and store newly computed filters in it.
+ */
+static av_cold int getFilter(int16_t **outFilter, int32_t **filterPos,
+                             int *outFilterSize, int xInc, int srcW,
+                             int dstW, int filterAlign, int one,
+                             int flags, int cpu_flags,
+                             SwsVector *srcFilter, SwsVector *dstFilter,
+                             double param[2], int srcPos, int dstPos)
+{
+    FilterCacheKey key;
+    AVBufferRef *buf = NULL;
+    int filterSize = 0, i, ret;
+
+    if (srcFilter || dstFilter)
+        return initFilter(outFilter, filterPos, outFilterSize, xInc, srcW, dstW,
+                          filterAlign, one, flags, cpu_flags, srcFilter,
+                          dstFilter, param, srcPos, dstPos);
+
+    /* zero the padding so the keys can be compared with memcmp() */
+    memset(&key, 0, sizeof(key));
+    key.xInc        = xInc;
+    key.srcW        = srcW;
+    key.dstW        = dstW;
+    key.filterAlign = filterAlign;
+    key.one         = one;
+    key.flags       = flags & ~SWS_PRINT_INFO;
+    key.cpu_flags   = cpu_flags;
+    key.param[0]    = param[0];
+    key.param[1]    = param[1];
+    key.srcPos      = srcPos;
+    key.dstPos      = dstPos;
+
+    ff_mutex_lock(&filter_cache_mutex);
+    for (i = 0; i < filter_cache_entries; i++) {
+        if (!memcmp(&filter_cache[i].key, &key, sizeof(key))) {
+            buf = av_buffer_ref(filter_cache[i].buf);
+            filterSize = filter_cache[i].filterSize;
+            filter_cache[i].last_use = ++filter_cache_clock;
+            break;
+        }
+    }
+    if (buf)
+        filter_cache_hits++;
+    else
+        filter_cache_misses++;
+    ff_mutex_unlock(&filter_cache_mutex);
+
+    if (buf) {
+        /* the context owns and may modify its filters, give it a copy */
+        const int32_t *pos = (const int32_t *)buf->data;
+        const int16_t *coeff = (const int16_t *)(buf->data + (dstW + 3) * sizeof(*pos));
+
+        *filterPos = av_malloc_array(dstW + 3, sizeof(**filterPos));
+        *outFilter = av_malloc_array(dstW + 3, filterSize * sizeof(**outFilter));
+        if (!*filterPos || !*outFilter) {
+            av_freep(filterPos);
+            av_freep(outFilter);
+            av_buffer_unref(&buf);
+            return AVERROR(ENOMEM);
+        }
+        memcpy(*filterPos, pos, (dstW + 3) * sizeof(**filterPos));
+        memcpy(*outFilter, coeff, (dstW + 3) * filterSize * sizeof(**outFilter));
+        *outFilterSize = filterSize;
+        av_buffer_unref(&buf);
+        return 0;
+    }
+
+    ret = initFilter(outFilter, filterPos, outFilterSize, xInc, srcW, dstW,
+                     filterAlign, one, flags, cpu_flags, srcFilter, dstFilter,
+                     param, srcPos, dstPos);
+    if (ret >= 0)
+        filter_cache_add(&key, *outFilter, *filterPos, *outFilterSize);
+    return ret;
+}
+
 static void fill_rgb2yuv_table(SwsContext *c, const int table[4], int dstRange)
 {
     int64_t W, V, Z, Cy, Cu, Cv;
@@ -1667,23 +1865,23 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                                     PPC_ALTIVEC(cpu_flags) ? 8 :
                                     have_neon(cpu_flags)   ? 8 : 1;
 
-            if ((ret = initFilter(&c->hLumFilter, &c->hLumFilterPos,
-                           &c->hLumFilterSize, c->lumXInc,
-                           srcW, dstW, filterAlign, 1 << 14,
-                           (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
-                           cpu_flags, srcFilter->lumH, dstFilter->lumH,
-                           c->param,
-                           get_local_pos(c, 0, 0, 0),
-                           get_local_pos(c, 0, 0, 0))) < 0)
+            if ((ret = getFilter(&c->hLumFilter, &c->hLumFilterPos,
+                          &c->hLumFilterSize, c->lumXInc,
+                          srcW, dstW, filterAlign, 1 << 14,
+                          (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
+                          cpu_flags, srcFilter->lumH, dstFilter->lumH,
+                          c->param,
+                          get_local_pos(c, 0, 0, 0),
+                          get_local_pos(c, 0, 0, 0))) < 0)
                 goto fail;
-            if ((ret = initFilter(&c->hChrFilter, &c->hChrFilterPos,
-                           &c->hChrFilterSize, c->chrXInc,
-                           c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
-                           (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
-                           cpu_flags, srcFilter->chrH, dstFilter->chrH,
-                           c->param,
-                           get_local_pos(c, c->chrSrcHSubSample, c->src_h_chr_pos, 0),
-                           get_local_pos(c, c->chrDstHSubSample, c->dst_h_chr_pos, 0))) < 0)
+            if ((ret = getFilter(&c->hChrFilter, &c->hChrFilterPos,
+                          &c->hChrFilterSize, c->chrXInc,
+                          c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
+                          (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
+                          cpu_flags, srcFilter->chrH, dstFilter->chrH,
+                          c->param,
+                          get_local_pos(c, c->chrSrcHSubSample, c->src_h_chr_pos, 0),
+                          get_local_pos(c, c->chrDstHSubSample, c->dst_h_chr_pos, 0))) < 0)
                 goto fail;
         }
     } // initialize horizontal stuff
@@ -1694,22 +1892,22 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                                 PPC_ALTIVEC(cpu_flags) ? 8 :
                                 have_neon(cpu_flags)   ? 2 : 1;
 
-        if ((ret = initFilter(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
-                       c->lumYInc, srcH, dstH, filterAlign, (1 << 12),
-                       (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
-                       cpu_flags, srcFilter->lumV, dstFilter->lumV,
-                       c->param,
-                       get_local_pos(c, 0, 0, 1),
-                       get_local_pos(c, 0, 0, 1))) < 0)
+        if ((ret = getFilter(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
+                      c->lumYInc, srcH, dstH, filterAlign, (1 << 12),
+                      (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
+                      cpu_flags, srcFilter->lumV, dstFilter->lumV,
+                      c->param,
+                      get_local_pos(c, 0, 0, 1),
+                      get_local_pos(c, 0, 0, 1))) < 0)
             goto fail;
-        if ((ret = initFilter(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
-                       c->chrYInc, c->chrSrcH, c->chrDstH,
-                       filterAlign, (1 << 12),
-                       (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
-                       cpu_flags, srcFilter->chrV, dstFilter->chrV,
-                       c->param,
-                       get_local_pos(c, c->chrSrcVSubSample, c->src_v_chr_pos, 1),
-                       get_local_pos(c, c->chrDstVSubSample, c->dst_v_chr_pos, 1))) < 0)
+        if ((ret = getFilter(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
+                      c->chrYInc, c->chrSrcH, c->chrDstH,
+                      filterAlign, (1 << 12),
+                      (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
+                      cpu_flags, srcFilter->chrV, dstFilter->chrV,
+                      c->param,
+                      get_local_pos(c, c->chrSrcVSubSample, c->src_v_chr_pos, 1),
+                      get_local_pos(c, c->chrDstVSubSample, c->dst_v_chr_pos, 1))) < 0)
 
             goto fail;
 
@@ -1824,7 +2022,11 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
     }
 
     c->swscale = ff_getSwsFunc(c);
-    return ff_init_filters(c);
+    if ((ret = ff_init_filters(c)) < 0)
+        return ret;
+    if (!usesHFilter && !usesVFilter)
+        return ff_sws_init_fused(c);
+    return 0;
 fail: // FIXME replace things by appropriate error codes
     if (ret == RETCODE_USE_CASCADE)  {
         int tmpW = sqrt(srcW * (int64_t)dstW);
@@ -2325,6 +2527,7 @@ void sws_freeContext(SwsContext *c)
     av_freep(&c->vChrFilterPos);
     av_freep(&c->hLumFilterPos);
     av_freep(&c->hChrFilterPos);
+    av_freep(&c->fused_lut[0]);
 
 #if HAVE_MMX_INLINE
 #if USE_MMAP
@@ -234,3 +234,236 @@ UYVY_TO_YUV422
 INIT_XMM avx
 UYVY_TO_YUV422
 %endif
+
+;-----------------------------------------------------------------------------------------------
+; deinterleave_words(const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
+;                    int width, int height, int srcStride,
+;                    int dst1Stride, int dst2Stride, int shift)
+;-----------------------------------------------------------------------------------------------
+%macro DEINTERLEAVE_WORDS 0
+cglobal deinterleave_words, 9, 12, 5, src, dst1, dst2, w, h, src_stride, dst1_stride, dst2_stride, shift, x, cnt, tmp
+    movd                  xm4, shiftd
+
+    movsxdifnidn            wq, wd
+    movsxdifnidn   src_strideq, src_strided
+    movsxdifnidn  dst1_strideq, dst1_strided
+    movsxdifnidn  dst2_strideq, dst2_strided
+
+    lea                  srcq, [srcq  + wq * 4]
+    lea                 dst1q, [dst1q + wq * 2]
+    lea                 dst2q, [dst2q + wq * 2]
+    neg                    wq
+
+.loop_line:
+    mov          xq, wq
+    mov        cntq, wq
+    neg        cntq
+
+    ;calc scalar loop count
+    and        cntq, mmsize / 2 - 1
+    jz .end_scalar
+
+    .loop_scalar:
+        movd           xm0, [srcq + xq * 4]
+        psrlw          xm0, xm4
+        movd          tmpd, xm0
+        mov [dst1q + xq * 2], tmpw
+        shr           tmpd, 16
+        mov [dst2q + xq * 2], tmpw
+
+        add             xq, 1
+        sub           cntq, 1
+        jg .loop_scalar
+
+    .end_scalar:
+    ; check if simd loop is need
+    cmp          xq, 0
+    jge .end_line
+
+    .loop_simd:
+        movu            m0, [srcq + xq * 4         ]
+        movu            m1, [srcq + xq * 4 + mmsize]
+        psrlw           m0, xm4
+        psrlw           m1, xm4
+
+        ; sign extend both words of each pair to dwords, so that
+        ; packssdw keeps them unchanged
+        pslld           m2, m0, 16
+        pslld           m3, m1, 16
+        psrad           m2, 16
+        psrad           m3, 16
+        psrad           m0, 16
+        psrad           m1, 16
+        packssdw        m2, m3
+        packssdw        m0, m1
+%if mmsize == 32
+        vpermq          m2, m2, q3120
+        vpermq          m0, m0, q3120
+%endif
+        movu [dst1q + xq * 2], m2
+        movu [dst2q + xq * 2], m0
+
+        add             xq, mmsize / 2
+        jl .loop_simd
+
+    .end_line:
+        add          srcq, src_strideq
+        add         dst1q, dst1_strideq
+        add         dst2q, dst2_strideq
+        sub            hd, 1
+        jg .loop_line
+
+    RET
+%endmacro
+
+;-----------------------------------------------------------------------------------------------
+; interleave_words(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
+;                  int width, int height, int src1Stride,
+;                  int src2Stride, int dstStride, int shift)
+;-----------------------------------------------------------------------------------------------
+%macro INTERLEAVE_WORDS 0
+cglobal interleave_words, 9, 12, 5, src1, src2, dst, w, h, src1_stride, src2_stride, dst_stride, shift, x, cnt, tmp
+    movd                  xm4, shiftd
+
+    movsxdifnidn            wq, wd
+    movsxdifnidn  src1_strideq, src1_strided
+    movsxdifnidn  src2_strideq, src2_strided
+    movsxdifnidn   dst_strideq, dst_strided
+
+    lea                 src1q, [src1q + wq * 2]
+    lea                 src2q, [src2q + wq * 2]
+    lea                  dstq, [dstq  + wq * 4]
+    neg                    wq
+
+.loop_line:
+    mov          xq, wq
+    mov        cntq, wq
+    neg        cntq
+
+    ;calc scalar loop count
+    and        cntq, mmsize / 2 - 1
+    jz .end_scalar
+
+    .loop_scalar:
+        movzx         tmpd, word [src2q + xq * 2]
+        shl           tmpd, 16
+        mov           tmpw, [src1q + xq * 2]
+        movd           xm0, tmpd
+        psllw          xm0, xm4
+        movd [dstq + xq * 4], xm0
+
+        add             xq, 1
+        sub           cntq, 1
+        jg .loop_scalar
+
+    .end_scalar:
+    ; check if simd loop is need
+    cmp          xq, 0
+    jge .end_line
+
+    .loop_simd:
+        movu            m0, [src1q + xq * 2]
+        movu            m1, [src2q + xq * 2]
+        psllw           m0, xm4
+        psllw           m1, xm4
+%if mmsize == 32
+        ; the unpacks work within lanes, put samples 0-3 and 4-7 in
+        ; the low quadwords of the lanes and samples 8-15 above them
+        vpermq          m0, m0, q3120
+        vpermq          m1, m1, q3120
+%endif
+        punpckhwd       m2, m0, m1
+        punpcklwd       m0, m1
+        movu [dstq + xq * 4         ], m0
+        movu [dstq + xq * 4 + mmsize], m2
+
+        add             xq, mmsize / 2
+        jl .loop_simd
+
+    .end_line:
+        add         src1q, src1_strideq
+        add         src2q, src2_strideq
+        add          dstq, dst_strideq
+        sub            hd, 1
+        jg .loop_line
+
+    RET
+%endmacro
+
+;-----------------------------------------------------------------------------------------------
+; %1 = l/r
+; %1shift_words(const uint8_t *src, uint8_t *dst, int width, int height,
+;               int srcStride, int dstStride, int shift)
+;-----------------------------------------------------------------------------------------------
+%macro SHIFT_WORDS 1
+cglobal %1shift_words, 7, 10, 3, src, dst, w, h, src_stride, dst_stride, shift, x, cnt, tmp
+    movd                  xm2, shiftd
+
+    movsxdifnidn            wq, wd
+    movsxdifnidn   src_strideq, src_strided
+    movsxdifnidn   dst_strideq, dst_strided
+
+    lea                  srcq, [srcq + wq * 2]
+    lea                  dstq, [dstq + wq * 2]
+    neg                    wq
+
+.loop_line:
+    mov          xq, wq
+    mov        cntq, wq
+    neg        cntq
+
+    ;calc scalar loop count
+    and        cntq, mmsize - 1
+    jz .end_scalar
+
+    .loop_scalar:
+        movzx         tmpd, word [srcq + xq * 2]
+        movd           xm0, tmpd
+        ps%1lw         xm0, xm2
+        movd          tmpd, xm0
+        mov [dstq + xq * 2], tmpw
+
+        add             xq, 1
+        sub           cntq, 1
+        jg .loop_scalar
+
+    .end_scalar:
+    ; check if simd loop is need
+    cmp          xq, 0
+    jge .end_line
+
+    .loop_simd:
+        movu            m0, [srcq + xq * 2         ]
+        movu            m1, [srcq + xq * 2 + mmsize]
+        ps%1lw          m0, xm2
+        ps%1lw          m1, xm2
+        movu [dstq + xq * 2         ], m0
+        movu [dstq + xq * 2 + mmsize], m1
+
+        add             xq, mmsize
+        jl .loop_simd
+
+    .end_line:
+        add          srcq, src_strideq
+        add          dstq, dst_strideq
+        sub            hd, 1
+        jg .loop_line
+
+    RET
+%endmacro
+
+%if ARCH_X86_64
+INIT_XMM sse2
+DEINTERLEAVE_WORDS
+INTERLEAVE_WORDS
+SHIFT_WORDS l
+SHIFT_WORDS r
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+DEINTERLEAVE_WORDS
+INTERLEAVE_WORDS
+SHIFT_WORDS l
+SHIFT_WORDS r
+%endif
+%endif
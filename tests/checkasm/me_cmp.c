@@ -0,0 +1,118 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "checkasm.h"
+#include "libavcodec/me_cmp.h"
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
+#include "libavutil/intreadwrite.h"
+
+#define STRIDE   64
+#define BUF_SIZE (STRIDE * 48)
+
+static void randomize_buffer(uint8_t *buf)
+{
+    int i;
+
+    for (i = 0; i < BUF_SIZE; i += 4)
+        AV_WN32A(buf + i, rnd());
+}
+
+static void check_sad(MECmpContext *c, uint8_t *src, uint8_t *ref)
+{
+    static const char *const names[2] = { "sad16", "sad8" };
+    int size, i;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, int, struct MpegEncContext *c,
+                      uint8_t *blk1, uint8_t *blk2, ptrdiff_t stride, int h);
+
+    for (size = 0; size < 2; size++) {
+        const int w = 16 >> size;
+
+        if (check_func(c->sad[size], "%s", names[size])) {
+            for (i = 0; i < 4; i++) {
+                /* 8x8 blocks are only compared with h = 8 */
+                const int h      = i & 1 || size ? w : w >> 1;
+                const int offset = (rnd() % 16) * STRIDE + rnd() % 32;
+                int res0, res1;
+
+                randomize_buffer(src);
+                randomize_buffer(ref);
+                res0 = call_ref(NULL, src, ref + offset, STRIDE, h);
+                res1 = call_new(NULL, src, ref + offset, STRIDE, h);
+                if (res0 != res1)
+                    fail();
+            }
+            bench_new(NULL, src, ref + STRIDE + 1, STRIDE, w);
+        }
+    }
+}
+
+static void check_sad_x4(MECmpContext *c, uint8_t *src, uint8_t *ref)
+{
+    static const char *const names[2] = { "sad16_x4", "sad8_x4" };
+    int size, i, j;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, struct MpegEncContext *c,
+                      uint8_t *blk1, uint8_t *const blk2[4], ptrdiff_t stride,
+                      int h, int scores[4]);
+
+    for (size = 0; size < 2; size++) {
+        const int w = 16 >> size;
+
+        if (check_func(c->sad_x4[size], "%s", names[size])) {
+            uint8_t *blk[4];
+            int scores0[4], scores1[4];
+
+            for (i = 0; i < 4; i++) {
+                const int h = i & 1 || size ? w : w >> 1;
+
+                randomize_buffer(src);
+                randomize_buffer(ref);
+                for (j = 0; j < 4; j++)
+                    blk[j] = ref + (rnd() % 16) * STRIDE + rnd() % 32;
+                call_ref(NULL, src, blk, STRIDE, h, scores0);
+                call_new(NULL, src, blk, STRIDE, h, scores1);
+                if (memcmp(scores0, scores1, sizeof(scores0)))
+                    fail();
+            }
+            /* the neighbours a small diamond search step visits */
+            blk[0] = ref + 8 * STRIDE + 15;
+            blk[1] = ref + 7 * STRIDE + 16;
+            blk[2] = ref + 8 * STRIDE + 17;
+            blk[3] = ref + 9 * STRIDE + 16;
+            bench_new(NULL, src, blk, STRIDE, w, scores1);
+        }
+    }
+}
+
+void checkasm_check_me_cmp(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, ref, [BUF_SIZE]);
+    AVCodecContext avctx = { 0 };
+    MECmpContext c = { 0 };
+
+    ff_me_cmp_init(&c, &avctx);
+
+    check_sad(&c, src, ref);
+    report("sad");
+
+    check_sad_x4(&c, src, ref);
+    report("sad_x4");
+}
@@ -0,0 +1,110 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/pngdsp.h"
+#include "libavutil/intreadwrite.h"
+
+#define MAX_PIXELS 512
+#define BUF_SIZE (8 * (MAX_PIXELS + 1) + 16)
+
+#define randomize_buffers(buf, size)          \
+    do {                                      \
+        int j;                                \
+        for (j = 0; j < size; j += 4)         \
+            AV_WN32A(buf + j, rnd());         \
+    } while (0)
+
+static const int bpps[] = { 1, 2, 3, 4, 6, 8 };
+
+static void check_add_bytes_l2(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src1,    [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, src2,    [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst_ref, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst_new, [BUF_SIZE]);
+    int w = 8 * MAX_PIXELS - (rnd() & 31);
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, uint8_t *src1,
+                      uint8_t *src2, int w);
+
+    randomize_buffers(src1, BUF_SIZE);
+    randomize_buffers(src2, BUF_SIZE);
+    memset(dst_ref, 0, BUF_SIZE);
+    memset(dst_new, 0, BUF_SIZE);
+    call_ref(dst_ref, src1, src2, w);
+    call_new(dst_new, src1, src2, w);
+    if (memcmp(dst_ref, dst_new, BUF_SIZE))
+        fail();
+    bench_new(dst_new, src1, src2, w);
+}
+
+static void check_prediction(void (*func)(uint8_t *, uint8_t *, uint8_t *,
+                                          int, int),
+                             const char *name, int paeth)
+{
+    LOCAL_ALIGNED_16(uint8_t, src,     [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, top,     [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst_ref, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst_new, [BUF_SIZE]);
+    int i;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, uint8_t *src,
+                      uint8_t *top, int w, int bpp);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(bpps); i++) {
+        int bpp = bpps[i];
+        int w   = bpp * (MAX_PIXELS - (rnd() & 63));
+        /* the simd paeth versions leave the last pixel to the caller
+         * when it cannot be stored in one go */
+        int cmp = paeth && (bpp & 3) ? w - bpp : w;
+
+        if (paeth && bpp <= 2)
+            continue;
+        if (check_func(func, "%s_%d", name, bpp)) {
+            randomize_buffers(src, BUF_SIZE);
+            randomize_buffers(top, BUF_SIZE);
+            randomize_buffers(dst_ref, BUF_SIZE);
+            memcpy(dst_new, dst_ref, BUF_SIZE);
+            call_ref(dst_ref + 8, src + 8, top + 8, w, bpp);
+            call_new(dst_new + 8, src + 8, top + 8, w, bpp);
+            if (memcmp(dst_ref, dst_new, 8 + cmp))
+                fail();
+            bench_new(dst_new + 8, src + 8, top + 8, w, bpp);
+        }
+    }
+}
+
+void checkasm_check_pngdsp(void)
+{
+    PNGDSPContext c;
+
+    ff_pngdsp_init(&c);
+
+    if (check_func(c.add_bytes_l2, "add_bytes_l2"))
+        check_add_bytes_l2();
+    report("add_bytes_l2");
+
+    check_prediction(c.add_paeth_prediction, "add_paeth_prediction", 1);
+    report("add_paeth_prediction");
+
+    check_prediction(c.add_avg_prediction, "add_avg_prediction", 0);
+    report("add_avg_prediction");
+}
@@ -111,6 +111,118 @@ static void check_uyvy_to_422p(void)
     }
 }
 
+/* widths in samples, covering rows with and without a whole SIMD block
+ * and a remainder before it */
+static const int words_width[] = { 1, 7, 10, 23, 40, 64 };
+
+static void check_deinterleave_words(void)
+{
+    static const int shifts[] = { 0, 6 };
+    int i, j;
+
+    LOCAL_ALIGNED_32(uint8_t, src, [MAX_STRIDE * MAX_HEIGHT * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1_0, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst1_1, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst2_0, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst2_1, [MAX_STRIDE * MAX_HEIGHT]);
+
+    declare_func(void, const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
+                 int width, int height, int srcStride,
+                 int dst1Stride, int dst2Stride, int shift);
+
+    randomize_buffers(src, MAX_STRIDE * MAX_HEIGHT * 2);
+
+    if (check_func(deinterleaveWords, "deinterleave_words")) {
+        for (j = 0; j < FF_ARRAY_ELEMS(shifts); j++) {
+            for (i = 0; i < 6; i++) {
+                memset(dst1_0, 0, MAX_STRIDE * MAX_HEIGHT);
+                memset(dst1_1, 0, MAX_STRIDE * MAX_HEIGHT);
+                memset(dst2_0, 0, MAX_STRIDE * MAX_HEIGHT);
+                memset(dst2_1, 0, MAX_STRIDE * MAX_HEIGHT);
+
+                call_ref(src, dst1_0, dst2_0, words_width[i], planes[i].h,
+                         MAX_STRIDE * 2, MAX_STRIDE, MAX_STRIDE, shifts[j]);
+                call_new(src, dst1_1, dst2_1, words_width[i], planes[i].h,
+                         MAX_STRIDE * 2, MAX_STRIDE, MAX_STRIDE, shifts[j]);
+                if (memcmp(dst1_0, dst1_1, MAX_STRIDE * MAX_HEIGHT) ||
+                    memcmp(dst2_0, dst2_1, MAX_STRIDE * MAX_HEIGHT))
+                    fail();
+            }
+        }
+        bench_new(src, dst1_1, dst2_1, words_width[5], planes[5].h,
+                  MAX_STRIDE * 2, MAX_STRIDE, MAX_STRIDE, 6);
+    }
+}
+
+static void check_interleave_words(void)
+{
+    static const int shifts[] = { 0, 4, 6 };
+    int i, j;
+
+    LOCAL_ALIGNED_32(uint8_t, src1, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, src2, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [MAX_STRIDE * MAX_HEIGHT * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [MAX_STRIDE * MAX_HEIGHT * 2]);
+
+    declare_func(void, const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
+                 int width, int height, int src1Stride,
+                 int src2Stride, int dstStride, int shift);
+
+    randomize_buffers(src1, MAX_STRIDE * MAX_HEIGHT);
+    randomize_buffers(src2, MAX_STRIDE * MAX_HEIGHT);
+
+    if (check_func(interleaveWords, "interleave_words")) {
+        for (j = 0; j < FF_ARRAY_ELEMS(shifts); j++) {
+            for (i = 0; i < 6; i++) {
+                memset(dst0, 0, MAX_STRIDE * MAX_HEIGHT * 2);
+                memset(dst1, 0, MAX_STRIDE * MAX_HEIGHT * 2);
+
+                call_ref(src1, src2, dst0, words_width[i], planes[i].h,
+                         MAX_STRIDE, MAX_STRIDE, MAX_STRIDE * 2, shifts[j]);
+                call_new(src1, src2, dst1, words_width[i], planes[i].h,
+                         MAX_STRIDE, MAX_STRIDE, MAX_STRIDE * 2, shifts[j]);
+                if (memcmp(dst0, dst1, MAX_STRIDE * MAX_HEIGHT * 2))
+                    fail();
+            }
+        }
+        bench_new(src1, src2, dst1, words_width[5], planes[5].h,
+                  MAX_STRIDE, MAX_STRIDE, MAX_STRIDE * 2, 6);
+    }
+}
+
+static void check_shift_words(void *func, const char *report)
+{
+    static const int shifts[] = { 0, 4, 6 };
+    int i, j;
+
+    LOCAL_ALIGNED_32(uint8_t, src, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [MAX_STRIDE * MAX_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [MAX_STRIDE * MAX_HEIGHT]);
+
+    declare_func(void, const uint8_t *src, uint8_t *dst, int width,
+                 int height, int srcStride, int dstStride, int shift);
+
+    randomize_buffers(src, MAX_STRIDE * MAX_HEIGHT);
+
+    if (check_func(func, "%s", report)) {
+        for (j = 0; j < FF_ARRAY_ELEMS(shifts); j++) {
+            for (i = 0; i < 6; i++) {
+                memset(dst0, 0, MAX_STRIDE * MAX_HEIGHT);
+                memset(dst1, 0, MAX_STRIDE * MAX_HEIGHT);
+
+                call_ref(src, dst0, words_width[i], planes[i].h,
+                         MAX_STRIDE, MAX_STRIDE, shifts[j]);
+                call_new(src, dst1, words_width[i], planes[i].h,
+                         MAX_STRIDE, MAX_STRIDE, shifts[j]);
+                if (memcmp(dst0, dst1, MAX_STRIDE * MAX_HEIGHT))
+                    fail();
+            }
+        }
+        bench_new(src, dst1, words_width[5], planes[5].h,
+                  MAX_STRIDE, MAX_STRIDE, 6);
+    }
+}
+
 void checkasm_check_sw_rgb(void)
 {
     ff_sws_rgb2rgb_init();
@@ -132,4 +244,16 @@ void checkasm_check_sw_rgb(void)
 
     check_uyvy_to_422p();
     report("uyvytoyuv422");
+
+    check_deinterleave_words();
+    report("deinterleave_words");
+
+    check_interleave_words();
+    report("interleave_words");
+
+    check_shift_words(lshiftWords, "lshift_words");
+    report("lshift_words");
+
+    check_shift_words(rshiftWords, "rshift_words");
+    report("rshift_words");
 }
@@ -0,0 +1,121 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libswresample/resample.h"
+
+#include "checkasm.h"
+
+#define MAX_CHANNELS 8
+#define MAX_FILTER   40
+#define PHASES       16
+#define OUT_SAMPLES  64
+/* 44.1 kHz to 48 kHz, each output sample advances 147 / 160 input samples */
+#define SRC_INCR     160
+#define DST_INCR     (147 * PHASES)
+#define IN_SAMPLES   (OUT_SAMPLES + MAX_FILTER + 1)
+
+static void randomize_floats(float *buf, int len, float scale)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        buf[i] = ((int)(rnd() & 0xFFFF) - 0x8000) * scale / 0x8000;
+}
+
+static void check_resample_multi(int linear)
+{
+    static const int filter_lengths[] = { 5, 8, 13, 32, 37 };
+    static const int channels[] = { 2, 3, 4, 5, 8 };
+    LOCAL_ALIGNED_32(float, filter_bank, [(PHASES + 1) * MAX_FILTER]);
+    LOCAL_ALIGNED_32(float, src_buf, [MAX_CHANNELS * IN_SAMPLES]);
+    LOCAL_ALIGNED_32(float, dst0_buf, [MAX_CHANNELS * OUT_SAMPLES]);
+    LOCAL_ALIGNED_32(float, dst1_buf, [MAX_CHANNELS * OUT_SAMPLES]);
+    uint8_t *src[MAX_CHANNELS], *dst0[MAX_CHANNELS], *dst1[MAX_CHANNELS];
+    ResampleContext c = { 0 };
+    int i, j, k;
+
+    declare_func(int, ResampleContext *c, uint8_t **dst,
+                 uint8_t * const *src, int ch_count, int n);
+
+    for (k = 0; k < MAX_CHANNELS; k++) {
+        src[k]  = (uint8_t *)(src_buf  + k * IN_SAMPLES);
+        dst0[k] = (uint8_t *)(dst0_buf + k * OUT_SAMPLES);
+        dst1[k] = (uint8_t *)(dst1_buf + k * OUT_SAMPLES);
+    }
+    randomize_floats(src_buf, MAX_CHANNELS * IN_SAMPLES, 1.0);
+
+    c.format       = AV_SAMPLE_FMT_FLTP;
+    c.felem_size   = sizeof(float);
+    c.filter_bank  = (uint8_t *)filter_bank;
+    c.phase_count  = PHASES;
+    c.src_incr     = SRC_INCR;
+    c.dst_incr     = DST_INCR;
+    c.dst_incr_div = DST_INCR / SRC_INCR;
+    c.dst_incr_mod = DST_INCR % SRC_INCR;
+    c.linear       = linear;
+    swri_resample_dsp_init(&c);
+
+    if (check_func(linear ? c.dsp.resample_linear_multi : c.dsp.resample_common_multi,
+                   "resample_%s_multi_float", linear ? "linear" : "common")) {
+        for (i = 0; i < FF_ARRAY_ELEMS(filter_lengths); i++) {
+            for (j = 0; j < FF_ARRAY_ELEMS(channels); j++) {
+                const int nb_ch = channels[j];
+                int ret0, ret1, index, frac;
+
+                c.filter_length = filter_lengths[i];
+                c.filter_alloc  = filter_lengths[i];
+                randomize_floats(filter_bank, (PHASES + 1) * c.filter_alloc,
+                                 1.0 / c.filter_length);
+
+                memset(dst0_buf, 0, sizeof(*dst0_buf) * MAX_CHANNELS * OUT_SAMPLES);
+                memset(dst1_buf, 0, sizeof(*dst1_buf) * MAX_CHANNELS * OUT_SAMPLES);
+
+                c.index = rnd() % PHASES;
+                c.frac  = rnd() % SRC_INCR;
+                index   = c.index;
+                frac    = c.frac;
+                ret0 = call_ref(&c, dst0, src, nb_ch, OUT_SAMPLES);
+                FFSWAP(int, index, c.index);
+                FFSWAP(int, frac,  c.frac);
+                ret1 = call_new(&c, dst1, src, nb_ch, OUT_SAMPLES);
+
+                if (ret0 != ret1 || index != c.index || frac != c.frac ||
+                    !float_near_abs_eps_array(dst0_buf, dst1_buf, 1e-5,
+                                              MAX_CHANNELS * OUT_SAMPLES)) {
+                    fprintf(stderr, "%d taps, %d channels\n", c.filter_length, nb_ch);
+                    fail();
+                }
+            }
+        }
+        c.filter_length = c.filter_alloc = 32;
+        bench_new(&c, dst1, src, MAX_CHANNELS, OUT_SAMPLES);
+    }
+}
+
+void checkasm_check_swresample(void)
+{
+    check_resample_multi(0);
+    report("resample_common_multi");
+
+    check_resample_multi(1);
+    report("resample_linear_multi");
+}
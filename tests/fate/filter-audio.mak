@@ -128,6 +128,15 @@ fate-filter-firequalizer: CMP = oneoff
 fate-filter-firequalizer: CMP_UNIT = s16
 fate-filter-firequalizer: SIZE_TOLERANCE = 1058400 - 1097208
 
+FATE_AFILTER-$(call FILTERDEMDECENCMUX, FIREQUALIZER ATRIM VOLUME, WAV, PCM_S16LE, PCM_S16LE, WAV) += fate-filter-firequalizer-partitioned
+fate-filter-firequalizer-partitioned: tests/data/asynth-44100-2.wav
+fate-filter-firequalizer-partitioned: tests/data/filtergraphs/firequalizer-partitioned
+fate-filter-firequalizer-partitioned: REF = tests/data/asynth-44100-2.wav
+fate-filter-firequalizer-partitioned: CMD = ffmpeg -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav -filter_script $(TARGET_PATH)/tests/data/filtergraphs/firequalizer-partitioned -f wav -c:a pcm_s16le -
+fate-filter-firequalizer-partitioned: CMP = oneoff
+fate-filter-firequalizer-partitioned: CMP_UNIT = s16
+fate-filter-firequalizer-partitioned: SIZE_TOLERANCE = 1058400 - 1097208
+
 FATE_AFILTER-$(call FILTERDEMDECENCMUX, PAN, WAV, PCM_S16LE, PCM_S16LE, WAV) += fate-filter-pan-mono1
 fate-filter-pan-mono1: tests/data/asynth-44100-2.wav
 fate-filter-pan-mono1: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
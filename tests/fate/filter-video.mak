@@ -65,6 +65,22 @@ fate-filter-paletteuse-sierra2_4a: CMD = framecrc -i $(TARGET_SAMPLES)/filter/an
 fate-filter-paletteuse: $(FATE_FILTER_PALETTEUSE)
 FATE_FILTER_SAMPLES-$(call ALLYES, PALETTEUSE_FILTER MATROSKA_DEMUXER H264_DECODER IMAGE2_DEMUXER PNG_DECODER) += $(FATE_FILTER_PALETTEUSE)
 
+# threaded dithering must match the single threaded output; the palette has no
+# extreme colors so that the diffused errors clip
+PALETTEUSE_DITHER = none bayer heckbert floyd_steinberg sierra2 sierra2_4a
+PALETTEUSE_GRAPH  = testsrc2=s=640x480:d=0.12[in];testsrc2=s=16x16:d=0.04,lutrgb=r=val/2+64:g=val/2+64:b=val/2+64[pal];[in][pal]paletteuse
+
+define FATE_FILTER_PALETTEUSE_THREADS
+FATE_FILTER_PALETTEUSE_LAVFI += fate-filter-paletteuse-$(1)-threads1 fate-filter-paletteuse-$(1)-threads4
+fate-filter-paletteuse-$(1)-threads1: CMD = framemd5 -filter_complex_threads 1 -lavfi "$(PALETTEUSE_GRAPH)=$(1)" -pix_fmt bgra
+fate-filter-paletteuse-$(1)-threads4: CMD = framemd5 -filter_complex_threads 4 -lavfi "$(PALETTEUSE_GRAPH)=$(1)" -pix_fmt bgra
+fate-filter-paletteuse-$(1)-threads4: REF = $(SRC_PATH)/tests/ref/fate/filter-paletteuse-$(1)-threads1
+endef
+
+$(foreach D,$(PALETTEUSE_DITHER),$(eval $(call FATE_FILTER_PALETTEUSE_THREADS,$(D))))
+FATE_FILTER-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER LUTRGB_FILTER PALETTEUSE_FILTER) += $(FATE_FILTER_PALETTEUSE_LAVFI)
+fate-filter-paletteuse: $(FATE_FILTER_PALETTEUSE_LAVFI)
+
 FATE_FILTER-$(call ALLYES, AVDEVICE LIFE_FILTER) += fate-filter-lavd-life
 fate-filter-lavd-life: CMD = framecrc -f lavfi -i life=s=40x40:r=5:seed=42:mold=64:ratio=0.1:death_color=red:life_color=green -t 2
 
@@ -484,6 +500,22 @@ FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scalechroma
 fate-filter-scalechroma: tests/data/vsynth1.yuv
 fate-filter-scalechroma: CMD = framecrc -flags bitexact -s 352x288 -pix_fmt yuv444p -i tests/data/vsynth1.yuv -pix_fmt yuv420p -sws_flags +bitexact -vf scale=out_v_chr_pos=33:out_h_chr_pos=151
 
+FATE_FILTER_VSYNTH-$(call ALLYES, FORMAT_FILTER SCALE_FILTER) += fate-filter-scale-p010-nv12-area
+fate-filter-scale-p010-nv12-area: tests/data/vsynth1.yuv
+fate-filter-scale-p010-nv12-area: CMD = framecrc -flags bitexact -s 352x288 -pix_fmt yuv420p -i tests/data/vsynth1.yuv -sws_flags +bitexact -vf format=p010,scale=w=176:h=144:flags=area,format=nv12
+
+FATE_FILTER_VSYNTH-$(call ALLYES, CROP_FILTER FORMAT_FILTER SCALE_FILTER) += fate-filter-scale-yuv420p10-area-3-2
+fate-filter-scale-yuv420p10-area-3-2: tests/data/vsynth1.yuv
+fate-filter-scale-yuv420p10-area-3-2: CMD = framecrc -flags bitexact -s 352x288 -pix_fmt yuv420p -i tests/data/vsynth1.yuv -sws_flags +bitexact -vf crop=348:288:0:0,format=yuv420p10,scale=w=232:h=192:flags=area:out_range=full,format=yuv420p
+
+FATE_FILTER_VSYNTH-$(call ALLYES, FORMAT_FILTER SCALE_FILTER) += fate-filter-scale-p010-nv12-area-full-limited
+fate-filter-scale-p010-nv12-area-full-limited: tests/data/vsynth1.yuv
+fate-filter-scale-p010-nv12-area-full-limited: CMD = framecrc -flags bitexact -s 352x288 -pix_fmt yuv420p -i tests/data/vsynth1.yuv -sws_flags +bitexact -vf format=p010,scale=w=176:h=144:flags=area:in_range=full:out_range=limited,format=nv12
+
+FATE_FILTER_VSYNTH-$(call ALLYES, FORMAT_FILTER SCALE_FILTER) += fate-filter-scale-p010-nv12-area-bitexact
+fate-filter-scale-p010-nv12-area-bitexact: tests/data/vsynth1.yuv
+fate-filter-scale-p010-nv12-area-bitexact: CMD = framecrc -flags bitexact -s 352x288 -pix_fmt yuv420p -i tests/data/vsynth1.yuv -sws_flags +bitexact -vf format=p010,scale=w=176:h=144:flags=area+bitexact,format=nv12
+
 FATE_FILTER_VSYNTH-$(CONFIG_VFLIP_FILTER) += fate-filter-vflip
 fate-filter-vflip: CMD = video_filter "vflip"
 
@@ -736,6 +768,12 @@ FATE_METADATA_FILTER-$(call ALLYES, $(SCENEDETECT_DEPS)) += fate-filter-metadata
 fate-filter-metadata-scenedetect: SRC = $(TARGET_SAMPLES)/svq3/Vertical400kbit.sorenson3.mov
 fate-filter-metadata-scenedetect: CMD = run $(FILTER_METADATA_COMMAND) "sws_flags=+accurate_rnd+bitexact;movie='$(SRC)',select=gt(scene\,.4)"
 
+SCENEDETECT_DOWNSCALE_DEPS = FFPROBE AVDEVICE LAVFI_INDEV TESTSRC2_FILTER SMPTEBARS_FILTER \
+                             TESTSRC_FILTER RGBTESTSRC_FILTER CONCAT_FILTER FORMAT_FILTER \
+                             SELECT_FILTER SCALE_FILTER
+FATE_FFPROBE-$(call ALLYES, $(SCENEDETECT_DOWNSCALE_DEPS)) += fate-filter-metadata-scenedetect-downscale
+fate-filter-metadata-scenedetect-downscale: CMD = run $(FILTER_METADATA_COMMAND) "sws_flags=+accurate_rnd+bitexact;testsrc2=s=320x240:r=10:d=1[a];smptebars=s=320x240:r=10:d=1[b];testsrc=s=320x240:r=10:d=1[c];rgbtestsrc=s=320x240:r=10:d=1[d];[a][b][c][d]concat=n=4,format=yuv420p,select=gt(scene\,.02):scene_downscale=2"
+
 CROPDETECT_DEPS = FFPROBE LAVFI_INDEV MOVIE_FILTER CROPDETECT_FILTER SCALE_FILTER \
                   AVCODEC AVDEVICE MOV_DEMUXER H264_DECODER
 FATE_METADATA_FILTER-$(call ALLYES, $(CROPDETECT_DEPS)) += fate-filter-metadata-cropdetect
@@ -752,6 +790,10 @@ FATE_METADATA_FILTER-$(call ALLYES, $(EBUR128_METADATA_DEPS)) += fate-filter-met
 fate-filter-metadata-ebur128: SRC = $(TARGET_SAMPLES)/filter/seq-3341-7_seq-3342-5-24bit.flac
 fate-filter-metadata-ebur128: CMD = run $(FILTER_METADATA_COMMAND) "amovie='$(SRC)',ebur128=metadata=1"
 
+EBUR128_PEAK_METADATA_DEPS = FFPROBE AVDEVICE LAVFI_INDEV AEVALSRC_FILTER EBUR128_FILTER
+FATE_FFPROBE-$(call ALLYES, $(EBUR128_PEAK_METADATA_DEPS)) += fate-filter-metadata-ebur128-peak
+fate-filter-metadata-ebur128-peak: CMD = run $(FILTER_METADATA_COMMAND) "aevalsrc=0.5*sin(2*PI*12000*t+PI/4)|0.25*sin(2*PI*997*t):s=48000:d=1,ebur128=metadata=1:peak=sample+true"
+
 READVITC_METADATA_DEPS = FFPROBE LAVFI_INDEV MOVIE_FILTER AVCODEC AVDEVICE \
                          AVI_DEMUXER FFVHUFF_DECODER READVITC_FILTER
 FATE_METADATA_FILTER-$(call ALLYES, $(READVITC_METADATA_DEPS)) += fate-filter-metadata-readvitc-def
@@ -793,6 +835,11 @@ fate-filter-refcmp-ssim-rgb: CMD = refcmp_metadata ssim rgb24 0.015
 FATE_FILTER_SAMPLES-$(call ALLYES, $(REFCMP_DEPS) SSIM_FILTER) += fate-filter-refcmp-ssim-yuv
 fate-filter-refcmp-ssim-yuv: CMD = refcmp_metadata ssim yuv422p 0.015
 
+FATE_FILTER-$(CONFIG_DNN) += fate-filter-dnn-native
+fate-filter-dnn-native: libavfilter/tests/dnn-native$(EXESUF)
+fate-filter-dnn-native: CMD = run libavfilter/tests/dnn-native
+fate-filter-dnn-native: CMP = null
+
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_FILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_FILTER-yes)
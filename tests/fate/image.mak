@@ -326,6 +326,25 @@ FATE_PNG-$(call DEMDEC, IMAGE2, PNG) += $(FATE_PNG)
 FATE_IMAGE += $(FATE_PNG-yes)
 fate-png: $(FATE_PNG-yes)
 
+# slice threads deflate the images in blocks, which changes the compressed
+# data but must not change the decoded pictures
+FATE_DEFLATE_THREADS-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER NUT_MUXER NUT_DEMUXER \
+                                    PNG_ENCODER PNG_DECODER)       += png
+FATE_DEFLATE_THREADS-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER NUT_MUXER NUT_DEMUXER \
+                                    TIFF_ENCODER TIFF_DECODER ZLIB) += tiff
+
+fate-png-deflate-threads%:  ENCOPTS = -c:v png
+fate-tiff-deflate-threads%: ENCOPTS = -c:v tiff -compression_algo deflate -tag:v tiff
+fate-%-deflate-threads1: THREADOPTS = -threads 1
+fate-%-deflate-threads4: THREADOPTS = -threads 4 -thread_type slice
+fate-%-deflate-threads4: REF = $(SRC_PATH)/tests/ref/fate/$(@:fate-%-threads4=%)-threads1
+fate-%-deflate-threads1 fate-%-deflate-threads4: CMD = ffmpeg -f lavfi -i testsrc2=s=640x480:d=0.12 -pix_fmt rgb24 \
+    $(ENCOPTS) $(THREADOPTS) -f nut - | framecrc -i -
+
+FATE_DEFLATE_THREADS = $(foreach T,$(FATE_DEFLATE_THREADS-yes),fate-$(T)-deflate-threads1 fate-$(T)-deflate-threads4)
+FATE_FFMPEG += $(FATE_DEFLATE_THREADS)
+fate-deflate-threads: $(FATE_DEFLATE_THREADS)
+
 FATE_IMAGE-$(call DEMDEC, IMAGE2, PTX) += fate-ptx
 fate-ptx: CMD = framecrc -i $(TARGET_SAMPLES)/ptx/_113kw_pic.ptx -pix_fmt rgb24
 
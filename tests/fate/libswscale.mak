@@ -1,3 +1,8 @@
+FATE_LIBSWSCALE += fate-sws-p01x
+fate-sws-p01x: libswscale/tests/p01x$(EXESUF)
+fate-sws-p01x: CMD = run libswscale/tests/p01x
+fate-sws-p01x: CMP = null
+
 FATE_LIBSWSCALE += fate-sws-pixdesc-query
 fate-sws-pixdesc-query: libswscale/tests/pixdesc_query$(EXESUF)
 fate-sws-pixdesc-query: CMD = run libswscale/tests/pixdesc_query
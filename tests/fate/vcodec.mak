@@ -154,7 +154,7 @@ fate-vsynth%-dv-50:              FMT     = dv
 
 FATE_VCODEC-$(call ENCDEC, FFV1, AVI)   += ffv1 ffv1-v0 \
                                            ffv1-v3-yuv420p ffv1-v3-yuv422p10 ffv1-v3-yuv444p16 \
-                                           ffv1-v3-bgr0 ffv1-v3-rgb48
+                                           ffv1-v3-bgr0 ffv1-v3-rgb48 ffv1-v3-frame-thread
 fate-vsynth%-ffv1:               ENCOPTS = -slices 4
 fate-vsynth%-ffv1-v0:            CODEC   = ffv1
 fate-vsynth%-ffv1-v3-yuv420p:    ENCOPTS = -level 3 -pix_fmt yuv420p
@@ -170,6 +170,8 @@ fate-vsynth%-ffv1-v3-bgr0:       DECOPTS = -sws_flags neighbor+bitexact
 fate-vsynth%-ffv1-v3-rgb48:      ENCOPTS = -level 3 -pix_fmt rgb48 -strict -2 \
                                            -sws_flags neighbor+bitexact
 fate-vsynth%-ffv1-v3-rgb48:      DECOPTS = -sws_flags neighbor+bitexact
+fate-vsynth%-ffv1-v3-frame-thread: ENCOPTS = -level 3 -g 1 -slices 4 -slicecrc 1 \
+                                             -threads 2 -thread_type frame
 
 FATE_VCODEC-$(call ENCDEC, FFVHUFF, AVI) += ffvhuff ffvhuff444 ffvhuff420p12 ffvhuff422p10left ffvhuff444p16
 fate-vsynth%-ffvhuff444:         ENCOPTS = -c:v ffvhuff -pix_fmt yuv444p
@@ -244,7 +246,8 @@ FATE_MPEG2 = mpeg2                                                      \
              mpeg2-ilace                                                \
              mpeg2-ivlc-qprd                                            \
              mpeg2-thread                                               \
-             mpeg2-thread-ivlc
+             mpeg2-thread-ivlc                                          \
+             mpeg2-intra-frame-thread
 
 FATE_VCODEC-$(call ENCDEC, MPEG2VIDEO, MPEG2VIDEO MPEGVIDEO) += $(FATE_MPEG2)
 
@@ -274,6 +277,9 @@ fate-vsynth%-mpeg2-thread:       ENCOPTS = -qscale 10 -bf 2 -flags +ildct+ilme \
 fate-vsynth%-mpeg2-thread-ivlc:  ENCOPTS = -qscale 10 -bf 2 -flags +ildct+ilme \
                                            -intra_vlc 1 -threads 2 -slices 2
 
+fate-vsynth%-mpeg2-intra-frame-thread: ENCOPTS = -qscale 10 -g 1 -flags +low_delay \
+                                                -threads 2 -thread_type frame
+
 FATE_MPEG4_MP4 = mpeg4
 FATE_MPEG4_AVI = mpeg4-rc                                               \
                  mpeg4-adv                                              \
@@ -281,6 +287,7 @@ FATE_MPEG4_AVI = mpeg4-rc                                               \
                  mpeg4-adap                                             \
                  mpeg4-qpel                                             \
                  mpeg4-thread                                           \
+                 mpeg4-intra-frame-thread                               \
                  mpeg4-error                                            \
                  mpeg4-nr                                               \
                  mpeg4-nsse
@@ -325,6 +332,9 @@ fate-vsynth%-mpeg4-thread:       ENCOPTS = -b 500k -flags +mv4+aic         \
                                            -mbd bits -ps 200 -bf 2         \
                                            -threads 2 -slices 2
 
+fate-vsynth%-mpeg4-intra-frame-thread: ENCOPTS = -qscale 10 -g 1 \
+                                                 -threads 2 -thread_type frame
+
 FATE_VCODEC-$(call ENCDEC, MSMPEG4V3, AVI) += msmpeg4
 fate-vsynth%-msmpeg4:            ENCOPTS = -qscale 10
 
@@ -434,6 +444,28 @@ FATE_VCODEC-$(call ENCDEC, Y41P, AVI) += y41p
 
 FATE_VCODEC-$(call ENCDEC, ZLIB, AVI) += zlib
 
+# frame threads code whole closed GOPs, the packets must be those a single
+# thread gives; the forced keyframe ends a GOP early
+FATE_FRAME_THREAD-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER MPEG2VIDEO_ENCODER) += mpeg2-intra mpeg2-gop
+FATE_FRAME_THREAD-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER MPEG4_ENCODER)      += mpeg4-p mpeg4-gop
+
+fate-frame-thread-mpeg2-intra-%: ENCOPTS = -c:v mpeg2video -qscale 4 -g 1
+fate-frame-thread-mpeg2-gop-%:   ENCOPTS = -c:v mpeg2video -qscale 4 -g 12 -bf 2 -flags +cgop \
+                                           -sc_threshold 1000000000 -mpv_flags +strict_gop \
+                                           -force_key_frames 1.2
+fate-frame-thread-mpeg4-p-%:     ENCOPTS = -c:v mpeg4 -qscale 4 -g 10 -flags +cgop \
+                                           -sc_threshold 1000000000
+fate-frame-thread-mpeg4-gop-%:   ENCOPTS = -c:v mpeg4 -qscale 4 -g 15 -bf 3 -flags +cgop \
+                                           -sc_threshold 1000000000 -mpv_flags +strict_gop
+
+fate-frame-thread-%-threads1: CMD = framemd5 -f lavfi -i testsrc2=s=176x144:d=3 $(ENCOPTS) -threads 1
+fate-frame-thread-%-threads4: CMD = framemd5 -f lavfi -i testsrc2=s=176x144:d=3 $(ENCOPTS) -threads 4 -thread_type frame
+fate-frame-thread-%-threads4: REF = $(SRC_PATH)/tests/ref/fate/$(@:fate-%-threads4=%)-threads1
+
+FATE_FRAME_THREAD = $(foreach T,$(FATE_FRAME_THREAD-yes),fate-frame-thread-$(T)-threads1 fate-frame-thread-$(T)-threads4)
+FATE_AVCONV += $(FATE_FRAME_THREAD)
+fate-frame-thread: $(FATE_FRAME_THREAD)
+
 FATE_VCODEC += $(FATE_VCODEC-yes)
 FATE_VSYNTH1 = $(FATE_VCODEC:%=fate-vsynth1-%)
 FATE_VSYNTH2 = $(FATE_VCODEC:%=fate-vsynth2-%)